@@ -0,0 +1,33 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+namespace opencode::bench
+{
+
+/// Heap allocations (operator new calls) made by the whole process so far
+/// Counted by the global operator new replacement in alloc_counter.cpp.
+uint64_t allocations();
+
+/// Allocations made since the scope was created
+class AllocationScope
+{
+  public:
+    AllocationScope()
+        : start_(allocations())
+    {
+    }
+
+    uint64_t count() const
+    {
+        return allocations() - start_;
+    }
+
+  private:
+    uint64_t start_;
+};
+
+} // namespace opencode::bench
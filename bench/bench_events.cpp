@@ -0,0 +1,68 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// End-to-end EventStream throughput: /event from the mock server, through the
+// shared SSE connection and event decoding, to a consumer reading batches
+
+#include "alloc_counter.hpp"
+#include "fixtures.hpp"
+
+#include <opencode/client.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+
+namespace opencode::bench
+{
+
+namespace
+{
+
+void BM_EventStream(benchmark::State& state)
+{
+    constexpr size_t replays = 5;
+    MockServer server(replays);
+
+    ClientOptions opts;
+    opts.base_url = server.url();
+    opts.sse_reconnect.enabled = false; // The replay ends the stream; don't start it over
+
+    EventStreamOptions stream_options;
+    stream_options.capacity = static_cast<size_t>(state.range(0));
+
+    uint64_t events = 0;
+    uint64_t allocations = 0;
+    std::array<Event, 256> batch;
+    for (auto _ : state)
+    {
+        // A fresh client each time, so its /event connection replays from the start
+        state.PauseTiming();
+        auto client = std::make_unique<Client>(opts);
+        state.ResumeTiming();
+
+        // Includes the mock server's own (few) allocations while it writes
+        AllocationScope scope;
+        auto stream = client->subscribe_events({}, stream_options);
+        while (size_t count = stream.next_batch(batch))
+            events += count;
+        allocations += scope.count();
+
+        state.PauseTiming();
+        stream.close();
+        client.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * replays * event_stream().size()));
+    state.SetItemsProcessed(static_cast<int64_t>(events));
+    state.counters["events_per_s"] = benchmark::Counter(static_cast<double>(events), benchmark::Counter::kIsRate);
+    state.counters["allocs_per_event"] = events ? static_cast<double>(allocations) / events : 0.0;
+}
+
+} // namespace
+
+// Queue capacity: unbounded, and a bounded queue that blocks the reader when full
+BENCHMARK(BM_EventStream)->ArgName("capacity")->Arg(0)->Arg(1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace opencode::bench
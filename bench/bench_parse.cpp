@@ -0,0 +1,79 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Response decoding (the parse_* functions behind get_messages()) without sockets
+
+#include "alloc_counter.hpp"
+#include "fixtures.hpp"
+
+#include <opencode/client.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace opencode::bench
+{
+
+namespace
+{
+
+void BM_DecodeMessages(benchmark::State& state)
+{
+    const auto messages = static_cast<size_t>(state.range(0));
+    const auto& payload = messages_payload(messages, static_cast<size_t>(state.range(1)));
+
+    auto transport = std::make_unique<ReplayTransport>();
+    transport->add("/session/ses_bench/message", payload);
+    ClientOptions opts;
+    opts.base_url = "http://127.0.0.1:1";
+    Client client(opts, std::move(transport));
+
+    uint64_t decoded = 0;
+    uint64_t allocations = 0;
+    for (auto _ : state)
+    {
+        AllocationScope scope;
+        auto result = client.get_messages("ses_bench");
+        decoded += result.size();
+        benchmark::DoNotOptimize(result.data());
+        allocations += scope.count();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(decoded));
+    state.counters["allocs_per_message"] = decoded ? static_cast<double>(allocations) / decoded : 0.0;
+}
+
+void BM_DecodeMessagesCompact(benchmark::State& state)
+{
+    const auto messages = static_cast<size_t>(state.range(0));
+    const auto& payload = messages_payload(messages, static_cast<size_t>(state.range(1)));
+
+    auto transport = std::make_unique<ReplayTransport>();
+    transport->add("/session/ses_bench/message", payload);
+    ClientOptions opts;
+    opts.base_url = "http://127.0.0.1:1";
+    Client client(opts, std::move(transport));
+
+    uint64_t decoded = 0;
+    uint64_t allocations = 0;
+    for (auto _ : state)
+    {
+        AllocationScope scope;
+        auto history = client.get_messages_compact("ses_bench");
+        decoded += history.size();
+        benchmark::DoNotOptimize(history.messages().data());
+        allocations += scope.count();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(decoded));
+    state.counters["allocs_per_message"] = decoded ? static_cast<double>(allocations) / decoded : 0.0;
+}
+
+} // namespace
+
+// Message count, text bytes per part
+BENCHMARK(BM_DecodeMessages)->ArgNames({"messages", "text_bytes"})->Args({50, 256})->Args({500, 2048})->Args({2000, 8192})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DecodeMessagesCompact)->ArgNames({"messages", "text_bytes"})->Args({50, 256})->Args({500, 2048})->Args({2000, 8192})->Unit(benchmark::kMillisecond);
+
+} // namespace opencode::bench
@@ -0,0 +1,75 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// SSEParser throughput over a recorded /event stream, fed in network-sized chunks
+
+#include "alloc_counter.hpp"
+#include "fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+
+namespace opencode::bench
+{
+
+namespace
+{
+
+template <typename Feed>
+void run_parser(benchmark::State& state, Feed&& feed)
+{
+    const auto& stream = event_stream();
+    const auto chunk = static_cast<size_t>(state.range(0));
+    uint64_t events = 0;
+    uint64_t allocations = 0;
+
+    for (auto _ : state)
+    {
+        AllocationScope scope;
+        SSEParser parser;
+        for (size_t offset = 0; offset < stream.size(); offset += chunk)
+            events += feed(parser, std::string_view(stream).substr(offset, chunk));
+        allocations += scope.count();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * stream.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(events));
+    state.counters["allocs_per_event"] = events ? static_cast<double>(allocations) / events : 0.0;
+}
+
+void BM_SSEParserFeed(benchmark::State& state)
+{
+    run_parser(state, [](SSEParser& parser, std::string_view data)
+    {
+        size_t events = 0;
+        parser.feed(data, [&](const SSEEvent& event)
+        {
+            benchmark::DoNotOptimize(event.data.data());
+            ++events;
+        });
+        return events;
+    });
+}
+
+void BM_SSEParserFeedViews(benchmark::State& state)
+{
+    run_parser(state, [](SSEParser& parser, std::string_view data)
+    {
+        size_t events = 0;
+        parser.feed_views(data, [&](const SSEEventView& event)
+        {
+            benchmark::DoNotOptimize(event.data.data());
+            ++events;
+        });
+        return events;
+    });
+}
+
+} // namespace
+
+// Chunk sizes: a small TCP read, httplib's 16 KiB buffer, and the whole stream at once
+BENCHMARK(BM_SSEParserFeed)->ArgName("chunk")->Arg(1024)->Arg(16 * 1024)->Arg(1 << 30);
+BENCHMARK(BM_SSEParserFeedViews)->ArgName("chunk")->Arg(1024)->Arg(16 * 1024)->Arg(1 << 30);
+
+} // namespace opencode::bench
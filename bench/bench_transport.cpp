@@ -0,0 +1,84 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Request latency through HttpTransport's keep-alive pool against the mock server
+
+#include "alloc_counter.hpp"
+#include "fixtures.hpp"
+
+#include <opencode/client.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace opencode::bench
+{
+
+namespace
+{
+
+/// Time each call of `call` and report its p50 / p99 latency in microseconds
+template <typename Call>
+void measure_latency(benchmark::State& state, Call&& call)
+{
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(state.max_iterations));
+    uint64_t allocations = 0;
+
+    for (auto _ : state)
+    {
+        AllocationScope scope;
+        auto begin = std::chrono::steady_clock::now();
+        call();
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+        allocations += scope.count();
+    }
+
+    if (latencies.empty())
+        return;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double q)
+    {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(q * static_cast<double>(latencies.size())))];
+    };
+    state.counters["p50_us"] = percentile(0.50);
+    state.counters["p99_us"] = percentile(0.99);
+    state.counters["allocs_per_request"] = static_cast<double>(allocations) / static_cast<double>(latencies.size());
+}
+
+void BM_HealthRequest(benchmark::State& state)
+{
+    MockServer server;
+    ClientOptions opts;
+    opts.base_url = server.url();
+    Client client(opts);
+
+    measure_latency(state, [&] { benchmark::DoNotOptimize(client.health()); });
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void BM_GetMessagesHttp(benchmark::State& state)
+{
+    MockServer server;
+    ClientOptions opts;
+    opts.base_url = server.url();
+    opts.compression = state.range(0) != 0;
+    Client client(opts);
+
+    measure_latency(state, [&]
+    {
+        auto messages = client.get_messages("ses_bench");
+        benchmark::DoNotOptimize(messages.data());
+    });
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * messages_payload().size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_HealthRequest)->UseRealTime();
+BENCHMARK(BM_GetMessagesHttp)->ArgName("compression")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace opencode::bench
@@ -0,0 +1,277 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "fixtures.hpp"
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+namespace opencode::bench
+{
+
+using json = nlohmann::json;
+
+namespace
+{
+
+constexpr std::array<const char*, 16> kWords = {
+    "the ", "function ", "returns ", "a ", "vector ", "of ", "parsed ", "messages ",
+    "so ", "callers ", "can ", "iterate ", "without ", "copying\n", "```cpp\n", "}\n"};
+
+/// Contents of the file named by environment variable `name`, if it is set
+std::optional<std::string> recording(const char* name)
+{
+    const char* path = std::getenv(name);
+    if (!path || !*path)
+        return std::nullopt;
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error(std::string("Cannot open ") + name + " recording: " + path);
+    std::ostringstream out;
+    out << file.rdbuf();
+    return out.str();
+}
+
+void append_frame(std::string& out, const std::string& type, json properties)
+{
+    out += "data: ";
+    out += json{{"type", type}, {"properties", std::move(properties)}}.dump();
+    out += "\n\n";
+}
+
+std::string make_id(const char* prefix, size_t n)
+{
+    std::string id = prefix;
+    id += "01JBENCH";
+    id += std::to_string(100000 + n);
+    return id;
+}
+
+json assistant_info(const std::string& session_id, const std::string& message_id, const std::string& parent_id)
+{
+    return {{"id", message_id},
+            {"sessionID", session_id},
+            {"role", "assistant"},
+            {"time", {{"created", 1730000000000}, {"completed", 1730000004000}}},
+            {"parentID", parent_id},
+            {"modelID", "claude-sonnet-4"},
+            {"providerID", "anthropic"},
+            {"mode", "build"},
+            {"path", {{"cwd", "/home/dev/project"}, {"root", "/home/dev/project"}}},
+            {"cost", 0.0123},
+            {"tokens", {{"input", 1200}, {"output", 340}, {"reasoning", 0}, {"cache", {{"read", 800}, {"write", 0}}}}}};
+}
+
+std::string make_event_stream()
+{
+    constexpr size_t replies = 20;
+    constexpr size_t deltas = 200;
+    const std::string session_id = "ses_01JBENCHSESSION";
+
+    std::string out;
+    size_t events = 0;
+    append_frame(out, "server.connected", json::object());
+    for (size_t r = 0; r < replies; ++r)
+    {
+        auto message_id = make_id("msg_", r);
+        auto part_id = make_id("prt_", r);
+        append_frame(out, "session.status", {{"sessionID", session_id}, {"status", {{"type", "busy"}}}});
+        append_frame(out, "message.updated", {{"info", assistant_info(session_id, message_id, make_id("msg_u", r))}});
+
+        // Like the server, each update carries the text so far and the delta
+        std::string text;
+        for (size_t d = 0; d < deltas; ++d)
+        {
+            const char* delta = kWords[(r + d) % kWords.size()];
+            text += delta;
+            append_frame(out, "message.part.updated",
+                         {{"part", {{"id", part_id}, {"sessionID", session_id}, {"messageID", message_id},
+                                    {"type", "text"}, {"text", text}}},
+                          {"delta", delta}});
+            if (++events % 40 == 0)
+                append_frame(out, "server.heartbeat", json::object());
+        }
+        append_frame(out, "session.idle", {{"sessionID", session_id}});
+    }
+    return out;
+}
+
+std::string make_messages_payload(size_t messages, size_t text_bytes)
+{
+    const std::string session_id = "ses_01JBENCHSESSION";
+    std::string text;
+    for (size_t i = 0; text.size() < text_bytes; ++i)
+        text += kWords[i % kWords.size()];
+
+    json body = json::array();
+    for (size_t m = 0; m < messages; ++m)
+    {
+        auto message_id = make_id("msg_", m);
+        json parts = json::array();
+        json info;
+        if (m % 2 == 0)
+        {
+            info = {{"id", message_id},
+                    {"sessionID", session_id},
+                    {"role", "user"},
+                    {"time", {{"created", 1730000000000}}},
+                    {"agent", "build"},
+                    {"model", {{"providerID", "anthropic"}, {"modelID", "claude-sonnet-4"}}}};
+        }
+        else
+        {
+            info = assistant_info(session_id, message_id, make_id("msg_", m - 1));
+            parts.push_back({{"id", make_id("prt_t", m)},
+                             {"sessionID", session_id},
+                             {"messageID", message_id},
+                             {"type", "tool"},
+                             {"tool", "read"},
+                             {"input", {{"filePath", "/home/dev/project/src/client.cpp"}, {"limit", 200}}},
+                             {"state", {{"status", "completed"}}}});
+        }
+        parts.push_back({{"id", make_id("prt_", m)},
+                         {"sessionID", session_id},
+                         {"messageID", message_id},
+                         {"type", "text"},
+                         {"text", text}});
+        body.push_back({{"info", std::move(info)}, {"parts", std::move(parts)}});
+    }
+    return body.dump();
+}
+
+} // namespace
+
+// =============================================================================
+// Recorded payloads
+// =============================================================================
+
+const std::string& event_stream()
+{
+    static const std::string stream = []
+    {
+        auto recorded = recording("OPENCODE_BENCH_EVENTS");
+        return recorded ? std::move(*recorded) : make_event_stream();
+    }();
+    return stream;
+}
+
+size_t event_count()
+{
+    static const size_t count = []
+    {
+        size_t events = 0;
+        SSEParser parser;
+        parser.feed_views(event_stream(), [&](const SSEEventView&) { ++events; });
+        return events;
+    }();
+    return count;
+}
+
+const std::string& messages_payload(size_t messages, size_t text_bytes)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<size_t, size_t>, std::string> payloads;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& payload = payloads[{messages, text_bytes}];
+    if (payload.empty())
+    {
+        auto recorded = recording("OPENCODE_BENCH_MESSAGES");
+        payload = recorded ? std::move(*recorded) : make_messages_payload(messages, text_bytes);
+    }
+    return payload;
+}
+
+// =============================================================================
+// MockServer
+// =============================================================================
+
+MockServer::MockServer(size_t event_replays)
+    : server_(std::make_unique<httplib::Server>())
+{
+    server_->Get("/global/health", [](const httplib::Request&, httplib::Response& res)
+    {
+        res.set_content(R"({"healthy":true,"version":"bench"})", "application/json");
+    });
+
+    server_->Get(R"(/session/([^/]+)/message)", [](const httplib::Request&, httplib::Response& res)
+    {
+        const auto& body = messages_payload();
+        res.set_content(body.data(), body.size(), "application/json");
+    });
+
+    server_->Get("/event", [event_replays](const httplib::Request&, httplib::Response& res)
+    {
+        res.set_chunked_content_provider("text/event-stream", [event_replays](size_t, httplib::DataSink& sink)
+        {
+            constexpr size_t chunk = 16 * 1024;
+            const auto& stream = event_stream();
+            for (size_t replay = 0; replay < event_replays; ++replay)
+            {
+                for (size_t offset = 0; offset < stream.size(); offset += chunk)
+                {
+                    if (!sink.write(stream.data() + offset, std::min(chunk, stream.size() - offset)))
+                        return false; // Client went away
+                }
+            }
+            sink.done();
+            return true;
+        });
+    });
+
+    int port = server_->bind_to_any_port("127.0.0.1");
+    if (port <= 0)
+        throw std::runtime_error("Mock server failed to bind");
+    thread_ = std::thread([this] { server_->listen_after_bind(); });
+    server_->wait_until_ready();
+    url_ = "http://127.0.0.1:" + std::to_string(port);
+}
+
+MockServer::~MockServer()
+{
+    server_->stop();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+// =============================================================================
+// ReplayTransport
+// =============================================================================
+
+HttpResponse ReplayTransport::request(const HttpRequest& req)
+{
+    HttpResponse response;
+    auto it = bodies_.find(req.path.substr(0, req.path.find('?')));
+    if (req.method != "GET" || it == bodies_.end())
+    {
+        response.status = 404;
+        return response;
+    }
+    response.status = 200;
+    response.body = it->second;
+    return response;
+}
+
+bool ReplayTransport::start_sse(
+    const std::string&,
+    const std::vector<std::pair<std::string, std::string>>&,
+    SSEEventCallback,
+    SSEErrorCallback,
+    SSECloseCallback on_close
+)
+{
+    on_close();
+    return false;
+}
+
+} // namespace opencode::bench
@@ -0,0 +1,108 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <opencode/transport.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace httplib
+{
+class Server;
+}
+
+namespace opencode::bench
+{
+
+// =============================================================================
+// Recorded payloads
+// =============================================================================
+
+/// A /event stream: assistant replies streamed as text deltas, with the status
+/// and heartbeat events a real server interleaves
+///
+/// Set OPENCODE_BENCH_EVENTS to a capture of a real server
+/// (curl -N http://127.0.0.1:4096/event > events.sse) to replay that instead.
+const std::string& event_stream();
+
+/// Number of events in event_stream()
+size_t event_count();
+
+/// A GET /session/:id/message body of `messages` messages (half of them
+/// assistant replies) whose text parts hold about text_bytes bytes each
+///
+/// Set OPENCODE_BENCH_MESSAGES to a captured response to replay that instead.
+const std::string& messages_payload(size_t messages = 500, size_t text_bytes = 2048);
+
+// =============================================================================
+// Mock server
+// =============================================================================
+
+/// In-process HTTP server standing in for `opencode serve` on 127.0.0.1
+///
+/// Serves /global/health, GET /session/:id/message (messages_payload()) and
+/// /event, which replays event_stream() `event_replays` times and closes.
+class MockServer
+{
+  public:
+    explicit MockServer(size_t event_replays = 1);
+    ~MockServer();
+
+    MockServer(const MockServer&) = delete;
+    MockServer& operator=(const MockServer&) = delete;
+
+    /// Base URL to pass as ClientOptions::base_url
+    const std::string& url() const
+    {
+        return url_;
+    }
+
+  private:
+    std::unique_ptr<httplib::Server> server_;
+    std::thread thread_;
+    std::string url_;
+};
+
+// =============================================================================
+// Replay transport
+// =============================================================================
+
+/// Transport answering GETs from memory, to time decoding without sockets
+/// It has no event stream: start_sse() closes at once.
+class ReplayTransport : public Transport
+{
+  public:
+    /// Answer GET path (query ignored) with body
+    void add(const std::string& path, std::string body)
+    {
+        bodies_[path] = std::move(body);
+    }
+
+    HttpResponse request(const HttpRequest& req) override;
+
+    bool start_sse(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        SSEEventCallback on_event,
+        SSEErrorCallback on_error,
+        SSECloseCallback on_close
+    ) override;
+
+    void stop_sse() override
+    {
+    }
+
+    bool sse_connected() const override
+    {
+        return false;
+    }
+
+  private:
+    std::unordered_map<std::string, std::string> bodies_;
+};
+
+} // namespace opencode::bench
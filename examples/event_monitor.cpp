@@ -55,6 +55,20 @@ int main()
             {
                 std::cout << "[session.updated] " << e->session.id << "\n";
             }
+            else if (auto* e = opencode::try_as<opencode::SessionStatusEvent>(event))
+            {
+                std::cout << "[session.status] " << e->session_id
+                          << " " << e->status.status << "\n";
+            }
+            else if (auto* e = opencode::try_as<opencode::SessionIdleEvent>(event))
+            {
+                std::cout << "[session.idle] " << e->session_id << "\n";
+            }
+            else if (auto* e = opencode::try_as<opencode::SessionErrorEvent>(event))
+            {
+                std::cout << "[session.error] " << e->session_id
+                          << " " << e->error << "\n";
+            }
             else if (auto* e = opencode::try_as<opencode::MessagePartUpdatedEvent>(event))
             {
                 std::cout << "[message.part.updated] session=" << e->session_id
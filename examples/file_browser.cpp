@@ -6,6 +6,8 @@
 #include <opencode/opencode.hpp>
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <vector>
 
 void print_size(int64_t bytes)
 {
@@ -61,29 +63,27 @@ int main(int argc, char* argv[])
             }
         }
 
-        // Show git status for a file
+        // Show git status of every file, fetched concurrently
         std::cout << "\nFile status:\n";
+        std::vector<std::string> paths;
         for (const auto& f : files)
         {
             if (!f.is_directory)
+                paths.push_back(f.path);
+        }
+        for (const auto& result : client.file_statuses(paths))
+        {
+            if (!result.ok())
+                continue; // Ignore errors
+            const auto& status = *result.value;
+            if (status.status != "clean")
             {
-                try
-                {
-                    auto status = client.file_status(f.path);
-                    if (status.status != "clean")
-                    {
-                        std::cout << "  " << f.name << ": " << status.status;
-                        if (status.additions)
-                            std::cout << " (+" << *status.additions << ")";
-                        if (status.deletions)
-                            std::cout << " (-" << *status.deletions << ")";
-                        std::cout << "\n";
-                    }
-                }
-                catch (...)
-                {
-                    // Ignore errors
-                }
+                std::cout << "  " << result.path << ": " << status.status;
+                if (status.additions)
+                    std::cout << " (+" << *status.additions << ")";
+                if (status.deletions)
+                    std::cout << " (-" << *status.deletions << ")";
+                std::cout << "\n";
             }
         }
 
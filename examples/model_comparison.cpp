@@ -33,29 +33,40 @@ int main()
         std::string prompt = "What is the capital of France? Answer in one word.";
         std::cout << "Prompt: " << prompt << "\n\n";
 
+        // One session per model, all prompted concurrently
+        std::vector<opencode::Session> sessions;
+        std::vector<opencode::BatchItem> batch;
         for (const auto& m : models)
         {
-            try
-            {
-                auto session = client.create_session("Model Test: " + m.name);
-                auto response = session.send(prompt, m.provider, m.model);
-
-                std::cout << m.name << ":\n";
-                std::cout << "  Response: " << response.text() << "\n";
+            sessions.push_back(client.create_session("Model Test: " + m.name));
+            batch.push_back({sessions.back().id(), prompt, m.provider, m.model});
+        }
 
-                if (auto tokens = response.tokens())
-                {
-                    std::cout << "  Tokens: in=" << tokens->input
-                              << " out=" << tokens->output << "\n";
-                }
-                std::cout << "\n";
+        auto results = client.send_batch(batch, {.max_concurrency = static_cast<int>(batch.size())});
 
-                session.destroy();
+        for (const auto& result : results)
+        {
+            const auto& m = models[result.index];
+            if (!result.ok())
+            {
+                std::cout << m.name << ": Error - " << result.error << "\n\n";
+                continue;
             }
-            catch (const std::exception& e)
+
+            std::cout << m.name << " (" << result.elapsed.count() << " ms):\n";
+            std::cout << "  Response: " << result.message->text() << "\n";
+
+            if (auto tokens = result.message->tokens())
             {
-                std::cout << m.name << ": Error - " << e.what() << "\n\n";
+                std::cout << "  Tokens: in=" << tokens->input
+                          << " out=" << tokens->output << "\n";
             }
+            std::cout << "\n";
+        }
+
+        for (auto& session : sessions)
+        {
+            session.destroy();
         }
 
         return 0;
@@ -3,12 +3,21 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
 #include <memory>
 #include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
 #include <string>
 #include <vector>
 
+#include <opencode/compact.hpp>
 #include <opencode/events.hpp>
+#include <opencode/pty_channel.hpp>
 #include <opencode/session.hpp>
 #include <opencode/transport.hpp>
 #include <opencode/types.hpp>
@@ -18,11 +27,43 @@ namespace opencode
 
 // Forward declarations
 class Server;
+class ServerLease;
 
 // =============================================================================
 // Client Options
 // =============================================================================
 
+/// Client-side cache of slow-changing metadata (providers, agents, config, ...)
+///
+/// Off by default. Each endpoint keeps its last response for its lifetime;
+/// a zero lifetime leaves that endpoint uncached.
+struct MetadataCacheOptions
+{
+    /// Serve repeated metadata calls from the cache
+    bool enabled = false;
+
+    std::chrono::seconds providers{300};  ///< list_providers()
+    std::chrono::seconds modes{300};      ///< list_modes()
+    std::chrono::seconds agents{300};     ///< list_agents()
+    std::chrono::seconds tools{300};      ///< list_tools()
+    std::chrono::seconds tool_ids{300};   ///< list_tool_ids()
+    std::chrono::seconds config{60};      ///< get_config()
+    std::chrono::seconds project{60};     ///< current_project()
+
+    /// Listen on the event stream and drop entries the server reports as changed
+    /// (project.updated, server.instance.disposed, global.disposed). Calls go
+    /// to the server, uncached, while the stream is not connected.
+    bool invalidate_on_events = true;
+};
+
+/// Metadata cache counters
+struct MetadataCacheStats
+{
+    uint64_t hits = 0;           ///< Calls answered from the cache
+    uint64_t misses = 0;         ///< Calls that went to the server
+    uint64_t invalidations = 0;  ///< Entries dropped before they expired
+};
+
 struct ClientOptions
 {
     /// Explicit server URL - if set, connects to this URL instead of spawning
@@ -52,6 +93,98 @@ struct ClientOptions
 
     /// Read timeout in seconds
     int read_timeout = 300;
+
+    /// Maximum concurrent keep-alive connections to the server
+    /// Calls from more threads than this wait for a free connection
+    int max_connections = 8;
+
+    /// Close pooled connections idle for longer than this, in seconds
+    int idle_connection_timeout = 60;
+
+    /// Ask the server for compressed responses (gzip/deflate/br, as built into httplib)
+    bool compression = true;
+
+    /// Bytes of GET responses kept for ETag / Last-Modified revalidation (0 disables)
+    size_t response_cache_bytes = 4 * 1024 * 1024;
+
+    /// Let concurrent identical reads share one request
+    /// list_sessions(), lsp_status(), mcp_status() and read_file() calls made
+    /// while the same call is already in flight wait for its result instead of
+    /// sending their own; they may therefore see data from just before they
+    /// were called.
+    bool coalesce_reads = true;
+
+    /// Worker threads serving the *_async() calls (started on first use)
+    /// send_message_async() only submits its prompt there; see the Async API section.
+    int async_threads = 4;
+
+    /// Caching of list_providers(), get_config(), current_project(), ...
+    MetadataCacheOptions metadata_cache;
+
+    /// Reconnection of the shared /event stream after a drop or silence
+    SSEReconnectOptions sse_reconnect;
+
+    /// Receives request timings, SSE traffic, parse times and event queue depths
+    /// (e.g. a MetricsRegistry); not applied to a transport passed to the Client
+    std::shared_ptr<TransportObserver> observer;
+};
+
+// =============================================================================
+// Per-call Cancellation
+// =============================================================================
+
+/// Cancellation and deadline of one call
+///
+/// Either ends the call's HTTP exchange at once: the socket is shut down,
+/// the pooled connection is dropped (freeing its slot) and the call throws
+/// CallCancelled. A call still waiting for a free connection gives up too.
+///
+/// Example usage:
+/// @code
+/// std::stop_source stop;
+/// auto reply = client.send_message_async(session_id, prompt, {}, {},
+///                                        {.cancel = stop.get_token(), .abort_session = true});
+/// // From any thread:
+/// stop.request_stop();
+/// @endcode
+struct CallOptions
+{
+    /// Cancels the call when stop is requested on its std::stop_source
+    std::stop_token cancel;
+
+    /// Give up once this time has passed (async calls count their time queued)
+    /// send_message_async() and event-driven streaming notice it as events arrive.
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    /// send_message(): also ask the server to abort the session's generation
+    bool abort_session = false;
+
+    /// Options with a deadline timeout from now
+    static CallOptions within(std::chrono::milliseconds timeout)
+    {
+        CallOptions options;
+        options.deadline = std::chrono::steady_clock::now() + timeout;
+        return options;
+    }
+};
+
+/// Thrown by a call ended through its CallOptions
+class CallCancelled : public std::runtime_error
+{
+  public:
+    explicit CallCancelled(bool timed_out)
+        : std::runtime_error(timed_out ? "Call deadline exceeded" : "Call canceled"), timed_out_(timed_out)
+    {
+    }
+
+    /// Whether the deadline passed, rather than the token being stopped
+    bool timed_out() const
+    {
+        return timed_out_;
+    }
+
+  private:
+    bool timed_out_;
 };
 
 // =============================================================================
@@ -108,6 +241,28 @@ class MessageStream
 // Event Stream (for SSE events)
 // =============================================================================
 
+/// What an EventStream does with a new event when its queue is full
+enum class OverflowPolicy
+{
+    Block,          // Stall the shared SSE reader until the consumer catches up
+    DropOldest,     // Discard the oldest queued event
+    DropHeartbeats, // Discard a queued (or the incoming) heartbeat, else the oldest event
+    CoalesceDeltas  // Merge consecutive deltas of one part, else discard the oldest event
+};
+
+struct EventStreamOptions
+{
+    size_t capacity = 0; // Max queued events (0 = unbounded)
+    OverflowPolicy overflow = OverflowPolicy::Block;
+};
+
+struct EventStreamStats
+{
+    uint64_t dropped = 0;   // Events discarded by the overflow policy
+    uint64_t coalesced = 0; // Deltas merged into an already queued event
+    size_t queued = 0;      // Events waiting to be read
+};
+
 /// Stream of events from the server (SSE)
 class EventStream
 {
@@ -146,10 +301,61 @@ class EventStream
     Iterator begin();
     Iterator end();
     std::optional<Event> next();
+
+    /// Wait for events and move up to out.size() of them into out
+    /// @return Number of events written; 0 once the stream has ended
+    size_t next_batch(std::span<Event> out);
+
+    /// Wait for events and return every one pending (empty once the stream has ended)
+    std::vector<Event> drain();
+
     void close();
 
+    /// Overflow counters and current queue depth
+    EventStreamStats stats() const;
+
+  private:
+    friend class Client;
+    struct Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+// =============================================================================
+// Message Cache
+// =============================================================================
+
+/// Local copy of one session's message history
+///
+/// The first read downloads the history once; after that message.updated,
+/// message.part.updated, message.removed and message.part.removed events from
+/// the client's shared event stream keep it current, so reads cost only the
+/// messages they return. If the event stream drops or reconnects (updates
+/// sent in between are lost), or is not live within connection_timeout of a
+/// download, the next read downloads the history again. Parts that arrive
+/// before their message.updated are held until it says whose they are.
+/// Created by Client::message_cache().
+class MessageCache
+{
+  public:
+    ~MessageCache();
+    MessageCache(const MessageCache&) = delete;
+    MessageCache& operator=(const MessageCache&) = delete;
+    MessageCache(MessageCache&&) noexcept;
+    MessageCache& operator=(MessageCache&&) noexcept;
+
+    /// Messages in the given window (default: the whole history)
+    /// An unknown before/after cursor yields no messages.
+    std::vector<MessageWithParts> messages(const MessagePage& page = {});
+
+    /// Number of cached messages (0 before the first read)
+    size_t size() const;
+
+    /// Discard the cached history; the next read downloads it again
+    void invalidate();
+
   private:
     friend class Client;
+    MessageCache();
     struct Impl;
     std::shared_ptr<Impl> impl_;
 };
@@ -194,6 +400,10 @@ class Client
     /// Create a client with a custom transport (for testing)
     Client(ClientOptions opts, std::unique_ptr<Transport> transport);
 
+    /// Create a client on a server leased from a ServerPool
+    /// The lease is held for the client's lifetime; opts.base_url is ignored.
+    explicit Client(ServerLease lease, ClientOptions opts = {});
+
     ~Client();
 
     Client(const Client&) = delete;
@@ -211,6 +421,11 @@ class Client
     /// Get the server URL
     std::string server_url() const;
 
+    /// Number of replies this client is waiting for
+    /// Counts send_message() calls, async ones from submission, and
+    /// send_message_streaming() calls that have not completed yet.
+    size_t generations_in_flight() const;
+
     /// Check server health
     /// @return Health information
     /// @throws std::runtime_error on error
@@ -248,38 +463,122 @@ class Client
     /// @param prompt User prompt text
     /// @param provider_id Optional provider ID (e.g., "anthropic", "openai")
     /// @param model_id Optional model ID (e.g., "claude-sonnet-4", "gpt-4o")
+    /// @param call Cancellation and deadline (throws CallCancelled when they end the call)
     /// @return Complete assistant message with parts
     MessageWithParts send_message(
         const std::string& session_id,
         const std::string& prompt,
         const std::string& provider_id = {},
-        const std::string& model_id = {}
+        const std::string& model_id = {},
+        const CallOptions& call = {}
     );
 
     /// Send a message with streaming callbacks
-    /// Subscribes to SSE events to receive part updates in real-time
+    /// Receives part updates in real-time from the client's shared event stream.
+    /// Blocks until the reply is complete unless options.event_driven is set,
+    /// in which case the prompt goes through /prompt_async and this returns at once.
     /// @param session_id Session ID
     /// @param prompt User prompt text
     /// @param provider_id Optional provider ID
     /// @param model_id Optional model ID
     /// @param options Streaming callbacks (on_part, on_complete, on_error)
+    /// @param call Cancellation and deadline, reported through on_error. An
+    ///        event-driven call notices its deadline only as events arrive.
     void send_message_streaming(
         const std::string& session_id,
         const std::string& prompt,
         const std::string& provider_id,
         const std::string& model_id,
-        StreamOptions options
+        StreamOptions options,
+        const CallOptions& call = {}
     );
 
     /// Get messages for a session
     /// @param session_id Session ID
     /// @param limit Optional limit on number of messages
+    /// @param call Cancellation and deadline
     /// @return Vector of messages with parts
     std::vector<MessageWithParts> get_messages(
+        const std::string& session_id,
+        std::optional<int> limit = std::nullopt,
+        const CallOptions& call = {}
+    );
+
+    /// Get messages for a session as a compact, arena-backed history
+    /// Far fewer allocations than get_messages() for long histories; use
+    /// expand() to turn a message back into a MessageWithParts.
+    /// @param session_id Session ID
+    /// @param limit Optional limit on number of messages
+    CompactHistory get_messages_compact(
         const std::string& session_id,
         std::optional<int> limit = std::nullopt
     );
 
+    // =========================================================================
+    // Async API
+    // =========================================================================
+    //
+    // Non-blocking variants of the core calls. Each runs the blocking call on
+    // the client's worker pool (ClientOptions::async_threads) over the pooled
+    // transport; errors are rethrown from future::get(). send_message_async()
+    // only submits its prompt there, through /prompt_async; the reply is taken
+    // from the client's shared event stream, so pending replies hold no
+    // thread and never hold up the pool. The client may be moved while calls
+    // are pending but must outlive them - destroying the client waits for them.
+
+    /// Send a message without blocking
+    /// Works like send_message_streaming() with StreamOptions::event_driven.
+    /// @return Future for the complete assistant message; it holds an error if
+    ///         the prompt is refused, the session reports one, or the event
+    ///         stream ends first, and CallCancelled if call ends it
+    std::future<MessageWithParts> send_message_async(
+        const std::string& session_id,
+        const std::string& prompt,
+        const std::string& provider_id = {},
+        const std::string& model_id = {},
+        const CallOptions& call = {}
+    );
+
+    /// Get messages for a session without blocking
+    std::future<std::vector<MessageWithParts>> get_messages_async(
+        const std::string& session_id,
+        std::optional<int> limit = std::nullopt,
+        const CallOptions& call = {}
+    );
+
+    /// Create a session without blocking
+    std::future<Session> create_session_async(const std::string& title = {});
+
+    /// List sessions without blocking
+    std::future<std::vector<SessionInfo>> list_sessions_async();
+
+    /// Abort a session's current operation without blocking
+    std::future<bool> abort_session_async(const std::string& session_id);
+
+    /// Read a file without blocking
+    std::future<FileContent> read_file_async(const std::string& path, const CallOptions& call = {});
+
+    /// Search for text without blocking
+    std::future<TextSearchResult> find_text_async(const TextSearchOptions& options, const CallOptions& call = {});
+
+    // =========================================================================
+    // Batch
+    // =========================================================================
+
+    /// Send many prompts concurrently, across sessions and provider/model pairs
+    /// Blocks until every item has completed. A failing item is reported in its
+    /// result and does not stop the others.
+    /// @param items Prompts to send (an empty session_id creates a new session)
+    /// @param options Concurrency limit and per-item completion callback
+    /// @param call Cancellation and deadline of the whole batch; items in
+    ///        flight end with an error, and items not started yet fail at once
+    /// @return One result per item, in input order
+    std::vector<BatchResult> send_batch(
+        std::span<const BatchItem> items,
+        const BatchOptions& options = {},
+        const CallOptions& call = {}
+    );
+
     // =========================================================================
     // Session Control (low-level API)
     // =========================================================================
@@ -367,8 +666,32 @@ class Client
     // =========================================================================
 
     /// Subscribe to server events (SSE)
+    /// All streams of a client share one /event connection; events rejected
+    /// by the filter are dropped before they are parsed or decoded
+    /// @param filter Event types and sessions to receive (default: everything)
+    /// @param options Queue capacity and overflow policy (default: unbounded).
+    ///        OverflowPolicy::Block stalls every stream of this client while
+    ///        this one is full.
+    /// @return Event stream
+    EventStream subscribe_events(const EventFilter& filter = {}, const EventStreamOptions& options = {});
+
+    /// Subscribe to the events of several clients as one stream
+    /// Each client's events stay in order; there is no order between clients.
+    /// The stream ends once every client's event connection has ended.
+    /// @param clients Clients to merge (must not be empty)
+    /// @param filter Event types and sessions to receive, applied on every client
+    /// @param options Queue capacity and overflow policy of the merged queue
     /// @return Event stream
-    EventStream subscribe_events();
+    static EventStream subscribe_events(
+        std::span<Client* const> clients,
+        const EventFilter& filter = {},
+        const EventStreamOptions& options = {}
+    );
+
+    /// Open a message cache for a session, kept current by server events
+    /// @param session_id Session ID
+    /// @return Cache; the history is downloaded on its first read
+    MessageCache message_cache(const std::string& session_id);
 
     // =========================================================================
     // File Operations
@@ -381,22 +704,84 @@ class Client
 
     /// Read a file's content
     /// @param path File path
+    /// @param call Cancellation and deadline; a bounded call skips read coalescing
     /// @return File content
-    FileContent read_file(const std::string& path);
+    FileContent read_file(const std::string& path, const CallOptions& call = {});
+
+    /// Read a file's content in pieces as the response arrives
+    /// Neither the response nor the content is held in memory as a whole;
+    /// reading stops at the end of the range or when on_chunk returns false.
+    /// @param path File path
+    /// @param on_chunk Callback for each piece of content
+    /// @param range Part of the content to deliver (default: all of it)
+    /// @param call Cancellation and deadline (pieces already delivered stay delivered)
+    /// @return Path and encoding; content is left empty
+    FileContent read_file_stream(const std::string& path, const FileChunkCallback& on_chunk,
+                                 const FileRange& range = {}, const CallOptions& call = {});
+
+    /// Read part of a file straight into a caller-provided buffer
+    /// @param path File path
+    /// @param buffer Destination; at most buffer.size() bytes are read
+    /// @param offset Offset of the first byte to read
+    /// @return Bytes written (fewer than buffer.size() at the end of the file)
+    size_t read_file_into(const std::string& path, std::span<char> buffer, size_t offset = 0);
+
+    /// Write a file's content to a file descriptor as it arrives
+    /// @param path File path
+    /// @param fd Open, writable file descriptor (not closed)
+    /// @param range Part of the content to write (default: all of it)
+    /// @return Bytes written
+    size_t read_file_to(const std::string& path, int fd, const FileRange& range = {});
 
     /// Get file's git status
     /// @param path File path
     /// @return File status
     FileStatus file_status(const std::string& path);
 
+    /// Read many files concurrently over the connection pool
+    /// A failing path is reported in its result and does not stop the others.
+    /// @param paths File paths
+    /// @param options Concurrency limit and per-file completion callback
+    /// @return One result per path, in input order
+    std::vector<FileReadResult> read_files(
+        std::span<const std::string> paths,
+        const FileBatchOptions<FileContent>& options = {}
+    );
+
+    /// Get the git status of many files concurrently over the connection pool
+    /// @param paths File paths
+    /// @param options Concurrency limit and per-file completion callback
+    /// @return One result per path, in input order
+    std::vector<FileStatusResult> file_statuses(
+        std::span<const std::string> paths,
+        const FileBatchOptions<FileStatus>& options = {}
+    );
+
     // =========================================================================
     // Find Operations
     // =========================================================================
 
     /// Search for text in files
     /// @param options Search options
+    /// @param call Cancellation and deadline
     /// @return Search results
-    TextSearchResult find_text(const TextSearchOptions& options);
+    TextSearchResult find_text(const TextSearchOptions& options, const CallOptions& call = {});
+
+    /// Search for text, receiving each match as its bytes arrive
+    /// Matches are not collected, so memory does not grow with the result set.
+    /// @param options Search options
+    /// @param on_match Callback for each match (return false to stop)
+    /// @param stream Match count at which to stop
+    /// @param call Cancellation and deadline; a passed deadline ends the search
+    ///        early instead of throwing, while a stop request throws CallCancelled
+    /// @return Totals with an empty matches vector; truncated is set when the
+    ///         search stopped early (callback, max_matches or deadline)
+    TextSearchResult find_text_stream(
+        const TextSearchOptions& options,
+        const TextMatchCallback& on_match,
+        const TextSearchStreamOptions& stream = {},
+        const CallOptions& call = {}
+    );
 
     /// Find files by glob pattern
     /// @param options Search options
@@ -442,6 +827,7 @@ class Client
     Config get_config();
 
     /// Update configuration
+    /// The result replaces any cached get_config() response
     /// @param updates Config updates (only set fields are updated)
     /// @return Updated config
     Config update_config(const ConfigUpdate& updates);
@@ -588,6 +974,12 @@ class Client
     /// Get client options
     const ClientOptions& options() const;
 
+    /// Hit/miss counters of the metadata cache (all zero when it is disabled)
+    MetadataCacheStats metadata_cache_stats() const;
+
+    /// Drop every cached metadata response; the next calls go to the server
+    void invalidate_metadata();
+
     // =========================================================================
     // TUI (Terminal UI)
     // =========================================================================
@@ -636,6 +1028,7 @@ class Client
     void tui_clear();
 
     /// Get current TUI render (visual state)
+    /// Pass successive renders to TuiScreen::update() to find the rows that changed.
     /// @return TUI render with lines and size
     TuiRender tui_render();
 
@@ -664,6 +1057,14 @@ class Client
     /// @return Updated PTY session info
     PtySession pty_resize(const std::string& pty_id, int cols, int rows);
 
+    /// Open a channel for interactive I/O on a PTY session
+    /// Writes are coalesced into few requests; output is streamed to
+    /// options.on_output over a persistent connection.
+    /// @param pty_id PTY session ID
+    /// @param options Batching and output callbacks
+    /// @return Channel; must not outlive this Client
+    PtyChannel open_pty_channel(const std::string& pty_id, PtyChannelOptions options = {});
+
     /// Close a PTY session
     /// @param pty_id PTY session ID
     /// @return true if successfully closed
@@ -0,0 +1,159 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <opencode/client.hpp>
+#include <opencode/server.hpp>
+
+namespace opencode
+{
+
+/// Options for a ClusterClient
+struct ClusterOptions
+{
+    /// Servers already running (e.g., "http://127.0.0.1:4096")
+    std::vector<std::string> urls;
+
+    /// Servers to spawn in addition to urls, with Server::spawn(server)
+    /// Their ports are always OS-assigned.
+    size_t spawn = 0;
+
+    /// Template for spawned servers
+    ServerOptions server;
+
+    /// Options for the client of each server; base_url is set per server
+    ClientOptions client;
+};
+
+/// Load of one server of a ClusterClient
+struct ClusterMemberStats
+{
+    std::string url;
+    size_t sessions = 0;    ///< Sessions this cluster client routes to the server
+    size_t generations = 0; ///< Replies in flight (Client::generations_in_flight())
+};
+
+/// Client spreading sessions across several OpenCode servers
+///
+/// New sessions go to the server with the fewest replies in flight (ties go
+/// to the one with fewer sessions), and every call on a session goes to the
+/// server that owns it. Sessions created elsewhere are found by asking each
+/// server once. Listings and event streams are merged across servers.
+///
+/// Example usage:
+/// @code
+/// opencode::ClusterClient cluster({.spawn = 4});
+///
+/// std::vector<std::future<opencode::MessageWithParts>> replies;
+/// for (const auto& prompt : prompts)
+/// {
+///     auto session = cluster.create_session();
+///     replies.push_back(cluster.send_message_async(session.id(), prompt));
+/// }
+/// @endcode
+class ClusterClient
+{
+  public:
+    /// Connect to opts.urls and spawn opts.spawn servers
+    /// @throws std::runtime_error if there are no servers, a URL is given
+    ///         twice, or a server cannot be reached or started
+    explicit ClusterClient(ClusterOptions opts);
+
+    /// Closes the clients, then stops the spawned servers
+    ~ClusterClient();
+
+    // Non-copyable, movable
+    ClusterClient(const ClusterClient&) = delete;
+    ClusterClient& operator=(const ClusterClient&) = delete;
+    ClusterClient(ClusterClient&&) noexcept;
+    ClusterClient& operator=(ClusterClient&&) noexcept;
+
+    // =========================================================================
+    // Members
+    // =========================================================================
+
+    /// Number of servers
+    size_t size() const;
+
+    /// Client of server i (0 <= i < size())
+    Client& member(size_t i);
+
+    /// Client of the server that owns a session
+    /// @throws std::runtime_error if no server has the session
+    Client& client_for(const std::string& session_id);
+
+    /// Load of every server, in member order
+    std::vector<ClusterMemberStats> stats() const;
+
+    // =========================================================================
+    // Session Operations
+    // =========================================================================
+
+    /// Create a session on the least loaded server
+    /// @param title Optional session title
+    /// @return Session bound to the owning server's client
+    Session create_session(const std::string& title = {});
+
+    /// Get an existing session from the server that owns it
+    Session get_session(const std::string& session_id);
+
+    /// List the sessions of every server, each session once
+    std::vector<SessionInfo> list_sessions();
+
+    /// Delete a session on the server that owns it
+    bool delete_session(const std::string& session_id);
+
+    /// Abort a session's current operation
+    bool abort_session(const std::string& session_id);
+
+    // =========================================================================
+    // Messages
+    // =========================================================================
+
+    /// Send a message to a session on the server that owns it
+    MessageWithParts send_message(
+        const std::string& session_id,
+        const std::string& prompt,
+        const std::string& provider_id = {},
+        const std::string& model_id = {},
+        const CallOptions& call = {}
+    );
+
+    /// Send a message without blocking, on the owning server's worker pool
+    std::future<MessageWithParts> send_message_async(
+        const std::string& session_id,
+        const std::string& prompt,
+        const std::string& provider_id = {},
+        const std::string& model_id = {},
+        const CallOptions& call = {}
+    );
+
+    /// Get messages for a session from the server that owns it
+    std::vector<MessageWithParts> get_messages(
+        const std::string& session_id,
+        std::optional<int> limit = std::nullopt,
+        const CallOptions& call = {}
+    );
+
+    // =========================================================================
+    // Events
+    // =========================================================================
+
+    /// Subscribe to the events of every server as one stream
+    /// See Client::subscribe_events(std::span<Client* const>, ...).
+    EventStream subscribe_events(const EventFilter& filter = {}, const EventStreamOptions& options = {});
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace opencode
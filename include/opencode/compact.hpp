@@ -0,0 +1,196 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <opencode/types.hpp>
+
+namespace opencode
+{
+
+// =============================================================================
+// Compact Messages
+// =============================================================================
+//
+// A read-only, arena-backed form of MessageWithParts for holding long
+// histories. Strings are views into the owning CompactHistory's arena, IDs
+// and other repeated values (session, model, agent, tool names) are interned
+// once, part types come from the variant index instead of a string, and tool
+// input is a flat array. The history's memory is released in one go.
+
+/// Part kinds, in the order of Part's alternatives
+enum class PartKind : uint8_t
+{
+    Text,
+    File,
+    Tool,
+    Reasoning
+};
+
+static_assert(std::variant_size_v<Part> == 4, "PartKind must list every Part alternative");
+
+/// The kind of a part, from its variant index
+inline PartKind part_kind(const Part& part)
+{
+    return static_cast<PartKind>(part.index());
+}
+
+/// The wire type of a part kind ("text", "file", "tool" or "reasoning")
+constexpr std::string_view part_type(PartKind kind)
+{
+    switch (kind)
+    {
+    case PartKind::Text:
+        return "text";
+    case PartKind::File:
+        return "file";
+    case PartKind::Tool:
+        return "tool";
+    case PartKind::Reasoning:
+        return "reasoning";
+    }
+    return "text";
+}
+
+struct CompactToolInput
+{
+    std::string_view key;
+    std::string_view value; // Non-string values as JSON text
+};
+
+/// One part; which members are used depends on kind
+struct CompactPart
+{
+    PartKind kind = PartKind::Text;
+    std::string_view id;
+    std::string_view text;                  // Text and Reasoning text, File name, Tool name
+    std::optional<std::string_view> content; // File content
+    std::span<const CompactToolInput> input; // Tool input, in server order
+    std::optional<std::string_view> status;  // Tool state status, if the tool has a state
+    std::optional<std::string_view> error;   // Tool state error
+
+    std::string_view type() const
+    {
+        return part_type(kind);
+    }
+};
+
+struct CompactMessage
+{
+    bool assistant = false;
+    std::string_view id;
+    std::string_view session_id;
+    TimeInfo time;
+    std::string_view agent;
+    std::string_view model_id;    // User: model.model_id
+    std::string_view provider_id; // User: model.provider_id
+    std::span<const CompactPart> parts;
+
+    // Assistant only
+    std::string_view parent_id;
+    std::string_view mode;
+    std::string_view cwd;  // path.cwd
+    std::string_view root; // path.root
+    double cost = 0.0;
+    TokenInfo tokens;
+    std::optional<std::string_view> finish;
+    std::optional<bool> summary;
+
+    // User only
+    std::optional<std::string_view> system;
+    std::optional<std::string_view> variant;
+
+    std::string_view role() const
+    {
+        return assistant ? "assistant" : "user";
+    }
+};
+
+/// Arena holding compact messages and everything they point to
+///
+/// Views returned by the history stay valid until clear() or destruction;
+/// moving the history keeps them valid. Not thread-safe.
+///
+/// Example:
+/// @code
+/// auto history = client.get_messages_compact(session_id);
+/// for (const auto& message : history.messages())
+///     for (const auto& part : message.parts)
+///         if (part.kind == opencode::PartKind::Text)
+///             std::cout << part.text << "\n";
+/// @endcode
+class CompactHistory
+{
+  public:
+    /// @param initial_bytes Size of the arena's first block
+    explicit CompactHistory(size_t initial_bytes = 64 * 1024);
+    ~CompactHistory();
+
+    CompactHistory(const CompactHistory&) = delete;
+    CompactHistory& operator=(const CompactHistory&) = delete;
+    CompactHistory(CompactHistory&&) noexcept;
+    CompactHistory& operator=(CompactHistory&&) noexcept;
+
+    /// Copy a message into the arena
+    /// @return The stored message (valid until the next add/push)
+    const CompactMessage& add(const MessageWithParts& message);
+
+    /// Append a message whose views already point into this arena
+    const CompactMessage& push(const CompactMessage& message);
+
+    /// Stored messages, in the order they were added
+    std::span<const CompactMessage> messages() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    /// Copy a string into the arena
+    std::string_view copy(std::string_view text);
+
+    /// Copy a string into the arena once; equal strings share one copy
+    std::string_view intern(std::string_view text);
+
+    /// Value-initialized storage for count objects in the arena
+    template <typename T>
+    std::span<T> allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "The arena never runs destructors");
+        if (count == 0)
+            return {};
+        auto* data = static_cast<T*>(allocate_bytes(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; ++i)
+            new (data + i) T();
+        return {data, count};
+    }
+
+    /// Bytes the arena has reserved from the heap
+    size_t bytes() const;
+
+    /// Number of distinct interned strings
+    size_t interned() const;
+
+    /// Drop all messages and strings; every view becomes invalid
+    void clear();
+
+  private:
+    void* allocate_bytes(size_t bytes, size_t alignment);
+
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/// Convert a compact message back to the regular owning type
+MessageWithParts expand(const CompactMessage& message);
+
+} // namespace opencode
@@ -4,8 +4,14 @@
 #pragma once
 
 #include <opencode/types.hpp>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 namespace opencode
 {
@@ -100,6 +106,7 @@ struct MessagePartUpdatedEvent
     std::string session_id;
     std::string message_id;
     Part part;
+    std::optional<std::string> delta; // Text appended since the previous update, if sent
 };
 
 struct MessagePartRemovedEvent
@@ -164,6 +171,23 @@ struct InstallationUpdateAvailableEvent
     std::string version;
 };
 
+// =============================================================================
+// TUI Events
+// =============================================================================
+
+/// Lines of the TUI screen that changed in frame `seq`, relative to frame seq - 1
+///
+/// Current OpenCode servers do not publish "tui.render.diff"; this is the
+/// shape the client expects from a server or proxy that does. Without one,
+/// TuiScreen::update() works out the same changes from successive snapshots.
+struct TuiRenderDiffEvent
+{
+    static constexpr const char* type = "tui.render.diff";
+    uint64_t seq = 0;
+    TuiSize size;                      // Screen size in this frame (0 = unchanged)
+    std::vector<TuiLineChange> lines;  // Changed rows only
+};
+
 // =============================================================================
 // Combined Event Type
 // =============================================================================
@@ -195,9 +219,42 @@ using Event = std::variant<
     FileEditedEvent,
     // Installation
     InstallationUpdatedEvent,
-    InstallationUpdateAvailableEvent
+    InstallationUpdateAvailableEvent,
+    // TUI
+    TuiRenderDiffEvent
 >;
 
+// =============================================================================
+// Event Filter
+// =============================================================================
+
+/// Selects the events a subscription receives
+///
+/// Frames that do not match are dropped after a cheap look at their "type"
+/// (and, when needed, session) field, before the payload is fully parsed or
+/// decoded. An empty filter receives everything.
+///
+/// Usage: client.subscribe_events(EventFilter::of<PermissionAskedEvent>());
+struct EventFilter
+{
+    std::set<std::string, std::less<>> types;       // Event types (empty = all)
+    std::set<std::string, std::less<>> session_ids; // Sessions (empty = all, including server-wide events)
+
+    /// Filter on the given event types
+    template <typename... Events>
+    static EventFilter of()
+    {
+        EventFilter filter;
+        (filter.types.emplace(Events::type), ...);
+        return filter;
+    }
+
+    bool accepts_type(std::string_view type) const
+    {
+        return types.empty() || types.contains(type);
+    }
+};
+
 // =============================================================================
 // Event Helpers
 // =============================================================================
@@ -236,4 +293,103 @@ const T& as(const Event& event)
     return std::get<T>(event);
 }
 
+// =============================================================================
+// TUI Screen
+// =============================================================================
+
+/// Client-side copy of the TUI screen and the rows that changed in its last frame
+///
+/// Against current servers, feed it successive Client::tui_render() snapshots
+/// through update(), which compares each one with the screen it replaces.
+/// With a server that publishes TuiRenderDiffEvent, apply() those instead:
+/// subscribe before taking the first snapshot so no frame falls between the
+/// two; diffs older than the snapshot are ignored.
+///
+/// Example usage:
+/// @code
+/// TuiScreen screen;
+/// for (;;) {
+///     if (screen.update(client.tui_render())) {
+///         if (screen.full_redraw())
+///             redraw(screen.lines());
+///         else
+///             redraw(screen.lines(), screen.changed_rows());
+///     }
+///     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+/// }
+/// @endcode
+///
+/// With diff events:
+/// @code
+/// auto diffs = client.subscribe_events(EventFilter::of<TuiRenderDiffEvent>());
+/// TuiScreen screen;
+/// screen.reset(client.tui_render());
+///
+/// for (const auto& event : diffs) {
+///     if (!screen.apply(as<TuiRenderDiffEvent>(event)))
+///         screen.reset(client.tui_render());  // Missed a frame: resync
+///     ...
+/// }
+/// @endcode
+class TuiScreen
+{
+  public:
+    /// Replace the contents with a full snapshot (e.g. from Client::tui_render())
+    /// Without a snapshot seq, the next diff is applied whatever its number.
+    void reset(TuiRender render);
+
+    /// Replace the contents with a newer snapshot, recording the rows that differ
+    /// A snapshot whose seq is not past the current one is ignored.
+    /// @return true if anything changed on screen
+    bool update(TuiRender render);
+
+    /// Apply the diff for the next frame
+    /// @return false if frames were missed in between; the screen is left
+    ///         unchanged and needs reset() with a fresh snapshot
+    bool apply(const TuiRenderDiffEvent& diff);
+
+    /// Current lines
+    const std::vector<std::string>& lines() const
+    {
+        return render_.lines;
+    }
+
+    /// Current size
+    const TuiSize& size() const
+    {
+        return render_.size;
+    }
+
+    /// Frame shown, if known
+    std::optional<uint64_t> seq() const
+    {
+        return render_.seq;
+    }
+
+    /// Rows changed by the last reset(), update() or apply() (every row after reset())
+    /// Rows a resize added are included, in ascending order.
+    const std::vector<int>& changed_rows() const
+    {
+        return changed_;
+    }
+
+    /// Whether the last reset(), update() or apply() changed the size or dropped rows
+    /// Rows past the new height are gone, so the whole screen should be redrawn.
+    bool full_redraw() const
+    {
+        return full_redraw_;
+    }
+
+    /// The current screen as a TuiRender
+    const TuiRender& snapshot() const
+    {
+        return render_;
+    }
+
+  private:
+    TuiRender render_;
+    std::vector<int> changed_;
+    bool full_redraw_ = false;
+};
+
 } // namespace opencode
@@ -0,0 +1,75 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <opencode/transport.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace opencode
+{
+
+/// Collects client metrics and exports them as Prometheus text
+///
+/// Install it through ClientOptions::observer (or HttpTransport::set_observer)
+/// and serve prometheus_text() from a scrape endpoint. It records:
+///   - opencode_http_request_duration_seconds / _time_to_first_byte_seconds:
+///     histograms per method and endpoint
+///   - opencode_http_requests_total (by status), _sent_bytes_total,
+///     _received_bytes_total, _connection_wait_seconds_total,
+///     _reused_connections_total, _revalidated_total
+///   - opencode_sse_events_total, _bytes_total, _connects_total,
+///     _reconnects_total per stream path; events per second is their rate()
+///   - opencode_json_parse_seconds histogram and _parsed_bytes_total per kind
+///   - opencode_event_queue_depth / _max gauges and _queued_total
+///
+/// Endpoints are normalized so IDs don't create a series per resource:
+/// "/session/ses_01J9/message?limit=5" is reported as "/session/{id}/message",
+/// "/mcp/github/connect" as "/mcp/{id}/connect" and "/file/src/main.cpp" as
+/// "/file/{path}".
+///
+/// Thread-safe.
+///
+/// Example:
+/// @code
+/// auto metrics = std::make_shared<opencode::MetricsRegistry>();
+/// opencode::Client client({.observer = metrics});
+/// ...
+/// std::cout << metrics->prometheus_text();
+/// @endcode
+class MetricsRegistry : public TransportObserver
+{
+  public:
+    MetricsRegistry();
+    ~MetricsRegistry() override;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    void on_request(const RequestMetrics& metrics) override;
+    void on_sse_connect(std::string_view path, bool reconnect) override;
+    void on_sse_event(std::string_view path, size_t bytes) override;
+    void on_parse(std::string_view kind, size_t bytes, std::chrono::nanoseconds elapsed) override;
+    void on_event_queued(size_t depth) override;
+
+    /// Render all metrics in the Prometheus text exposition format (0.0.4)
+    std::string prometheus_text() const;
+
+    /// Forget everything recorded so far
+    void reset();
+
+    /// Normalize a request path: drop the query and fragment, collapse the file
+    /// path after "/file/" into {path} and replace ID segments with {id}
+    /// A segment counts as an ID if it follows a collection such as "session",
+    /// "pty" or "mcp", or if it contains a digit or an underscore.
+    static std::string endpoint(std::string_view path);
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace opencode
@@ -24,7 +24,13 @@
 /// @endcode
 
 #include <opencode/client.hpp>
+#include <opencode/cluster_client.hpp>
+#include <opencode/compact.hpp>
 #include <opencode/events.hpp>
+#include <opencode/metrics.hpp>
+#include <opencode/part_store.hpp>
+#include <opencode/pty_channel.hpp>
 #include <opencode/server.hpp>
+#include <opencode/server_pool.hpp>
 #include <opencode/session.hpp>
 #include <opencode/types.hpp>
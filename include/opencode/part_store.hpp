@@ -0,0 +1,88 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <opencode/events.hpp>
+
+namespace opencode
+{
+
+// =============================================================================
+// Part Store
+// =============================================================================
+
+/// Accumulates the text of streaming parts, keyed by message and part ID
+///
+/// Deltas are appended into pre-reserved buffers that grow geometrically.
+/// A buffer is never written below its published size and never freed while
+/// its part lives, so every std::string_view the store hands out stays valid
+/// and unchanged until that part's message is compacted or erased, or the
+/// store is cleared. Outgrown buffers add up to about the size of the
+/// current one; compact() a finished message to release them.
+/// All members are thread-safe.
+///
+/// Example:
+/// @code
+/// opencode::PartStore store;
+/// for (const auto& event : client.subscribe_events(EventFilter::of<MessagePartUpdatedEvent>()))
+/// {
+///     auto text = store.apply(as<MessagePartUpdatedEvent>(event));
+///     render(text);  // Full text so far, no copy
+/// }
+/// @endcode
+class PartStore
+{
+  public:
+    /// @param initial_capacity Bytes reserved for a part's first buffer
+    explicit PartStore(size_t initial_capacity = 4096);
+    ~PartStore();
+
+    PartStore(const PartStore&) = delete;
+    PartStore& operator=(const PartStore&) = delete;
+
+    /// Add text to the end of a part
+    /// @return The part's full text after the append
+    std::string_view append(std::string_view message_id, std::string_view part_id, std::string_view delta);
+
+    /// Replace a part's text (an extension of the current text is appended)
+    /// @return The part's full text
+    std::string_view assign(std::string_view message_id, std::string_view part_id, std::string_view text);
+
+    /// Fold a message.part.updated event in: its delta if it has one, else
+    /// the text of a text or reasoning part (reasoning is kept apart from text)
+    /// @return The part's full text (empty for parts without text)
+    std::string_view apply(const MessagePartUpdatedEvent& event);
+
+    /// Current text of a part, if the store has seen it
+    std::optional<std::string_view> text(std::string_view message_id, std::string_view part_id) const;
+
+    /// A message's text parts, joined in the order the parts first appeared
+    /// @param include_reasoning Also join the reasoning parts seen by apply()
+    std::string message_text(std::string_view message_id, bool include_reasoning = false) const;
+
+    /// Release the outgrown buffers of a message's parts, e.g. once it is done
+    /// Only views of each part's current text stay valid.
+    void compact(std::string_view message_id);
+
+    /// Drop a message's parts; views into them become invalid
+    void erase_message(std::string_view message_id);
+
+    /// Drop everything; all views become invalid
+    void clear();
+
+    /// Bytes held in buffers, including those backing older views
+    size_t bytes() const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace opencode
@@ -58,14 +58,21 @@ class ReadPipe
     size_t read(char* buffer, size_t size);
 
     /// Read a line (up to newline or max_size)
+    /// Reads ahead in chunks; later read() calls return the read-ahead first.
     /// @return Line including newline, or partial line on EOF
     std::string read_line(size_t max_size = 4096);
 
     /// Check if data is available without blocking
     /// @param timeout_ms Timeout in milliseconds (0 = non-blocking check)
-    /// @return true if data is available
+    /// @return true if data is available or the write end was closed
     bool has_data(int timeout_ms = 0);
 
+    /// Wait until at least one of several pipes has data (e.g. stdout and stderr)
+    /// @param pipes Pipes to watch; null or closed entries are skipped
+    /// @param timeout_ms Timeout in milliseconds (0 = non-blocking check, -1 = no timeout)
+    /// @return Indices into pipes of those with data or a closed write end; empty on timeout
+    static std::vector<size_t> wait_any(const std::vector<ReadPipe*>& pipes, int timeout_ms);
+
     /// Close the pipe
     void close();
 
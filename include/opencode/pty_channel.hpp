@@ -0,0 +1,113 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace opencode
+{
+
+// Forward declarations
+class Client;
+class Transport;
+
+/// Options for a PtyChannel
+struct PtyChannelOptions
+{
+    /// Longest input waits to be batched with more input before it is sent
+    /// While a write request is in flight, input keeps accumulating and goes
+    /// out in one request when it completes (Nagle-style).
+    std::chrono::milliseconds coalesce_window{2};
+
+    /// Send as soon as this many bytes are pending (also the largest request)
+    size_t max_batch_bytes = 64 * 1024;
+
+    /// Terminal output, called on the stream thread (unset = output is not streamed)
+    std::function<void(std::string_view data)> on_output;
+
+    /// Called once when the output stream ends (error is empty on a clean close,
+    /// e.g. when the server closes the socket because the PTY exited)
+    std::function<void(const std::string& error)> on_closed;
+};
+
+/// Counters of a PtyChannel
+struct PtyChannelStats
+{
+    uint64_t writes = 0;     ///< write() calls
+    uint64_t requests = 0;   ///< Batches sent to the server (WebSocket messages or write requests)
+    uint64_t bytes_sent = 0; ///< Input bytes sent
+};
+
+/// Interactive I/O on a PTY session
+///
+/// Input passed to write() is coalesced, so keystrokes typed in quick
+/// succession or a paste cost a few requests instead of one per call. Input
+/// is always delivered in order. Output is streamed from
+/// GET /pty/{id}/connect, which OpenCode upgrades to a WebSocket whose text
+/// messages are raw terminal output; the connection reconnects by itself.
+/// While it is up, input is sent over it too, as text messages (batches
+/// never split a UTF-8 sequence); otherwise with Client::pty_write().
+///
+/// Created via Client::open_pty_channel(); must not outlive the Client.
+///
+/// Example:
+/// @code
+/// auto pty = client.create_pty();
+/// auto channel = client.open_pty_channel(pty.id, {
+///     .on_output = [](std::string_view data) { std::cout << data << std::flush; }});
+///
+/// for (char key : keys)
+///     channel.write(std::string_view(&key, 1));
+/// channel.flush();
+/// @endcode
+class PtyChannel
+{
+  public:
+    PtyChannel() = default;
+
+    /// Sends pending input and stops the output stream
+    ~PtyChannel();
+
+    // Non-copyable, movable
+    PtyChannel(const PtyChannel&) = delete;
+    PtyChannel& operator=(const PtyChannel&) = delete;
+    PtyChannel(PtyChannel&&) noexcept;
+    PtyChannel& operator=(PtyChannel&&) noexcept;
+
+    /// Get the PTY session ID
+    const std::string& id() const;
+
+    /// Queue input for the PTY; returns without waiting for the server
+    /// @throws std::runtime_error if the channel is closed or an earlier write failed
+    void write(std::string_view data);
+
+    /// Wait until all queued input has been sent
+    /// @throws std::runtime_error if sending failed
+    void flush();
+
+    /// Resize the terminal, after the input queued so far
+    void resize(int cols, int rows);
+
+    /// Send pending input and stop the output stream
+    /// The PTY session itself stays open; use Client::close_pty() for that.
+    void close();
+
+    /// Get channel counters
+    PtyChannelStats stats() const;
+
+  private:
+    friend class Client;
+    PtyChannel(Client* client, std::string pty_id, std::unique_ptr<Transport> output, PtyChannelOptions options);
+
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace opencode
@@ -45,6 +45,11 @@ struct ServerOptions
 
     /// Timeout for waiting for server to start (default: 30 seconds)
     std::chrono::milliseconds startup_timeout{30000};
+
+    /// Also probe GET /global/health on hostname:port at this interval while
+    /// waiting for the listening message; whichever succeeds first wins.
+    /// Needs a fixed port (ignored when port is 0).
+    std::optional<std::chrono::milliseconds> health_probe_interval;
 };
 
 /// Manages a local OpenCode server process
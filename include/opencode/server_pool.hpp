@@ -0,0 +1,160 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <opencode/server.hpp>
+
+namespace opencode
+{
+
+class ServerLease;
+
+/// Options for a pool of prewarmed servers
+struct ServerPoolOptions
+{
+    /// Template for spawned servers; the port is always OS-assigned and the
+    /// working directory is the one a server is leased for
+    ServerOptions server;
+
+    /// Idle servers kept ready per working directory once it has been used
+    size_t warm_per_directory = 1;
+
+    /// Upper bound on servers, leased and idle, across all directories
+    size_t max_servers = 8;
+
+    /// Stop a server after it has been leased this many times (0 = never)
+    size_t max_leases_per_server = 50;
+
+    /// Stop a server whose resident memory exceeds this many bytes
+    /// Measured on Linux (/proc); ignored elsewhere
+    std::optional<size_t> max_rss_bytes;
+
+    /// How often idle servers are health-checked and the warm count restored
+    std::chrono::seconds maintenance_interval{10};
+
+    /// Stop idle servers beyond the warm count after this long unused
+    std::chrono::seconds max_idle{300};
+
+    /// How long lease() waits when max_servers are all leased
+    std::chrono::seconds lease_timeout{60};
+};
+
+/// Counters of a ServerPool
+struct ServerPoolStats
+{
+    size_t idle = 0;              ///< Servers ready to be leased
+    size_t leased = 0;            ///< Servers currently leased
+    size_t starting = 0;          ///< Servers being spawned
+    uint64_t spawned = 0;         ///< Servers started over the pool's lifetime
+    uint64_t recycled = 0;        ///< Servers stopped for their lease count or memory use
+    uint64_t health_failures = 0; ///< Servers dropped because they stopped answering
+};
+
+/// Keeps warm OpenCode servers per working directory and leases them out
+///
+/// A lease of an idle server costs one health check instead of a full server
+/// startup. A background thread restores the warm count after each lease,
+/// health-checks idle servers and stops the ones that are due for recycling.
+///
+/// Example usage:
+/// @code
+/// ServerPool pool({.warm_per_directory = 2});
+/// pool.prewarm("/my/project");
+///
+/// // Per job:
+/// Client client(pool.lease("/my/project"));
+/// auto session = client.create_session();
+/// @endcode
+class ServerPool
+{
+  public:
+    explicit ServerPool(ServerPoolOptions options = {});
+
+    /// Stops idle servers; leased ones are stopped when their lease ends
+    ~ServerPool();
+
+    // Non-copyable, movable
+    ServerPool(const ServerPool&) = delete;
+    ServerPool& operator=(const ServerPool&) = delete;
+    ServerPool(ServerPool&&) noexcept;
+    ServerPool& operator=(ServerPool&&) noexcept;
+
+    /// Start warm servers for a directory in the background
+    /// @param directory Working directory (empty = options.server.working_directory)
+    void prewarm(const std::string& directory = {});
+
+    /// Lease a healthy server for a directory
+    /// Takes a warm server if there is one, otherwise waits for one being
+    /// started or spawns a new one.
+    /// @param directory Working directory (empty = options.server.working_directory)
+    /// @return Lease that returns the server to the pool when destroyed
+    /// @throws std::runtime_error if no server can be started or lease_timeout passes
+    ServerLease lease(const std::string& directory = {});
+
+    /// Get pool counters
+    ServerPoolStats stats() const;
+
+    /// Stop every idle server and refuse further leases
+    void shutdown();
+
+  private:
+    friend class ServerLease;
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+/// A server leased from a ServerPool
+///
+/// Pass it to Client(ServerLease, ClientOptions) or connect to url() directly.
+class ServerLease
+{
+  public:
+    ServerLease() = default;
+
+    /// Returns the server to the pool
+    ~ServerLease();
+
+    // Non-copyable, movable
+    ServerLease(const ServerLease&) = delete;
+    ServerLease& operator=(const ServerLease&) = delete;
+    ServerLease(ServerLease&&) noexcept;
+    ServerLease& operator=(ServerLease&&) noexcept;
+
+    /// Check if this lease holds a server
+    explicit operator bool() const;
+
+    /// Get the server's base URL
+    std::string url() const;
+
+    /// Get the leased server
+    Server& server();
+
+    /// Get the working directory the server was leased for
+    const std::string& directory() const;
+
+    /// Return the server to the pool now
+    void release();
+
+    /// Stop the server instead of returning it (e.g. after it misbehaved)
+    void discard();
+
+  private:
+    friend class ServerPool;
+    ServerLease(std::weak_ptr<ServerPool::Impl> pool, std::string directory, std::unique_ptr<Server> server,
+                size_t leases);
+
+    std::weak_ptr<ServerPool::Impl> pool_;
+    std::string directory_;
+    std::unique_ptr<Server> server_;
+    size_t leases_ = 0; // Times the server has been leased, this lease included
+};
+
+} // namespace opencode
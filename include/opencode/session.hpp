@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <future>
 #include <memory>
 #include <optional>
 #include <string>
@@ -13,8 +14,9 @@
 namespace opencode
 {
 
-// Forward declaration
+// Forward declarations
 class Client;
+class MessageCache;
 
 // =============================================================================
 // Session
@@ -98,10 +100,33 @@ class Session
     );
 
     /// Get message history
-    /// @param limit Optional limit on number of messages
+    /// Served from a local cache that server events keep current; the first
+    /// call downloads the history (see MessageCache)
+    /// @param limit Optional limit on number of messages (the newest ones)
     /// @return Vector of messages with parts
     std::vector<MessageWithParts> messages(std::optional<int> limit = std::nullopt);
 
+    /// Get a window of the message history, e.g. only messages newer than
+    /// the last one seen: messages_page({.after = last_id})
+    /// @param page Before/after message ID cursors and limit
+    /// @return Messages in chronological order
+    std::vector<MessageWithParts> messages_page(const MessagePage& page);
+
+    /// Send a message without blocking (see Client::send_message_async)
+    /// @param prompt The message text
+    /// @return Future for the complete assistant response
+    std::future<MessageWithParts> send_async(const std::string& prompt);
+
+    /// Send a message with specific model without blocking
+    std::future<MessageWithParts> send_async(
+        const std::string& prompt,
+        const std::string& provider_id,
+        const std::string& model_id
+    );
+
+    /// Download message history without blocking (bypasses the cache)
+    std::future<std::vector<MessageWithParts>> messages_async(std::optional<int> limit = std::nullopt);
+
     // =========================================================================
     // Control
     // =========================================================================
@@ -159,8 +184,11 @@ class Session
     bool destroy();
 
   private:
+    MessageCache& cache();
+
     Client* client_;
     SessionInfo info_;
+    std::unique_ptr<MessageCache> cache_; // Opened by the first messages() call
 };
 
 } // namespace opencode
@@ -4,10 +4,15 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <stop_token>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -25,6 +30,11 @@ struct HttpRequest
     std::string body;
     std::vector<std::pair<std::string, std::string>> headers;
     std::optional<std::string> content_type;
+
+    /// End the call early when stop is requested or the deadline passes; the
+    /// response then has status 0. Transports that cannot honour these ignore them.
+    std::stop_token cancel;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
 };
 
 struct HttpResponse
@@ -47,6 +57,16 @@ struct SSEEvent
     int retry = 0;     // Retry interval in ms (0 = not specified)
 };
 
+/// Borrowed view of an SSE event, valid only during the callback
+/// Fields point into the parser's input or internal buffers
+struct SSEEventView
+{
+    std::string_view event;
+    std::string_view data;
+    std::string_view id;
+    int retry = 0;
+};
+
 // =============================================================================
 // SSE Callbacks
 // =============================================================================
@@ -55,6 +75,93 @@ using SSEEventCallback = std::function<void(const SSEEvent&)>;
 using SSEErrorCallback = std::function<void(const std::string& error)>;
 using SSECloseCallback = std::function<void()>;
 
+/// Receives each text or binary WebSocket message, fragments joined
+using WebSocketMessageCallback = std::function<void(std::string_view data)>;
+
+/// Receives consecutive pieces of a response body; return false to stop the transfer
+using ContentCallback = std::function<bool(std::string_view data)>;
+
+/// How an SSE stream recovers from a dropped or silent connection
+///
+/// While reconnecting, on_error/on_close are not called; the stream resumes
+/// with a Last-Event-ID header when the server has sent event IDs. The delay
+/// before attempt n is min(max_delay, base * multiplier^(n-1)), where base
+/// is the server's retry field if it sent one, else initial_delay, with up
+/// to jitter of it drawn off at random so many clients do not reconnect in step.
+struct SSEReconnectOptions
+{
+    /// Reconnect automatically (false = the stream ends at the first drop)
+    bool enabled = true;
+
+    /// Delay before the first attempt, unless the server sent retry
+    std::chrono::milliseconds initial_delay{250};
+
+    /// Upper bound on the delay between attempts
+    std::chrono::milliseconds max_delay{30000};
+
+    /// Growth of the delay per consecutive failed attempt
+    double multiplier = 2.0;
+
+    /// Fraction of each delay that is randomized (0 = none, 1 = anywhere in [0, delay])
+    double jitter = 0.5;
+
+    /// Reconnect when nothing, not even a server heartbeat, arrives for this long
+    std::chrono::seconds liveness_timeout{90};
+
+    /// Give up after this many consecutive failed attempts (0 = never)
+    /// Giving up reports the last error to on_error, then closes the stream.
+    /// The default spans under a minute of backoff, so a server that is gone
+    /// ends the stream instead of leaving its consumers waiting.
+    size_t max_attempts = 8;
+};
+
+// =============================================================================
+// Instrumentation
+// =============================================================================
+
+/// Measurements of one request() / request_stream() call
+struct RequestMetrics
+{
+    std::string method;
+    std::string path;                              // As requested, including any query
+    int status = 0;                                // 0 if no response was received
+    size_t bytes_sent = 0;                         // Request body
+    size_t bytes_received = 0;                     // Response body, after decompression
+    bool reused_connection = false;                // Ran on a pooled keep-alive connection
+    bool revalidated = false;                      // 304 answered from the validator cache
+    std::chrono::system_clock::time_point start;   // Wall-clock start, e.g. for spans
+    std::chrono::nanoseconds connection_wait{0};   // Waiting for a free pooled connection
+    std::chrono::nanoseconds time_to_first_byte{0}; // Until the response headers arrived
+    std::chrono::nanoseconds total{0};             // The whole call
+};
+
+/// Receives measurements from HttpTransport and Client
+///
+/// Callbacks run on the thread doing the work (caller or SSE thread), so they
+/// must be thread-safe and cheap. MetricsRegistry is a ready-made observer
+/// with Prometheus export; an OpenTelemetry exporter can turn on_request()
+/// into client spans from start and total.
+class TransportObserver
+{
+  public:
+    virtual ~TransportObserver() = default;
+
+    /// A request completed (successfully or not)
+    virtual void on_request(const RequestMetrics& /*metrics*/) {}
+
+    /// An SSE connection to path was established; reconnect is false for the first one
+    virtual void on_sse_connect(std::string_view /*path*/, bool /*reconnect*/) {}
+
+    /// An SSE event with a data field of `bytes` bytes arrived on path
+    virtual void on_sse_event(std::string_view /*path*/, size_t /*bytes*/) {}
+
+    /// A JSON document of `bytes` bytes was parsed; kind is "response" or "event"
+    virtual void on_parse(std::string_view /*kind*/, size_t /*bytes*/, std::chrono::nanoseconds /*elapsed*/) {}
+
+    /// An event was queued on an EventStream, which now holds `depth` events
+    virtual void on_event_queued(size_t /*depth*/) {}
+};
+
 // =============================================================================
 // Transport Interface
 // =============================================================================
@@ -70,6 +177,26 @@ class Transport
     /// @return Response from server
     virtual HttpResponse request(const HttpRequest& req) = 0;
 
+    /// Execute an HTTP request, handing a 2xx body to on_data as it arrives
+    /// instead of collecting it in the response (other bodies are collected)
+    /// The default implementation buffers the response through request().
+    /// @param req The request to execute
+    /// @param on_data Callback for each piece of the body
+    /// @return Response from server, with an empty body on success
+    virtual HttpResponse request_stream(const HttpRequest& req, const ContentCallback& on_data)
+    {
+        auto response = request(req);
+        if (response.status >= 200 && response.status < 300)
+        {
+            if (!response.body.empty())
+            {
+                on_data(response.body);
+            }
+            response.body.clear();
+        }
+        return response;
+    }
+
     /// Start an SSE connection
     /// @param path Path to SSE endpoint
     /// @param headers Additional headers
@@ -90,6 +217,40 @@ class Transport
 
     /// Check if SSE is connected
     virtual bool sse_connected() const = 0;
+
+    /// Open a WebSocket to path, receiving its messages on a background thread
+    /// Reconnects like start_sse(); a close frame from the server ends it cleanly.
+    /// The default implementation has no WebSocket support.
+    /// @return true if the connection was started
+    virtual bool start_websocket(
+        const std::string& /*path*/,
+        const std::vector<std::pair<std::string, std::string>>& /*headers*/,
+        WebSocketMessageCallback /*on_message*/,
+        SSEErrorCallback /*on_error*/,
+        SSECloseCallback /*on_close*/
+    )
+    {
+        return false;
+    }
+
+    /// Send a text message on the WebSocket
+    /// @return false if it is not connected (nothing was sent)
+    virtual bool websocket_send(std::string_view /*text*/)
+    {
+        return false;
+    }
+
+    /// Close the WebSocket
+    virtual void stop_websocket() {}
+
+    /// Another transport to the same server, for one long-lived stream
+    /// Client runs its event stream and each PTY channel on a transport of its
+    /// own. The default returns nullptr, and Client then connects an
+    /// HttpTransport to its base URL.
+    virtual std::unique_ptr<Transport> stream_transport()
+    {
+        return nullptr;
+    }
 };
 
 // =============================================================================
@@ -127,6 +288,9 @@ class HttpTransport : public Transport
 
     HttpResponse request(const HttpRequest& req) override;
 
+    /// The body is received incrementally over a pooled connection
+    HttpResponse request_stream(const HttpRequest& req, const ContentCallback& on_data) override;
+
     bool start_sse(
         const std::string& path,
         const std::vector<std::pair<std::string, std::string>>& headers,
@@ -138,15 +302,52 @@ class HttpTransport : public Transport
     void stop_sse() override;
     bool sse_connected() const override;
 
+    /// Plain ws:// over its own socket, with the same headers and Basic auth
+    /// as requests; pings the server when the connection falls quiet
+    bool start_websocket(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        WebSocketMessageCallback on_message,
+        SSEErrorCallback on_error,
+        SSECloseCallback on_close
+    ) override;
+
+    bool websocket_send(std::string_view text) override;
+    void stop_websocket() override;
+
     /// Set the x-opencode-directory header for all requests
     void set_directory(const std::string& directory);
 
+    /// Set the reconnection policy for start_sse() and start_websocket() (applies to the next start)
+    void set_sse_reconnect(const SSEReconnectOptions& options);
+
+    /// Report request timings and SSE traffic to an observer (nullptr = none)
+    void set_observer(std::shared_ptr<TransportObserver> observer);
+
+    /// Offer compressed responses (default: on)
+    /// Whatever codings httplib was built with are accepted: br with Brotli,
+    /// gzip and deflate with zlib. Disabling sends Accept-Encoding: identity.
+    void set_compression(bool enabled);
+
+    /// Byte budget for GET responses kept for revalidation (default: 4 MiB, 0 disables)
+    /// Responses carrying an ETag or Last-Modified are stored per path and
+    /// requested again with If-None-Match / If-Modified-Since; a 304 is
+    /// answered with the stored body as a 200.
+    void set_response_cache(size_t max_bytes);
+
     /// Set connection timeout in seconds
     void set_connection_timeout(int seconds);
 
     /// Set read timeout in seconds
     void set_read_timeout(int seconds);
 
+    /// Set the maximum number of pooled keep-alive connections (default: 8)
+    /// request() is thread-safe; callers beyond the limit wait for a free connection
+    void set_max_connections(size_t max_connections);
+
+    /// Close pooled connections idle for longer than this (default: 60 seconds)
+    void set_idle_timeout(int seconds);
+
   private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -156,7 +357,11 @@ class HttpTransport : public Transport
 // SSE Parser
 // =============================================================================
 
-/// Parser for Server-Sent Events stream
+/// Incremental parser for Server-Sent Events stream
+///
+/// Lines are scanned in place in each incoming chunk; only a trailing partial
+/// line is copied, and field storage is reused across events, so steady-state
+/// parsing does not allocate per line or per event.
 class SSEParser
 {
   public:
@@ -165,14 +370,98 @@ class SSEParser
     /// Feed data to the parser
     /// @param data Incoming data chunk
     /// @param on_event Callback for each complete event
-    void feed(const std::string& data, const std::function<void(const SSEEvent&)>& on_event);
+    void feed(std::string_view data, const std::function<void(const SSEEvent&)>& on_event);
+
+    /// Feed data to the parser, receiving borrowed views of each event
+    /// A single-line data field points straight into the input chunk
+    /// @param data Incoming data chunk
+    /// @param on_event Callback for each complete event (views valid only during the call)
+    void feed_views(std::string_view data, const std::function<void(const SSEEventView&)>& on_event);
+
+    /// Reset parser state
+    void reset();
+
+    /// Last event ID seen (persists across events, as used for Last-Event-ID)
+    const std::string& last_event_id() const
+    {
+        return last_event_id_;
+    }
+
+    /// Reconnection time from the last valid retry field, in ms (0 = none seen)
+    int reconnection_time() const
+    {
+        return reconnection_time_;
+    }
+
+  private:
+    void process_line(std::string_view line, const std::function<void(const SSEEventView&)>& on_event);
+    void dispatch(const std::function<void(const SSEEventView&)>& on_event);
+
+    /// Copy a data view into data_ before the memory it points to goes away
+    void own_data();
+
+    std::string partial_;        // Incomplete trailing line from the previous chunk
+    std::string event_;
+    std::string id_;
+    std::string data_;           // Owned data (multi-line, or spanning chunks)
+    std::string_view data_view_; // Single data line, borrowed from the current chunk
+    bool data_borrowed_ = false;
+    int retry_ = 0;
+    SSEEvent scratch_;           // Reused for the SSEEvent overload of feed()
+    std::string last_event_id_;  // Not cleared on dispatch
+    int reconnection_time_ = 0;  // Not cleared on dispatch
+};
+
+// =============================================================================
+// WebSocket Framing
+// =============================================================================
+
+/// WebSocket frame opcodes (RFC 6455, section 5.2)
+enum class WebSocketOpcode : uint8_t
+{
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xA,
+};
+
+/// Incremental parser for the frames a WebSocket server sends
+///
+/// Fragmented messages are joined; control frames may arrive between the
+/// fragments and are passed on as they come. A frame split across chunks
+/// is held until it is complete.
+class WebSocketParser
+{
+  public:
+    /// Receives a whole text or binary message, or one control frame
+    /// The payload is valid only during the call.
+    using FrameCallback = std::function<void(WebSocketOpcode opcode, std::string_view payload)>;
+
+    /// Feed data to the parser
+    /// @param data Incoming data chunk
+    /// @param on_frame Callback for each complete message or control frame
+    /// @throws std::runtime_error on a protocol violation; the stream is unusable after it
+    void feed(std::string_view data, const FrameCallback& on_frame);
 
     /// Reset parser state
     void reset();
 
   private:
-    std::string buffer_;
-    SSEEvent current_event_;
+    /// Parse one frame at the front of data
+    /// @return Bytes consumed (0 if the frame is incomplete)
+    size_t parse_frame(std::string_view data, const FrameCallback& on_frame);
+
+    std::string partial_;      // Incomplete frame from earlier chunks
+    std::string message_;      // Fragments of the message in progress
+    WebSocketOpcode message_opcode_ = WebSocketOpcode::Continuation; // Continuation = none in progress
 };
 
+/// Encode one client-to-server frame, masked with mask as clients must
+std::string websocket_frame(WebSocketOpcode opcode, std::string_view payload, uint32_t mask);
+
+/// Sec-WebSocket-Accept value a server must answer a Sec-WebSocket-Key with
+std::string websocket_accept(std::string_view key);
+
 } // namespace opencode
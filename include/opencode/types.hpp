@@ -3,8 +3,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -193,24 +196,49 @@ struct MessageWithParts
     std::vector<Part> parts;
 
     /// Get the message ID
-    std::string id() const
+    const std::string& id() const
     {
-        return std::visit([](const auto& m) { return m.id; }, info);
+        return std::visit([](const auto& m) -> const std::string& { return m.id; }, info);
     }
 
-    /// Extract all text content from the message
-    std::string text() const
+    /// Get the session ID
+    const std::string& session_id() const
+    {
+        return std::visit([](const auto& m) -> const std::string& { return m.session_id; }, info);
+    }
+
+    /// Call f(std::string_view) with the text of each TextPart, in order
+    /// Streams the text without building a joined copy.
+    template <typename F>
+    void visit_text(F&& f) const
     {
-        std::string result;
         for (const auto& part : parts)
         {
             if (auto* t = std::get_if<TextPart>(&part))
-            {
-                if (!result.empty())
-                    result += "\n";
-                result += t->text;
-            }
+                f(std::string_view(t->text));
         }
+    }
+
+    /// Extract all text content from the message, joined with newlines
+    /// Sizes the result first, so it is built with a single allocation.
+    std::string text() const
+    {
+        size_t size = 0;
+        size_t count = 0;
+        visit_text([&](std::string_view segment)
+        {
+            size += segment.size();
+            ++count;
+        });
+
+        std::string result;
+        result.reserve(size + (count ? count - 1 : 0));
+        visit_text([&](std::string_view segment)
+        {
+            if (!result.empty())
+                result += '\n';
+            result += segment;
+        });
         return result;
     }
 
@@ -228,6 +256,15 @@ struct MessageWithParts
         return std::nullopt;
     }
 
+    /// Get token usage without copying it (nullptr unless this is an assistant message)
+    /// The pointer is into this message, so it must not outlive it.
+    const TokenInfo* tokens_if() const
+    {
+        if (auto* a = std::get_if<AssistantMessage>(&info))
+            return &a->tokens;
+        return nullptr;
+    }
+
     /// Get cost (if assistant message)
     std::optional<double> cost() const
     {
@@ -237,6 +274,14 @@ struct MessageWithParts
     }
 };
 
+/// Window of a session's history, in chronological order
+struct MessagePage
+{
+    std::optional<std::string> before; // Only messages older than this message ID
+    std::optional<std::string> after;  // Only messages newer than this message ID
+    std::optional<int> limit;          // At most this many: the oldest after `after`, else the newest
+};
+
 // =============================================================================
 // Session Status
 // =============================================================================
@@ -311,6 +356,19 @@ using StreamCompleteCallback = std::function<void(const MessageWithParts& messag
 /// Called on error during streaming
 using StreamErrorCallback = std::function<void(const std::string& error)>;
 
+class PartStore;
+
+/// Accumulated text of a streaming part
+struct StreamText
+{
+    std::string_view message_id;
+    std::string_view part_id;
+    std::string_view delta; // Text added by this update (all of it if the text was replaced)
+    std::string_view text;  // Full text so far; valid while the part store holds the part
+};
+
+using StreamTextCallback = std::function<void(const StreamText& text)>;
+
 /// Streaming options for send_streaming()
 struct StreamOptions
 {
@@ -322,6 +380,65 @@ struct StreamOptions
 
     /// Called on error
     StreamErrorCallback on_error;
+
+    /// Called for each text part update with the accumulated text, so
+    /// consumers need not rebuild it from deltas
+    StreamTextCallback on_text;
+
+    /// Store accumulating part text (default: a new one per call). Share one to
+    /// keep text views valid after the call, or across calls.
+    std::shared_ptr<PartStore> part_store;
+
+    /// Submit through the server's async prompt endpoint and return at once;
+    /// on_complete then fires from the event stream when the session goes idle.
+    /// Callbacks run on the event thread. If the stream reconnects meanwhile,
+    /// the server is asked whether the reply finished during the gap, and
+    /// on_complete may then fire on an async worker with the stored reply.
+    /// The prompt is sent with a client-chosen messageID, and only assistant
+    /// messages answering it count as the reply.
+    /// Without event_driven, on_complete always gets the full reply, but part
+    /// updates sent during a reconnect are not replayed to on_part/on_text.
+    bool event_driven = false;
+};
+
+// =============================================================================
+// Batch Prompting
+// =============================================================================
+
+/// One prompt of a send_batch() call
+struct BatchItem
+{
+    std::string session_id;   // Empty = create a new session for this item
+    std::string prompt;
+    std::string provider_id;  // Optional, like send_message()
+    std::string model_id;     // Optional, like send_message()
+};
+
+/// Outcome of one BatchItem
+struct BatchResult
+{
+    size_t index = 0;                       // Position of the item in the batch
+    std::string session_id;                 // Session the prompt ran in
+    std::optional<MessageWithParts> message;  // Set on success
+    std::string error;                      // Set on failure
+    std::chrono::milliseconds queued{0};    // Wait for a free slot after the batch started
+    std::chrono::milliseconds elapsed{0};   // Round-trip time of the prompt itself (not session creation)
+
+    bool ok() const { return message.has_value(); }
+};
+
+/// Called as each batch item completes (serialized, in completion order)
+/// If it throws, no further items are started, and send_batch() rethrows the
+/// exception once the items in flight are done.
+using BatchResultCallback = std::function<void(const BatchResult& result)>;
+
+struct BatchOptions
+{
+    /// Maximum prompts in flight at once
+    int max_concurrency = 4;
+
+    /// Optional per-item completion callback
+    BatchResultCallback on_result;
 };
 
 // =============================================================================
@@ -344,6 +461,17 @@ struct FileContent
     std::optional<std::string> encoding;  // "utf-8", "base64"
 };
 
+/// Part of a file to read; offsets count bytes of FileContent::content as the
+/// server sends it (the base64 text for binary files)
+struct FileRange
+{
+    size_t offset = 0;
+    std::optional<size_t> length;  // Through the end when unset
+};
+
+/// Receives consecutive pieces of a file's content; return false to stop reading
+using FileChunkCallback = std::function<bool(std::string_view chunk)>;
+
 struct FileStatus
 {
     std::string path;
@@ -352,6 +480,37 @@ struct FileStatus
     std::optional<int> deletions;
 };
 
+/// Outcome of one path of read_files() / file_statuses()
+template <typename T>
+struct FileResult
+{
+    size_t index = 0;        // Position of the path in the request
+    std::string path;
+    std::optional<T> value;  // Set on success, unless FileBatchOptions::collect is off
+    std::string error;       // Set on failure, never empty then
+
+    bool ok() const { return error.empty(); }
+};
+
+using FileReadResult = FileResult<FileContent>;
+using FileStatusResult = FileResult<FileStatus>;
+
+template <typename T>
+struct FileBatchOptions
+{
+    /// Maximum requests in flight at once (also bounded by ClientOptions::max_connections)
+    int max_concurrency = 8;
+
+    /// Called as each path completes (serialized, in completion order)
+    /// If it throws, no further paths are started, and the call rethrows the
+    /// exception once the requests in flight are done.
+    std::function<void(const FileResult<T>& result)> on_result;
+
+    /// Keep each value in the returned results; turn off when on_result
+    /// consumes them, so file contents are not all held at once
+    bool collect = true;
+};
+
 // =============================================================================
 // Find Operations
 // =============================================================================
@@ -381,6 +540,18 @@ struct TextSearchOptions
     bool case_sensitive = true;
 };
 
+/// Receives each match of find_text_stream(); return false to stop the search
+using TextMatchCallback = std::function<bool(const TextMatch& match)>;
+
+/// Early-exit conditions of find_text_stream()
+struct TextSearchStreamOptions
+{
+    /// Stop after this many matches (also sent as the limit when none is set)
+    /// A time limit is the call's CallOptions::deadline, which also stops the
+    /// search with the matches so far rather than throwing.
+    std::optional<size_t> max_matches;
+};
+
 struct FileMatch
 {
     std::string path;
@@ -701,6 +872,14 @@ struct TuiRender
 {
     std::vector<std::string> lines;  // Terminal lines (may contain ANSI codes)
     TuiSize size;
+    std::optional<uint64_t> seq;     // Frame sequence number, if the server sends one
+};
+
+/// One changed line of a TUI frame
+struct TuiLineChange
+{
+    int row = 0;
+    std::string text;  // New line content (may contain ANSI codes)
 };
 
 // =============================================================================
@@ -2,18 +2,47 @@
 // SPDX-License-Identifier: MIT
 
 #include <opencode/client.hpp>
+#include <opencode/part_store.hpp>
 #include <opencode/server.hpp>
+#include <opencode/server_pool.hpp>
 #include <opencode/transport.hpp>
 
 #include <nlohmann/json.hpp>
 
+// Set by the OPENCODE_CLIENT_STREAMING_JSON CMake option
+#ifndef OPENCODE_STREAMING_JSON
+#define OPENCODE_STREAMING_JSON 1
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
 #include <mutex>
 #include <queue>
+#include <random>
 #include <regex>
 #include <stdexcept>
+#include <string_view>
 #include <thread>
 #include <chrono>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace opencode
 {
@@ -50,19 +79,762 @@ std::pair<std::string, int> parse_url(const std::string& url)
     return {"127.0.0.1", 4096};
 }
 
+/// Assign j[key] to out if the key is present, with a single lookup
+template <typename T>
+void read_key(const json& j, const char* key, T& out)
+{
+    if (auto it = j.find(key); it != j.end())
+        it->get_to(out);
+}
+
+/// Optional fields: also skip explicit nulls
+template <typename T>
+void read_key(const json& j, const char* key, std::optional<T>& out)
+{
+    if (auto it = j.find(key); it != j.end() && !it->is_null())
+        out = it->get<T>();
+}
+
+/// Member of an object, or nullptr if absent
+const json* find_key(const json& j, const char* key)
+{
+    auto it = j.find(key);
+    return it != j.end() ? &*it : nullptr;
+}
+
+#if OPENCODE_STREAMING_JSON
+
+/// SAX handler that hands over the elements of one JSON array as they complete
+///
+/// The array is either the document itself (empty key) or member `key` of a
+/// root object; with no key, nothing is streamed. Only one element is
+/// materialized at a time, so decoding a large list costs one element's DOM
+/// instead of the whole response's. Other root members are collected into
+/// rest(); strings are moved, not copied.
+template <typename OnElement>
+class ArrayElementReader
+{
+  public:
+    using string_t = json::string_t;
+
+    ArrayElementReader(std::optional<std::string_view> key, OnElement& on_element)
+        : key_(key), on_element_(on_element)
+    {
+    }
+
+    json& rest()
+    {
+        return rest_;
+    }
+
+    bool null() { return add(nullptr); }
+    bool boolean(bool value) { return add(value); }
+    bool number_integer(json::number_integer_t value) { return add(value); }
+    bool number_unsigned(json::number_unsigned_t value) { return add(value); }
+    bool number_float(json::number_float_t value, const string_t&) { return add(value); }
+    bool string(string_t& value) { return add(std::move(value)); }
+    bool binary(json::binary_t& value) { return add(json::binary(std::move(value))); }
+
+    bool start_object(std::size_t)
+    {
+        if (depth_++ == 0)
+        {
+            root_object_ = true;
+            skip_ = key_ && key_->empty(); // Expected an array
+            return true;
+        }
+        return open(json::object());
+    }
+
+    bool key(string_t& value)
+    {
+        if (!stack_.empty())
+            pending_key_ = std::move(value);
+        else if (depth_ == 1)
+            root_key_ = std::move(value);
+        return true;
+    }
+
+    bool end_object()
+    {
+        --depth_;
+        return close();
+    }
+
+    bool start_array(std::size_t)
+    {
+        auto depth = depth_++;
+        if (depth == 0)
+        {
+            skip_ = !key_ || !key_->empty(); // Expected an object
+            in_array_ = !skip_;
+            return true;
+        }
+        if (depth == 1 && root_object_ && stack_.empty() && key_ && root_key_ == *key_)
+        {
+            in_array_ = true;
+            return true;
+        }
+        return open(json::array());
+    }
+
+    bool end_array()
+    {
+        --depth_;
+        if (in_array_ && stack_.empty())
+        {
+            in_array_ = false;
+            return true;
+        }
+        return close();
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex)
+    {
+        if (auto* error = dynamic_cast<const json::parse_error*>(&ex))
+            throw *error;
+        throw std::runtime_error(ex.what());
+    }
+
+  private:
+    /// Place a value in the element or root member being built
+    json* place(json&& value)
+    {
+        if (skip_)
+            return nullptr;
+        if (stack_.empty())
+        {
+            if (in_array_)
+            {
+                element_ = std::move(value);
+                return &element_;
+            }
+            auto& member = rest_[root_key_];
+            member = std::move(value);
+            return &member;
+        }
+        auto* parent = stack_.back();
+        if (parent->is_object())
+        {
+            auto& member = (*parent)[pending_key_];
+            member = std::move(value);
+            return &member;
+        }
+        parent->push_back(std::move(value));
+        return &parent->back();
+    }
+
+    bool add(json&& value)
+    {
+        if (depth_ == 0)
+            return true; // Scalar document: nothing to decode
+        bool top = stack_.empty();
+        place(std::move(value));
+        return top && in_array_ ? emit() : true;
+    }
+
+    bool open(json&& container)
+    {
+        if (auto* slot = place(std::move(container)))
+            stack_.push_back(slot);
+        return true;
+    }
+
+    bool close()
+    {
+        if (stack_.empty())
+            return true;
+        stack_.pop_back();
+        return stack_.empty() && in_array_ ? emit() : true;
+    }
+
+    bool emit()
+    {
+        bool more = on_element_(std::move(element_));
+        element_ = nullptr;
+        return more;
+    }
+
+    std::optional<std::string_view> key_;
+    OnElement& on_element_;
+    json rest_ = json::object();
+    json element_;
+    std::vector<json*> stack_; // Containers being filled, innermost last
+    string_t pending_key_;
+    string_t root_key_;
+    size_t depth_ = 0;
+    bool root_object_ = false;
+    bool in_array_ = false;
+    bool skip_ = false;
+};
+
+#endif
+
+/// Decode the elements of an array response one at a time
+///
+/// The array is the document itself (empty key) or member `key` of the root
+/// object. on_element receives each element as a json&& and returns false to
+/// stop early. Returns the root object's other members. With
+/// OPENCODE_STREAMING_JSON the document is never materialized as a whole.
+template <typename OnElement>
+json decode_array(const std::string& body, std::string_view key, OnElement&& on_element)
+{
+#if OPENCODE_STREAMING_JSON
+    ArrayElementReader<OnElement> reader(key, on_element);
+    json::sax_parse(body, &reader);
+    return std::move(reader.rest());
+#else
+    auto j = json::parse(body);
+    json* array = &j;
+    if (!key.empty())
+    {
+        auto it = j.is_object() ? j.find(key) : j.end();
+        array = it != j.end() ? &*it : nullptr;
+    }
+    if (array && array->is_array())
+    {
+        for (auto& element : *array)
+        {
+            if (!on_element(std::move(element)))
+                break;
+        }
+    }
+    if (!key.empty() && j.is_object())
+    {
+        if (array && array->is_array())
+            j.erase(std::string(key));
+        return j;
+    }
+    return json::object();
+#endif
+}
+
+/// Decode an object response, moving its strings out of the parser
+json decode_object(const std::string& body)
+{
+#if OPENCODE_STREAMING_JSON
+    auto none = [](json&&) { return true; };
+    ArrayElementReader<decltype(none)> reader(std::nullopt, none);
+    json::sax_parse(body, &reader);
+    return std::move(reader.rest());
+#else
+    return json::parse(body);
+#endif
+}
+
+/// Follows the nesting of a raw JSON value fed one character at a time
+class RawValueScanner
+{
+  public:
+    /// True if c ends the value: a ',', '}' or ']' outside of it
+    bool ends_at(char c)
+    {
+        if (in_string_)
+        {
+            if (escape_)
+                escape_ = false;
+            else if (c == '\\')
+                escape_ = true;
+            else if (c == '"')
+                in_string_ = false;
+            return false;
+        }
+        switch (c)
+        {
+        case '"':
+            in_string_ = true;
+            return false;
+        case '{':
+        case '[':
+            ++depth_;
+            return false;
+        case '}':
+        case ']':
+            if (depth_ == 0)
+                return true;
+            --depth_;
+            return false;
+        case ',':
+            return depth_ == 0;
+        default:
+            return false;
+        }
+    }
+
+  private:
+    size_t depth_ = 0;
+    bool in_string_ = false;
+    bool escape_ = false;
+};
+
+/// Incremental decoder for an object response with one large string member
+///
+/// The string member `key` is unescaped as the body arrives and handed out in
+/// pieces, limited to `range`; the other members are collected and parsed at
+/// the end. Nothing is buffered beyond the current piece and those members.
+class StringMemberStreamer
+{
+  public:
+    StringMemberStreamer(std::string_view key, FileRange range, const FileChunkCallback& on_chunk)
+        : key_(key), begin_(range.offset),
+          end_(range.length ? range.offset + std::min(*range.length, SIZE_MAX - range.offset) : SIZE_MAX),
+          on_chunk_(on_chunk)
+    {
+    }
+
+    /// Feed the next piece of the body
+    /// @return false once the range is delivered or on_chunk asked to stop
+    bool feed(std::string_view data)
+    {
+        for (size_t i = 0; i < data.size() && !stopped_; ++i)
+        {
+            if (state_ == State::String)
+            {
+                // Copy the run up to the next quote or escape in one go
+                size_t run = i;
+                while (run < data.size() && data[run] != '"' && data[run] != '\\')
+                    ++run;
+                if (run > i)
+                {
+                    flush_surrogate();
+                    out_.append(data.substr(i, run - i));
+                    i = run;
+                    if (i == data.size())
+                        break;
+                }
+            }
+            step(data[i]);
+        }
+        flush();
+        return !stopped_;
+    }
+
+    /// True once the whole object has been read
+    bool complete() const { return state_ == State::Done; }
+
+    /// The object's other members
+    json rest() const
+    {
+        return json::parse("{" + members_ + "}");
+    }
+
+  private:
+    enum class State
+    {
+        Start,
+        BeforeKey,
+        Key,
+        AfterKey,
+        BeforeValue,
+        Value,
+        String,
+        Escape,
+        Unicode,
+        AfterString,
+        Done
+    };
+
+    void step(char c)
+    {
+        bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        switch (state_)
+        {
+        case State::Start:
+            if (c == '{')
+                state_ = State::BeforeKey;
+            else if (!space)
+                throw std::runtime_error("Expected a JSON object");
+            break;
+        case State::BeforeKey:
+            if (c == '"')
+            {
+                pending_key_.clear();
+                key_escape_ = false;
+                state_ = State::Key;
+            }
+            else if (c == '}')
+            {
+                state_ = State::Done;
+            }
+            break;
+        case State::Key:
+            if (c == '"' && !key_escape_)
+                state_ = State::AfterKey;
+            else
+            {
+                key_escape_ = !key_escape_ && c == '\\';
+                pending_key_ += c;
+            }
+            break;
+        case State::AfterKey:
+            if (c == ':')
+                state_ = State::BeforeValue;
+            break;
+        case State::BeforeValue:
+            if (space)
+                break;
+            if (c == '"' && pending_key_ == key_ && !found_)
+            {
+                found_ = true;
+                state_ = State::String;
+                break;
+            }
+            // Keep the member verbatim for rest()
+            if (!members_.empty())
+                members_ += ',';
+            members_ += '"';
+            members_ += pending_key_;
+            members_ += "\":";
+            raw_ = {};
+            state_ = State::Value;
+            value(c);
+            break;
+        case State::Value:
+            value(c);
+            break;
+        case State::String:
+            if (c == '"')
+            {
+                flush_surrogate();
+                state_ = State::AfterString;
+            }
+            else if (c == '\\')
+            {
+                state_ = State::Escape;
+            }
+            break;
+        case State::Escape:
+            if (c == 'u')
+            {
+                hex_ = 0;
+                hex_digits_ = 0;
+                state_ = State::Unicode;
+                break;
+            }
+            flush_surrogate();
+            out_ += unescape(c);
+            state_ = State::String;
+            break;
+        case State::Unicode:
+            hex_ = hex_ << 4 | hex_value(c);
+            if (++hex_digits_ == 4)
+            {
+                code_point(hex_);
+                state_ = State::String;
+            }
+            break;
+        case State::AfterString:
+            if (c == ',')
+                state_ = State::BeforeKey;
+            else if (c == '}')
+                state_ = State::Done;
+            break;
+        case State::Done:
+            break;
+        }
+    }
+
+    /// Raw character of a member kept for rest()
+    void value(char c)
+    {
+        if (!raw_.ends_at(c))
+        {
+            members_ += c;
+            return;
+        }
+        state_ = c == ',' ? State::BeforeKey : State::Done;
+    }
+
+    static char unescape(char c)
+    {
+        switch (c)
+        {
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        default: return c; // '"', '\\', '/'
+        }
+    }
+
+    static uint32_t hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return static_cast<uint32_t>(c - '0');
+        if (c >= 'a' && c <= 'f')
+            return static_cast<uint32_t>(c - 'a' + 10);
+        if (c >= 'A' && c <= 'F')
+            return static_cast<uint32_t>(c - 'A' + 10);
+        throw std::runtime_error("Invalid \\u escape in JSON string");
+    }
+
+    /// A \uXXXX escape; a high surrogate waits for the low half
+    void code_point(uint32_t cp)
+    {
+        if (high_surrogate_ && cp >= 0xDC00 && cp <= 0xDFFF)
+        {
+            cp = 0x10000 + ((high_surrogate_ - 0xD800) << 10) + (cp - 0xDC00);
+            high_surrogate_ = 0;
+        }
+        else
+        {
+            flush_surrogate();
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                high_surrogate_ = cp;
+                return;
+            }
+        }
+        append_utf8(cp);
+    }
+
+    /// A high surrogate without its low half decodes to U+FFFD
+    void flush_surrogate()
+    {
+        if (high_surrogate_)
+        {
+            high_surrogate_ = 0;
+            append_utf8(0xFFFD);
+        }
+    }
+
+    void append_utf8(uint32_t cp)
+    {
+        if (cp >= 0xDC00 && cp <= 0xDFFF)
+            cp = 0xFFFD; // Lone low surrogate
+        if (cp < 0x80)
+        {
+            out_ += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out_ += static_cast<char>(0xC0 | cp >> 6);
+            out_ += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out_ += static_cast<char>(0xE0 | cp >> 12);
+            out_ += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out_ += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out_ += static_cast<char>(0xF0 | cp >> 18);
+            out_ += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+            out_ += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out_ += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    /// Hand the decoded bytes that fall inside the range to on_chunk
+    void flush()
+    {
+        size_t first = position_;
+        size_t last = position_ + out_.size();
+        position_ = last;
+        size_t from = std::max(first, begin_);
+        size_t to = std::min(last, end_);
+        if (from < to && !on_chunk_(std::string_view(out_).substr(from - first, to - from)))
+            stopped_ = true;
+        if (position_ >= end_)
+            stopped_ = true;
+        out_.clear();
+    }
+
+    std::string_view key_;
+    size_t begin_;
+    size_t end_;
+    const FileChunkCallback& on_chunk_;
+
+    State state_ = State::Start;
+    std::string pending_key_;
+    std::string members_;     // Other members as "key":value,...
+    std::string out_;         // Decoded bytes of the current piece
+    size_t position_ = 0;     // Decoded bytes before out_
+    RawValueScanner raw_;     // Member being kept for rest()
+    uint32_t hex_ = 0;
+    uint32_t high_surrogate_ = 0;
+    int hex_digits_ = 0;
+    bool found_ = false;
+    bool key_escape_ = false;
+    bool stopped_ = false;
+};
+
+/// Incremental decoder for an array response, fed the body as it arrives
+///
+/// The array is the document itself (empty key) or member `key` of the root
+/// object, as for decode_array(). Each element is parsed as soon as its last
+/// byte is in and handed to on_element, which returns false to stop; the root
+/// object's other members are collected for rest().
+template <typename OnElement>
+class ArrayMemberStreamer
+{
+  public:
+    ArrayMemberStreamer(std::string_view key, OnElement& on_element)
+        : key_(key), on_element_(on_element)
+    {
+    }
+
+    /// Feed the next piece of the body
+    /// @return false once on_element asked to stop
+    bool feed(std::string_view data)
+    {
+        for (char c : data)
+        {
+            if (stopped_)
+                break;
+            step(c);
+        }
+        return !stopped_;
+    }
+
+    /// True once the whole document has been read
+    bool complete() const { return state_ == State::Done; }
+
+    /// The root object's other members
+    json rest() const
+    {
+        return json::parse("{" + members_ + "}");
+    }
+
+  private:
+    enum class State
+    {
+        Start,
+        BeforeKey,
+        Key,
+        AfterKey,
+        BeforeValue,
+        Value,
+        BeforeElement,
+        Element,
+        AfterArray,
+        Done
+    };
+
+    void step(char c)
+    {
+        bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        switch (state_)
+        {
+        case State::Start:
+            if (c == '{')
+                state_ = State::BeforeKey;
+            else if (c == '[' && key_.empty())
+                state_ = State::BeforeElement;
+            else if (!space)
+                throw std::runtime_error(key_.empty() ? "Expected a JSON array" : "Expected a JSON object");
+            break;
+        case State::BeforeKey:
+            if (c == '"')
+            {
+                pending_key_.clear();
+                key_escape_ = false;
+                state_ = State::Key;
+            }
+            else if (c == '}')
+            {
+                state_ = State::Done;
+            }
+            break;
+        case State::Key:
+            if (c == '"' && !key_escape_)
+                state_ = State::AfterKey;
+            else
+            {
+                key_escape_ = !key_escape_ && c == '\\';
+                pending_key_ += c;
+            }
+            break;
+        case State::AfterKey:
+            if (c == ':')
+                state_ = State::BeforeValue;
+            break;
+        case State::BeforeValue:
+            if (space)
+                break;
+            if (c == '[' && !key_.empty() && pending_key_ == key_ && !found_)
+            {
+                found_ = true;
+                state_ = State::BeforeElement;
+                break;
+            }
+            if (!members_.empty())
+                members_ += ',';
+            members_ += '"';
+            members_ += pending_key_;
+            members_ += "\":";
+            raw_ = {};
+            state_ = State::Value;
+            [[fallthrough]];
+        case State::Value:
+            if (!raw_.ends_at(c))
+                members_ += c;
+            else
+                state_ = c == ',' ? State::BeforeKey : State::Done;
+            break;
+        case State::BeforeElement:
+            if (space || c == ',')
+                break;
+            if (c == ']')
+            {
+                end_array();
+                break;
+            }
+            element_.clear();
+            raw_ = {};
+            state_ = State::Element;
+            [[fallthrough]];
+        case State::Element:
+            if (!raw_.ends_at(c))
+            {
+                element_ += c;
+                break;
+            }
+            stopped_ = !on_element_(json::parse(element_));
+            if (c == ']')
+                end_array();
+            else
+                state_ = State::BeforeElement;
+            break;
+        case State::AfterArray:
+            if (c == ',')
+                state_ = State::BeforeKey;
+            else if (c == '}')
+                state_ = State::Done;
+            break;
+        case State::Done:
+            break;
+        }
+    }
+
+    void end_array()
+    {
+        state_ = key_.empty() ? State::Done : State::AfterArray;
+    }
+
+    std::string_view key_;
+    OnElement& on_element_;
+
+    State state_ = State::Start;
+    std::string pending_key_;
+    std::string members_;   // Other members as "key":value,...
+    std::string element_;   // Raw text of the element being received
+    RawValueScanner raw_;
+    bool found_ = false;
+    bool key_escape_ = false;
+    bool stopped_ = false;
+};
+
 TimeInfo parse_time_info(const json& j)
 {
     TimeInfo info;
-    if (j.contains("created"))
-        info.created = j["created"].get<int64_t>();
-    if (j.contains("updated"))
-        info.updated = j["updated"].get<int64_t>();
-    if (j.contains("compacting") && !j["compacting"].is_null())
-        info.compacting = j["compacting"].get<int64_t>();
-    if (j.contains("archived") && !j["archived"].is_null())
-        info.archived = j["archived"].get<int64_t>();
-    if (j.contains("completed") && !j["completed"].is_null())
-        info.completed = j["completed"].get<int64_t>();
+    read_key(j, "created", info.created);
+    read_key(j, "updated", info.updated);
+    read_key(j, "compacting", info.compacting);
+    read_key(j, "archived", info.archived);
+    read_key(j, "completed", info.completed);
     return info;
 }
 
@@ -152,15 +924,16 @@ FileEntry parse_file_entry(const json& j)
     return entry;
 }
 
-FileContent parse_file_content(const json& j)
+FileContent parse_file_content(json&& j)
 {
+    // Called once per read_file(); move the (possibly large) content out
     FileContent content;
-    if (j.contains("path"))
-        content.path = j["path"].get<std::string>();
-    if (j.contains("content"))
-        content.content = j["content"].get<std::string>();
-    if (j.contains("encoding") && !j["encoding"].is_null())
-        content.encoding = j["encoding"].get<std::string>();
+    read_key(j, "path", content.path);
+    if (auto it = j.find("content"); it != j.end() && it->is_string())
+        content.content = std::move(it->get_ref<std::string&>());
+    else if (it != j.end())
+        it->get_to(content.content);
+    read_key(j, "encoding", content.encoding);
     return content;
 }
 
@@ -183,32 +956,19 @@ FileStatus parse_file_status(const json& j)
 TextMatch parse_text_match(const json& j)
 {
     TextMatch match;
-    if (j.contains("path"))
-        match.path = j["path"].get<std::string>();
-    if (j.contains("line"))
-        match.line = j["line"].get<int>();
-    if (j.contains("column"))
-        match.column = j["column"].get<int>();
-    if (j.contains("text"))
-        match.text = j["text"].get<std::string>();
-    if (j.contains("match"))
-        match.match = j["match"].get<std::string>();
+    read_key(j, "path", match.path);
+    read_key(j, "line", match.line);
+    read_key(j, "column", match.column);
+    read_key(j, "text", match.text);
+    read_key(j, "match", match.match);
     return match;
 }
 
-TextSearchResult parse_text_search_result(const json& j)
+/// Totals of a find_text() response; the matches are decoded separately
+void parse_text_search_totals(const json& j, TextSearchResult& result)
 {
-    TextSearchResult result;
-    if (j.contains("matches") && j["matches"].is_array())
-    {
-        for (const auto& m : j["matches"])
-            result.matches.push_back(parse_text_match(m));
-    }
-    if (j.contains("totalMatches"))
-        result.total_matches = j["totalMatches"].get<int>();
-    if (j.contains("truncated"))
-        result.truncated = j["truncated"].get<bool>();
-    return result;
+    read_key(j, "totalMatches", result.total_matches);
+    read_key(j, "truncated", result.truncated);
 }
 
 FileMatch parse_file_match(const json& j)
@@ -672,6 +1432,8 @@ TuiRender parse_tui_render(const json& j)
         render.size.width = j["size"].value("width", 0);
         render.size.height = j["size"].value("height", 0);
     }
+    if (j.contains("seq") && j["seq"].is_number_unsigned())
+        render.seq = j["seq"].get<uint64_t>();
     return render;
 }
 
@@ -701,35 +1463,28 @@ Part parse_part(const json& j)
     {
         TextPart part;
         part.type = type;
-        if (j.contains("id"))
-            part.id = j["id"].get<std::string>();
-        if (j.contains("text"))
-            part.text = j["text"].get<std::string>();
+        read_key(j, "id", part.id);
+        read_key(j, "text", part.text);
         return part;
     }
     else if (type == "file")
     {
         FilePart part;
         part.type = type;
-        if (j.contains("id"))
-            part.id = j["id"].get<std::string>();
-        if (j.contains("file"))
-            part.file = j["file"].get<std::string>();
-        if (j.contains("content") && !j["content"].is_null())
-            part.content = j["content"].get<std::string>();
+        read_key(j, "id", part.id);
+        read_key(j, "file", part.file);
+        read_key(j, "content", part.content);
         return part;
     }
     else if (type == "tool")
     {
         ToolPart part;
         part.type = type;
-        if (j.contains("id"))
-            part.id = j["id"].get<std::string>();
-        if (j.contains("tool"))
-            part.tool = j["tool"].get<std::string>();
-        if (j.contains("input") && j["input"].is_object())
+        read_key(j, "id", part.id);
+        read_key(j, "tool", part.tool);
+        if (auto* input = find_key(j, "input"); input && input->is_object())
         {
-            for (auto& [key, value] : j["input"].items())
+            for (const auto& [key, value] : input->items())
             {
                 if (value.is_string())
                     part.input[key] = value.get<std::string>();
@@ -737,12 +1492,11 @@ Part parse_part(const json& j)
                     part.input[key] = value.dump();
             }
         }
-        if (j.contains("state") && j["state"].is_object())
+        if (auto* state_json = find_key(j, "state"); state_json && state_json->is_object())
         {
             ToolState state;
-            state.status = j["state"].value("status", "");
-            if (j["state"].contains("error") && !j["state"]["error"].is_null())
-                state.error = j["state"]["error"].get<std::string>();
+            state.status = state_json->value("status", "");
+            read_key(*state_json, "error", state.error);
             part.state = state;
         }
         return part;
@@ -751,10 +1505,8 @@ Part parse_part(const json& j)
     {
         ReasoningPart part;
         part.type = type;
-        if (j.contains("id"))
-            part.id = j["id"].get<std::string>();
-        if (j.contains("text"))
-            part.text = j["text"].get<std::string>();
+        read_key(j, "id", part.id);
+        read_key(j, "text", part.text);
         return part;
     }
 
@@ -770,86 +1522,70 @@ Message parse_message(const json& j)
     if (role == "assistant")
     {
         AssistantMessage msg;
-        if (j.contains("id"))
-            msg.id = j["id"].get<std::string>();
-        if (j.contains("sessionID"))
-            msg.session_id = j["sessionID"].get<std::string>();
+        read_key(j, "id", msg.id);
+        read_key(j, "sessionID", msg.session_id);
         msg.role = role;
-        if (j.contains("time"))
-            msg.time = parse_time_info(j["time"]);
-        if (j.contains("parentID"))
-            msg.parent_id = j["parentID"].get<std::string>();
-        if (j.contains("modelID"))
-            msg.model_id = j["modelID"].get<std::string>();
-        if (j.contains("providerID"))
-            msg.provider_id = j["providerID"].get<std::string>();
-        if (j.contains("mode"))
-            msg.mode = j["mode"].get<std::string>();
-        if (j.contains("agent"))
-            msg.agent = j["agent"].get<std::string>();
-        if (j.contains("path"))
-        {
-            if (j["path"].contains("cwd"))
-                msg.path.cwd = j["path"]["cwd"].get<std::string>();
-            if (j["path"].contains("root"))
-                msg.path.root = j["path"]["root"].get<std::string>();
-        }
-        if (j.contains("cost"))
-            msg.cost = j["cost"].get<double>();
-        if (j.contains("tokens") && j["tokens"].is_object())
-        {
-            auto& t = j["tokens"];
-            if (t.contains("input"))
-                msg.tokens.input = t["input"].get<int>();
-            if (t.contains("output"))
-                msg.tokens.output = t["output"].get<int>();
-            if (t.contains("reasoning"))
-                msg.tokens.reasoning = t["reasoning"].get<int>();
-            if (t.contains("cache") && t["cache"].is_object())
+        if (auto* time = find_key(j, "time"))
+            msg.time = parse_time_info(*time);
+        read_key(j, "parentID", msg.parent_id);
+        read_key(j, "modelID", msg.model_id);
+        read_key(j, "providerID", msg.provider_id);
+        read_key(j, "mode", msg.mode);
+        read_key(j, "agent", msg.agent);
+        if (auto* path = find_key(j, "path"))
+        {
+            read_key(*path, "cwd", msg.path.cwd);
+            read_key(*path, "root", msg.path.root);
+        }
+        read_key(j, "cost", msg.cost);
+        if (auto* t = find_key(j, "tokens"); t && t->is_object())
+        {
+            read_key(*t, "input", msg.tokens.input);
+            read_key(*t, "output", msg.tokens.output);
+            read_key(*t, "reasoning", msg.tokens.reasoning);
+            if (auto* cache = find_key(*t, "cache"); cache && cache->is_object())
             {
-                if (t["cache"].contains("read"))
-                    msg.tokens.cache.read = t["cache"]["read"].get<int>();
-                if (t["cache"].contains("write"))
-                    msg.tokens.cache.write = t["cache"]["write"].get<int>();
+                read_key(*cache, "read", msg.tokens.cache.read);
+                read_key(*cache, "write", msg.tokens.cache.write);
             }
         }
-        if (j.contains("finish") && !j["finish"].is_null())
-            msg.finish = j["finish"].get<std::string>();
+        read_key(j, "finish", msg.finish);
         return msg;
     }
     else
     {
         UserMessage msg;
-        if (j.contains("id"))
-            msg.id = j["id"].get<std::string>();
-        if (j.contains("sessionID"))
-            msg.session_id = j["sessionID"].get<std::string>();
+        read_key(j, "id", msg.id);
+        read_key(j, "sessionID", msg.session_id);
         msg.role = role;
-        if (j.contains("time"))
-            msg.time = parse_time_info(j["time"]);
-        if (j.contains("agent"))
-            msg.agent = j["agent"].get<std::string>();
-        if (j.contains("model") && j["model"].is_object())
-        {
-            if (j["model"].contains("providerID"))
-                msg.model.provider_id = j["model"]["providerID"].get<std::string>();
-            if (j["model"].contains("modelID"))
-                msg.model.model_id = j["model"]["modelID"].get<std::string>();
-        }
-        if (j.contains("system") && !j["system"].is_null())
-            msg.system = j["system"].get<std::string>();
+        if (auto* time = find_key(j, "time"))
+            msg.time = parse_time_info(*time);
+        read_key(j, "agent", msg.agent);
+        if (auto* model = find_key(j, "model"); model && model->is_object())
+        {
+            read_key(*model, "providerID", msg.model.provider_id);
+            read_key(*model, "modelID", msg.model.model_id);
+        }
+        read_key(j, "system", msg.system);
         return msg;
     }
 }
 
+/// ID of any part alternative
+const std::string& part_id(const Part& part)
+{
+    return std::visit([](const auto& p) -> const std::string& { return p.id; }, part);
+}
+
 MessageWithParts parse_message_with_parts(const json& j)
 {
     MessageWithParts msg;
-    if (j.contains("info"))
-        msg.info = parse_message(j["info"]);
-    if (j.contains("parts") && j["parts"].is_array())
+    if (auto* info = find_key(j, "info"))
+        msg.info = parse_message(*info);
+    if (auto* parts = find_key(j, "parts"); parts && parts->is_array())
     {
-        for (const auto& p : j["parts"])
+        msg.parts.reserve(parts->size());
+        for (const auto& p : *parts)
         {
             msg.parts.push_back(parse_part(p));
         }
@@ -857,233 +1593,2673 @@ MessageWithParts parse_message_with_parts(const json& j)
     return msg;
 }
 
-} // anonymous namespace
-
-// =============================================================================
-// MessageStream Implementation
-// =============================================================================
-
-struct MessageStream::Impl
+/// A string member as a view into the document, or empty
+std::string_view view_of(const json& j, const char* key)
 {
-    std::mutex mutex;
-    std::condition_variable cv;
-    std::queue<MessageWithParts> messages;
-    bool closed = false;
-    std::string error;
-};
-
-MessageStream::MessageStream() : impl_(std::make_shared<Impl>()) {}
-MessageStream::~MessageStream() = default;
-MessageStream::MessageStream(MessageStream&&) noexcept = default;
-MessageStream& MessageStream::operator=(MessageStream&&) noexcept = default;
+    auto it = j.find(key);
+    return it != j.end() && it->is_string() ? std::string_view(it->get_ref<const std::string&>()) : std::string_view();
+}
 
-MessageStream::Iterator MessageStream::begin()
+/// A string member that may be absent or null, as a view into the document
+std::optional<std::string_view> optional_view_of(const json& j, const char* key)
 {
-    return Iterator(this);
-}
-
-MessageStream::Iterator MessageStream::end()
-{
-    return Iterator();
+    auto it = j.find(key);
+    if (it == j.end() || !it->is_string())
+        return std::nullopt;
+    return std::string_view(it->get_ref<const std::string&>());
 }
 
-std::optional<MessageWithParts> MessageStream::next()
+/// Decode one element of a /session/:id/message response straight into a
+/// CompactHistory, without building a MessageWithParts first
+void add_compact_message(const json& j, CompactHistory& history)
 {
-    std::unique_lock<std::mutex> lock(impl_->mutex);
-    impl_->cv.wait(lock, [this]
-                   { return !impl_->messages.empty() || impl_->closed; });
+    CompactMessage message;
+    if (auto* info = find_key(j, "info"); info && info->is_object())
+    {
+        const json& m = *info;
+        message.assistant = view_of(m, "role") == "assistant";
+        message.id = history.intern(view_of(m, "id"));
+        message.session_id = history.intern(view_of(m, "sessionID"));
+        if (auto* time = find_key(m, "time"))
+            message.time = parse_time_info(*time);
+        message.agent = history.intern(view_of(m, "agent"));
+        if (message.assistant)
+        {
+            message.parent_id = history.intern(view_of(m, "parentID"));
+            message.model_id = history.intern(view_of(m, "modelID"));
+            message.provider_id = history.intern(view_of(m, "providerID"));
+            message.mode = history.intern(view_of(m, "mode"));
+            if (auto* path = find_key(m, "path"); path && path->is_object())
+            {
+                message.cwd = history.intern(view_of(*path, "cwd"));
+                message.root = history.intern(view_of(*path, "root"));
+            }
+            read_key(m, "cost", message.cost);
+            if (auto* t = find_key(m, "tokens"); t && t->is_object())
+            {
+                read_key(*t, "input", message.tokens.input);
+                read_key(*t, "output", message.tokens.output);
+                read_key(*t, "reasoning", message.tokens.reasoning);
+                if (auto* cache = find_key(*t, "cache"); cache && cache->is_object())
+                {
+                    read_key(*cache, "read", message.tokens.cache.read);
+                    read_key(*cache, "write", message.tokens.cache.write);
+                }
+            }
+            if (auto finish = optional_view_of(m, "finish"))
+                message.finish = history.intern(*finish);
+        }
+        else
+        {
+            if (auto* model = find_key(m, "model"); model && model->is_object())
+            {
+                message.provider_id = history.intern(view_of(*model, "providerID"));
+                message.model_id = history.intern(view_of(*model, "modelID"));
+            }
+            if (auto system = optional_view_of(m, "system"))
+                message.system = history.copy(*system);
+        }
+    }
 
-    if (impl_->messages.empty())
+    if (auto* parts = find_key(j, "parts"); parts && parts->is_array())
     {
-        return std::nullopt;
+        auto out = history.allocate<CompactPart>(parts->size());
+        size_t n = 0;
+        for (const auto& p : *parts)
+        {
+            auto type = p.contains("type") ? view_of(p, "type") : std::string_view("text");
+            auto& part = out[n++];
+            if (type != "text" && type != "file" && type != "tool" && type != "reasoning")
+                continue; // An empty text part, like parse_part()
+            part.id = history.copy(view_of(p, "id"));
+            if (type == "file")
+            {
+                part.kind = PartKind::File;
+                part.text = history.copy(view_of(p, "file"));
+                if (auto content = optional_view_of(p, "content"))
+                    part.content = history.copy(*content);
+            }
+            else if (type == "tool")
+            {
+                part.kind = PartKind::Tool;
+                part.text = history.intern(view_of(p, "tool"));
+                if (auto* input = find_key(p, "input"); input && input->is_object())
+                {
+                    auto entries = history.allocate<CompactToolInput>(input->size());
+                    size_t e = 0;
+                    for (const auto& [key, value] : input->items())
+                    {
+                        entries[e].key = history.intern(key);
+                        entries[e].value = value.is_string()
+                                               ? history.copy(value.get_ref<const std::string&>())
+                                               : history.copy(value.dump());
+                        ++e;
+                    }
+                    part.input = entries;
+                }
+                if (auto* state = find_key(p, "state"); state && state->is_object())
+                {
+                    part.status = history.intern(view_of(*state, "status"));
+                    if (auto error = optional_view_of(*state, "error"))
+                        part.error = history.copy(*error);
+                }
+            }
+            else
+            {
+                part.kind = type == "reasoning" ? PartKind::Reasoning : PartKind::Text;
+                part.text = history.copy(view_of(p, "text"));
+            }
+        }
+        message.parts = out;
     }
+    history.push(message);
+}
 
-    auto msg = std::move(impl_->messages.front());
-    impl_->messages.pop();
-    return msg;
+// Event parsing
+//
+// Every Event alternative has a decode_props() overload filling it from the
+// event's "properties" object; decode_event() finds the right one through a
+// table built at compile time from the alternatives' static `type` strings.
+
+std::string string_or(const json& j, const char* key, const char* fallback = "")
+{
+    auto it = j.find(key);
+    return it != j.end() && it->is_string() ? it->get<std::string>() : fallback;
 }
 
-void MessageStream::close()
+/// Session events carry the session either as properties.info or inline
+const json& session_json(const json& props)
 {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    impl_->closed = true;
-    impl_->cv.notify_all();
+    auto it = props.find("info");
+    return it != props.end() && it->is_object() ? *it : props;
 }
 
-MessageStream::Iterator::Iterator() : stream_(nullptr), at_end_(true) {}
+bool decode_props(ServerConnectedEvent&, const json&)
+{
+    return true;
+}
 
-MessageStream::Iterator::Iterator(MessageStream* stream) : stream_(stream), at_end_(false)
+bool decode_props(ServerHeartbeatEvent&, const json&)
 {
-    fetch_next();
+    return true;
 }
 
-MessageStream::Iterator::reference MessageStream::Iterator::operator*() const
+bool decode_props(ServerInstanceDisposedEvent& event, const json& props)
 {
-    return *current_;
+    event.directory = string_or(props, "directory");
+    return true;
 }
 
-MessageStream::Iterator::pointer MessageStream::Iterator::operator->() const
+bool decode_props(GlobalDisposedEvent&, const json&)
 {
-    return &*current_;
+    return true;
 }
 
-MessageStream::Iterator& MessageStream::Iterator::operator++()
+bool decode_props(SessionCreatedEvent& event, const json& props)
 {
-    fetch_next();
-    return *this;
+    event.session = parse_session(session_json(props));
+    return true;
 }
 
-bool MessageStream::Iterator::operator==(const Iterator& other) const
+bool decode_props(SessionUpdatedEvent& event, const json& props)
 {
-    return at_end_ == other.at_end_;
+    event.session = parse_session(session_json(props));
+    return true;
 }
 
-bool MessageStream::Iterator::operator!=(const Iterator& other) const
+bool decode_props(SessionDeletedEvent& event, const json& props)
 {
-    return !(*this == other);
+    event.session_id = string_or(props, "sessionID");
+    if (event.session_id.empty())
+        event.session_id = string_or(session_json(props), "id");
+    return true;
 }
 
-void MessageStream::Iterator::fetch_next()
+bool decode_props(SessionStatusEvent& event, const json& props)
 {
-    if (stream_)
+    event.session_id = string_or(props, "sessionID");
+    auto it = props.find("status");
+    if (it != props.end() && it->is_object())
     {
-        current_ = stream_->next();
-        if (!current_)
-        {
-            at_end_ = true;
-        }
+        // {"type": "idle" | "busy" | "retry", ...}
+        event.status.status = string_or(*it, "type", string_or(*it, "status").c_str());
+        if (it->contains("messageID"))
+            event.status.message_id = string_or(*it, "messageID");
+        if (it->contains("partID"))
+            event.status.part_id = string_or(*it, "partID");
     }
+    else if (it != props.end() && it->is_string())
+    {
+        event.status.status = it->get<std::string>();
+    }
+    return true;
 }
 
-// =============================================================================
-// EventStream Implementation
-// =============================================================================
+bool decode_props(SessionIdleEvent& event, const json& props)
+{
+    event.session_id = string_or(props, "sessionID");
+    return true;
+}
 
-struct EventStream::Impl
+bool decode_props(SessionErrorEvent& event, const json& props)
 {
-    std::mutex mutex;
-    std::condition_variable cv;
-    std::queue<Event> events;
-    bool closed = false;
-    std::string error;
-    std::unique_ptr<Transport> transport;
-};
+    event.session_id = string_or(props, "sessionID");
+    auto it = props.find("error");
+    if (it == props.end() || it->is_null())
+        return true;
+    if (it->is_string())
+    {
+        event.error = it->get<std::string>();
+    }
+    else if (it->is_object())
+    {
+        // {"name": "...", "data": {"message": "..."}}
+        auto data = it->find("data");
+        if (data != it->end() && data->is_object())
+            event.error = string_or(*data, "message");
+        if (event.error.empty())
+            event.error = string_or(*it, "name", "unknown error");
+    }
+    else
+    {
+        event.error = it->dump();
+    }
+    return true;
+}
 
-EventStream::EventStream() : impl_(std::make_shared<Impl>()) {}
-EventStream::~EventStream()
+bool decode_props(MessageUpdatedEvent& event, const json& props)
 {
-    close();
+    auto it = props.find("info");
+    if (it == props.end() || !it->is_object())
+        return false;
+    event.info = parse_message(*it);
+    return true;
 }
-EventStream::EventStream(EventStream&&) noexcept = default;
-EventStream& EventStream::operator=(EventStream&&) noexcept = default;
 
-EventStream::Iterator EventStream::begin()
+bool decode_props(MessageRemovedEvent& event, const json& props)
 {
-    return Iterator(this);
+    event.session_id = string_or(props, "sessionID");
+    event.message_id = string_or(props, "messageID");
+    return true;
 }
 
-EventStream::Iterator EventStream::end()
+bool decode_props(MessagePartUpdatedEvent& event, const json& props)
 {
-    return Iterator();
+    auto it = props.find("part");
+    if (it == props.end() || !it->is_object())
+        return false;
+    event.session_id = string_or(*it, "sessionID");
+    event.message_id = string_or(*it, "messageID");
+    event.part = parse_part(*it);
+    if (auto delta = props.find("delta"); delta != props.end() && delta->is_string())
+        event.delta = delta->get<std::string>();
+    return true;
 }
 
-std::optional<Event> EventStream::next()
+bool decode_props(MessagePartRemovedEvent& event, const json& props)
 {
-    std::unique_lock<std::mutex> lock(impl_->mutex);
-    impl_->cv.wait(lock, [this]
-                   { return !impl_->events.empty() || impl_->closed; });
+    event.session_id = string_or(props, "sessionID");
+    event.message_id = string_or(props, "messageID");
+    event.part_id = string_or(props, "partID");
+    return true;
+}
 
-    if (impl_->events.empty())
-    {
-        return std::nullopt;
-    }
+bool decode_props(PermissionAskedEvent& event, const json& props)
+{
+    event.request = parse_permission_request(props);
+    return true;
+}
 
-    auto event = std::move(impl_->events.front());
-    impl_->events.pop();
-    return event;
+bool decode_props(PermissionRepliedEvent& event, const json& props)
+{
+    event.session_id = string_or(props, "sessionID");
+    event.request_id = string_or(props, "requestID", string_or(props, "permissionID").c_str());
+    event.reply = string_or(props, "reply", string_or(props, "response").c_str());
+    return true;
 }
 
-void EventStream::close()
+bool decode_props(ProjectUpdatedEvent& event, const json& props)
 {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    impl_->closed = true;
-    if (impl_->transport)
-    {
-        impl_->transport->stop_sse();
-    }
-    impl_->cv.notify_all();
+    event.project = parse_project(props);
+    return true;
 }
 
-EventStream::Iterator::Iterator() : stream_(nullptr), at_end_(true) {}
+bool decode_props(FileEditedEvent& event, const json& props)
+{
+    event.file = string_or(props, "file");
+    return true;
+}
 
-EventStream::Iterator::Iterator(EventStream* stream) : stream_(stream), at_end_(false)
+bool decode_props(InstallationUpdatedEvent& event, const json& props)
 {
-    fetch_next();
+    event.version = string_or(props, "version");
+    return true;
 }
 
-EventStream::Iterator::reference EventStream::Iterator::operator*() const
+bool decode_props(InstallationUpdateAvailableEvent& event, const json& props)
 {
-    return *current_;
+    event.version = string_or(props, "version");
+    return true;
 }
 
-EventStream::Iterator::pointer EventStream::Iterator::operator->() const
+bool decode_props(TuiRenderDiffEvent& event, const json& props)
 {
-    return &*current_;
+    auto seq = props.find("seq");
+    if (seq == props.end() || !seq->is_number_unsigned())
+        return false;
+    event.seq = seq->get<uint64_t>();
+    if (auto size = props.find("size"); size != props.end() && size->is_object())
+    {
+        event.size.width = size->value("width", 0);
+        event.size.height = size->value("height", 0);
+    }
+    if (auto lines = props.find("lines"); lines != props.end() && lines->is_array())
+    {
+        event.lines.reserve(lines->size());
+        for (const auto& line : *lines)
+        {
+            if (!line.is_object())
+                continue;
+            event.lines.push_back({line.value("row", 0), string_or(line, "text")});
+        }
+    }
+    return true;
 }
 
-EventStream::Iterator& EventStream::Iterator::operator++()
+template <typename T>
+std::optional<Event> decode_as(const json& props)
 {
-    fetch_next();
-    return *this;
+    T event;
+    if (!decode_props(event, props))
+        return std::nullopt;
+    return Event(std::in_place_type<T>, std::move(event));
 }
 
-bool EventStream::Iterator::operator==(const Iterator& other) const
+struct EventDecoder
 {
-    return at_end_ == other.at_end_;
+    std::string_view type;
+    std::optional<Event> (*decode)(const json& props);
+};
+
+template <size_t... I>
+constexpr auto make_event_decoders(std::index_sequence<I...>)
+{
+    std::array<EventDecoder, sizeof...(I)> table{
+        {{std::variant_alternative_t<I, Event>::type, &decode_as<std::variant_alternative_t<I, Event>>}...}};
+    std::ranges::sort(table, {}, &EventDecoder::type);
+    return table;
 }
 
-bool EventStream::Iterator::operator!=(const Iterator& other) const
+/// One entry per Event alternative, sorted by type for binary search
+constexpr auto event_decoders = make_event_decoders(std::make_index_sequence<std::variant_size_v<Event>>{});
+
+static_assert(std::ranges::adjacent_find(event_decoders, {}, &EventDecoder::type) == event_decoders.end(),
+              "Event alternatives must have distinct type strings");
+
+std::optional<Event> decode_event(std::string_view event_type, const json& props)
 {
-    return !(*this == other);
+    auto it = std::ranges::lower_bound(event_decoders, event_type, {}, &EventDecoder::type);
+    if (it == event_decoders.end() || it->type != event_type)
+        return std::nullopt;
+    return it->decode(props);
 }
 
-void EventStream::Iterator::fetch_next()
+/// Find the session an event belongs to (empty for server-wide events)
+std::string event_session_id(const std::string& event_type, const json& props)
 {
-    if (stream_)
+    if (!props.is_object())
+        return {};
+    if (auto it = props.find("sessionID"); it != props.end() && it->is_string())
+        return it->get<std::string>();
+    for (const char* key : {"part", "info"})
     {
-        current_ = stream_->next();
-        if (!current_)
+        auto it = props.find(key);
+        if (it != props.end() && it->is_object())
         {
-            at_end_ = true;
+            auto sid = it->find("sessionID");
+            if (sid != it->end() && sid->is_string())
+                return sid->get<std::string>();
         }
     }
+    // Session events carry the session itself as their properties
+    if (event_type.starts_with("session."))
+    {
+        auto id = string_or(session_json(props), "id");
+        return id.empty() ? string_or(props, "id") : id;
+    }
+    return {};
 }
 
+} // anonymous namespace
+
 // =============================================================================
-// Client Implementation
+// Event Bus
 // =============================================================================
 
-struct Client::Impl
-{
-    ClientOptions opts;
-    std::unique_ptr<Transport> transport;
-    std::unique_ptr<Server> server;  // Owned server if we spawned it
-    std::string server_url;
-    bool connected = false;
+namespace
+{
+
+/// Pulls "type" and the owning session out of a raw frame without building a DOM
+///
+/// The scan stops as soon as the requested fields are known. "type" is the
+/// first key the server writes, so a type-only peek reads a few bytes; the
+/// session needs a full (but allocation-light) pass unless properties.sessionID
+/// shows up first. Mirrors the precedence of event_session_id().
+class FramePeek
+{
+  public:
+    using string_t = json::string_t;
+
+    /// Scan a frame; returns false if it is not valid JSON
+    bool scan(const std::string& data, bool want_session)
+    {
+        want_session_ = want_session;
+        levels_.clear();
+        error_ = false;
+        json::sax_parse(data, this);
+        return !error_ && has_type_;
+    }
+
+    const std::string& type() const
+    {
+        return type_;
+    }
+
+    /// Session the frame belongs to (requires scan(data, true))
+    std::string session_id() const
+    {
+        for (const auto* candidate : {&direct_, &part_, &info_})
+        {
+            if (!candidate->empty())
+                return *candidate;
+        }
+        if (type_.starts_with("session."))
+            return info_id_.empty() ? id_ : info_id_;
+        return {};
+    }
+
+    // nlohmann SAX interface
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number_integer(json::number_integer_t) { return true; }
+    bool number_unsigned(json::number_unsigned_t) { return true; }
+    bool number_float(json::number_float_t, const string_t&) { return true; }
+    bool binary(json::binary_t&) { return true; }
+
+    bool string(string_t& value)
+    {
+        if (at({"type"}))
+        {
+            type_ = std::move(value);
+            has_type_ = true;
+        }
+        else if (want_session_)
+        {
+            if (at({"properties", "sessionID"}))
+                direct_ = std::move(value);
+            else if (at({"properties", "part", "sessionID"}))
+                part_ = std::move(value);
+            else if (at({"properties", "info", "sessionID"}))
+                info_ = std::move(value);
+            else if (at({"properties", "id"}))
+                id_ = std::move(value);
+            else if (at({"properties", "info", "id"}))
+                info_id_ = std::move(value);
+        }
+        return !done();
+    }
+
+    bool start_object(std::size_t)
+    {
+        levels_.push_back({true, {}});
+        return true;
+    }
+
+    bool key(string_t& value)
+    {
+        // Only the first few levels can hold a field we look for
+        if (levels_.size() <= 3)
+            levels_.back().key = std::move(value);
+        return true;
+    }
+
+    bool end_object()
+    {
+        levels_.pop_back();
+        return true;
+    }
+
+    bool start_array(std::size_t)
+    {
+        levels_.push_back({false, {}});
+        return true;
+    }
+
+    bool end_array()
+    {
+        levels_.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&)
+    {
+        error_ = true;
+        return false;
+    }
+
+  private:
+    struct Level
+    {
+        bool object;
+        string_t key;
+    };
+
+    bool at(std::initializer_list<std::string_view> path) const
+    {
+        if (levels_.size() != path.size())
+            return false;
+        auto level = levels_.begin();
+        for (auto name : path)
+        {
+            if (!level->object || level->key != name)
+                return false;
+            ++level;
+        }
+        return true;
+    }
+
+    bool done() const
+    {
+        return has_type_ && (!want_session_ || !direct_.empty());
+    }
+
+    std::vector<Level> levels_;
+    bool want_session_ = false;
+    bool error_ = false;
+    bool has_type_ = false;
+    std::string type_;
+    std::string direct_, part_, info_, id_, info_id_;
+};
+
+/// One SSE frame, parsed once and shared by every subscriber it is routed to
+struct BusFrame
+{
+    std::string type;
+    std::string session_id;
+    json properties;
+    uint64_t connection = 0; // EventBus::connections() when the frame arrived
+
+    /// Typed event, decoded on first access (nullptr if the type is unknown)
+    const Event* event() const
+    {
+        if (!decoded)
+        {
+            event_ = decode_event(type, properties);
+            decoded = true;
+        }
+        return event_ ? &*event_ : nullptr;
+    }
+
+  private:
+    mutable std::optional<Event> event_;
+    mutable bool decoded = false;
+};
+
+struct BusSubscriber
+{
+    std::function<void(const BusFrame&)> on_frame;
+    std::function<void(const std::string& error)> on_error;
+    std::function<void()> on_close;
+    EventFilter filter;
+};
+
+/// Single long-lived /event connection shared by all streams of a Client
+///
+/// Frames are parsed once on the SSE thread and routed to subscribers by
+/// session ID; subscribers without a session filter receive every frame of
+/// the types they accept. Frames nobody accepts are dropped after a peek at
+/// their type (and session), before the full parse. Callbacks run on the SSE
+/// thread and may be invoked once more after unsubscribe() returns. The
+/// connection is opened by the first subscribe(); the transport reconnects
+/// a dropped connection by itself (each new connection starts with another
+/// server.connected frame). Once it gives up, every current subscriber is
+/// closed and the next subscribe() reconnects. Do not subscribe from within
+/// on_close.
+class EventBus
+{
+  public:
+    using Id = uint64_t;
+
+    explicit EventBus(std::unique_ptr<Transport> transport, std::shared_ptr<TransportObserver> observer = nullptr)
+        : transport_(std::move(transport)), observer_(std::move(observer))
+    {
+    }
+
+    ~EventBus()
+    {
+        shutdown();
+    }
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    /// Subscribe to the frames accepted by subscriber.filter
+    Id subscribe(BusSubscriber subscriber)
+    {
+        auto sub = std::make_shared<BusSubscriber>(std::move(subscriber));
+        bool start = false;
+        Id id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = next_id_++;
+            if (sub->filter.session_ids.empty())
+                all_[id] = sub;
+            for (const auto& session_id : sub->filter.session_ids)
+                by_session_[session_id][id] = sub;
+            subscribers_[id] = sub;
+            if (!running_ && !shutdown_)
+            {
+                running_ = true;
+                start = true;
+            }
+        }
+
+        if (start)
+        {
+            transport_->start_sse(
+                "/event",
+                {},
+                [this](const SSEEvent& sse_event) { dispatch(sse_event); },
+                [this](const std::string& error) { fail(error); },
+                [this]() { close_all(); });
+        }
+        return id;
+    }
+
+    void unsubscribe(Id id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = subscribers_.find(id);
+        if (it == subscribers_.end())
+            return;
+        all_.erase(id);
+        for (const auto& session_id : it->second->filter.session_ids)
+        {
+            if (auto group = by_session_.find(session_id); group != by_session_.end())
+            {
+                group->second.erase(id);
+                if (group->second.empty())
+                    by_session_.erase(group);
+            }
+        }
+        subscribers_.erase(it);
+    }
+
+    /// Wait until the server has sent server.connected (or the stream failed
+    /// or was shut down)
+    bool wait_connected(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, timeout, [this] { return connected_ || !running_ || shutdown_; });
+        return connected_;
+    }
+
+    /// Whether server.connected has arrived and the stream has not ended since
+    bool connected()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connected_;
+    }
+
+    /// Number of server.connected frames so far; it grows with every reconnect
+    uint64_t connections()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connections_;
+    }
+
+    /// Close the connection and every subscriber
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutdown_ = true;
+            cv_.notify_all();
+        }
+        // Close subscribers first so one blocked on a full queue releases the SSE thread
+        close_all();
+        transport_->stop_sse();
+        close_all();
+    }
+
+  private:
+    using Group = std::map<Id, std::shared_ptr<BusSubscriber>>;
+
+    /// Who, if anyone, accepts frames of a type
+    enum class Interest
+    {
+        None,     // Drop the frame
+        Sessions, // Only session-filtered subscribers; check the session first
+        All       // At least one subscriber takes it from any session
+    };
+
+    static bool accepts(const Group& group, std::string_view type)
+    {
+        return std::any_of(group.begin(), group.end(),
+                           [type](const auto& entry) { return entry.second->filter.accepts_type(type); });
+    }
+
+    Interest interest(std::string_view type) const
+    {
+        if (accepts(all_, type))
+            return Interest::All;
+        for (const auto& [session, group] : by_session_)
+        {
+            if (accepts(group, type))
+                return Interest::Sessions;
+        }
+        return Interest::None;
+    }
+
+    void dispatch(const SSEEvent& sse_event)
+    {
+        // Cheap rejection before committing to a full parse
+        FramePeek peek;
+        if (!peek.scan(sse_event.data, false))
+            return; // Ignore malformed frames
+
+        Interest wanted;
+        uint64_t connection;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (peek.type() == "server.connected")
+            {
+                connected_ = true;
+                ++connections_;
+                cv_.notify_all();
+            }
+            connection = connections_;
+            wanted = interest(peek.type());
+        }
+        if (wanted == Interest::None)
+            return;
+        if (wanted == Interest::Sessions)
+        {
+            if (!peek.scan(sse_event.data, true))
+                return;
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto group = by_session_.find(peek.session_id());
+            if (group == by_session_.end() || !accepts(group->second, peek.type()))
+                return;
+        }
+
+        BusFrame frame;
+        frame.connection = connection;
+        try
+        {
+            auto begin = std::chrono::steady_clock::now();
+            auto j = json::parse(sse_event.data);
+            if (observer_)
+                observer_->on_parse("event", sse_event.data.size(), std::chrono::steady_clock::now() - begin);
+            frame.type = j.value("type", "");
+            if (auto it = j.find("properties"); it != j.end())
+                frame.properties = std::move(*it);
+            else
+                frame.properties = json::object();
+            frame.session_id = event_session_id(frame.type, frame.properties);
+        }
+        catch (...)
+        {
+            return; // Ignore malformed frames
+        }
+
+        std::vector<std::shared_ptr<BusSubscriber>> targets;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [id, sub] : all_)
+            {
+                if (sub->filter.accepts_type(frame.type))
+                    targets.push_back(sub);
+            }
+            if (!frame.session_id.empty())
+            {
+                if (auto group = by_session_.find(frame.session_id); group != by_session_.end())
+                {
+                    for (const auto& [id, sub] : group->second)
+                    {
+                        if (sub->filter.accepts_type(frame.type))
+                            targets.push_back(sub);
+                    }
+                }
+            }
+        }
+
+        for (const auto& sub : targets)
+        {
+            if (sub->on_frame)
+                sub->on_frame(frame);
+        }
+    }
+
+    void fail(const std::string& error)
+    {
+        for (const auto& sub : snapshot())
+        {
+            if (sub->on_error)
+                sub->on_error(error);
+        }
+    }
+
+    /// Connection is gone: drop every subscriber and allow a reconnect
+    void close_all()
+    {
+        std::unordered_map<Id, std::shared_ptr<BusSubscriber>> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+            connected_ = false;
+            all_.clear();
+            by_session_.clear();
+            subscribers.swap(subscribers_);
+            cv_.notify_all();
+        }
+
+        for (const auto& [id, sub] : subscribers)
+        {
+            if (sub->on_close)
+                sub->on_close();
+        }
+    }
+
+    std::vector<std::shared_ptr<BusSubscriber>> snapshot()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::shared_ptr<BusSubscriber>> subs;
+        for (const auto& [id, sub] : subscribers_)
+            subs.push_back(sub);
+        return subs;
+    }
+
+    std::unique_ptr<Transport> transport_;
+    std::shared_ptr<TransportObserver> observer_; // Told how long each frame took to parse
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Group all_;                                         // No session filter
+    std::unordered_map<std::string, Group> by_session_; // Session -> subscribers
+    std::unordered_map<Id, std::shared_ptr<BusSubscriber>> subscribers_;
+    Id next_id_ = 1;
+    uint64_t connections_ = 0;
+    bool running_ = false;
+    bool connected_ = false;
+    bool shutdown_ = false;
+};
+
+// =============================================================================
+// Executor
+// =============================================================================
+
+/// Fixed-size worker pool backing the Client *_async() calls
+class Executor
+{
+  public:
+    explicit Executor(size_t threads)
+    {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+        {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    /// Finishes queued tasks, then joins the workers
+    ~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /// Queue a task; exceptions it throws are delivered through the future
+    template <typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push([task] { (*task)(); });
+        }
+        cv_.notify_one();
+        return future;
+    }
+
+  private:
+    void run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+// =============================================================================
+// Lock-free Event Queue
+// =============================================================================
+
+/// Sleep/wake handshake for a single waiting thread
+///
+/// The waiter announces itself before re-checking its condition, so notify()
+/// costs one load while nobody sleeps and never misses a wakeup. Whatever the
+/// condition reads must be published with sequentially consistent stores.
+class Parking
+{
+  public:
+    template <typename Ready>
+    void wait(Ready ready)
+    {
+        while (!ready())
+        {
+            waiting_.store(true);
+            auto seen = epoch_.load();
+            if (!ready())
+                epoch_.wait(seen);
+            waiting_.store(false);
+        }
+    }
+
+    void notify()
+    {
+        if (waiting_.load())
+        {
+            epoch_.fetch_add(1);
+            epoch_.notify_all();
+        }
+    }
+
+  private:
+    std::atomic<bool> waiting_{false};
+    std::atomic<uint32_t> epoch_{0};
+};
+
+/// Unbounded single-producer/single-consumer queue of linked fixed-size segments
+///
+/// push() is only called by the producer and try_pop() only by the consumer;
+/// neither takes a lock. The producer links a new segment before publishing its
+/// first element, so the consumer always finds it when it crosses a boundary.
+template <typename T, size_t SegmentSize = 64>
+class SpscQueue
+{
+  public:
+    SpscQueue() : head_(new Segment), tail_(head_) {}
+
+    ~SpscQueue()
+    {
+        while (head_)
+        {
+            delete std::exchange(head_, head_->next.load());
+        }
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    void push(T value)
+    {
+        if (tail_index_ == SegmentSize)
+        {
+            auto* segment = new Segment;
+            tail_->next.store(segment, std::memory_order_release);
+            tail_ = segment;
+            tail_index_ = 0;
+        }
+        tail_->slots[tail_index_++].emplace(std::move(value));
+        pushed_.store(pushed_.load(std::memory_order_relaxed) + 1);
+    }
+
+    bool try_pop(T& out)
+    {
+        auto popped = popped_.load(std::memory_order_relaxed);
+        if (popped == pushed_.load())
+            return false;
+        if (head_index_ == SegmentSize)
+        {
+            delete std::exchange(head_, head_->next.load(std::memory_order_acquire));
+            head_index_ = 0;
+        }
+        auto& slot = head_->slots[head_index_++];
+        out = std::move(*slot);
+        slot.reset();
+        popped_.store(popped + 1);
+        return true;
+    }
+
+    /// Approximate when read by the side that is not moving it
+    size_t size() const
+    {
+        return pushed_.load() - popped_.load();
+    }
+
+  private:
+    struct Segment
+    {
+        std::array<std::optional<T>, SegmentSize> slots;
+        std::atomic<Segment*> next{nullptr};
+    };
+
+    // Consumer side
+    Segment* head_;
+    size_t head_index_ = 0;
+    alignas(64) std::atomic<size_t> popped_{0};
+
+    // Producer side
+    alignas(64) Segment* tail_;
+    size_t tail_index_ = 0;
+    alignas(64) std::atomic<size_t> pushed_{0};
+};
+
+} // anonymous namespace
+
+// =============================================================================
+// MessageStream Implementation
+// =============================================================================
+
+struct MessageStream::Impl
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::queue<MessageWithParts> messages;
+    bool closed = false;
+    std::string error;
+};
+
+MessageStream::MessageStream() : impl_(std::make_shared<Impl>()) {}
+MessageStream::~MessageStream() = default;
+MessageStream::MessageStream(MessageStream&&) noexcept = default;
+MessageStream& MessageStream::operator=(MessageStream&&) noexcept = default;
+
+MessageStream::Iterator MessageStream::begin()
+{
+    return Iterator(this);
+}
+
+MessageStream::Iterator MessageStream::end()
+{
+    return Iterator();
+}
+
+std::optional<MessageWithParts> MessageStream::next()
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    impl_->cv.wait(lock, [this]
+                   { return !impl_->messages.empty() || impl_->closed; });
+
+    if (impl_->messages.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto msg = std::move(impl_->messages.front());
+    impl_->messages.pop();
+    return msg;
+}
+
+void MessageStream::close()
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->closed = true;
+    impl_->cv.notify_all();
+}
+
+MessageStream::Iterator::Iterator() : stream_(nullptr), at_end_(true) {}
+
+MessageStream::Iterator::Iterator(MessageStream* stream) : stream_(stream), at_end_(false)
+{
+    fetch_next();
+}
+
+MessageStream::Iterator::reference MessageStream::Iterator::operator*() const
+{
+    return *current_;
+}
+
+MessageStream::Iterator::pointer MessageStream::Iterator::operator->() const
+{
+    return &*current_;
+}
+
+MessageStream::Iterator& MessageStream::Iterator::operator++()
+{
+    fetch_next();
+    return *this;
+}
+
+bool MessageStream::Iterator::operator==(const Iterator& other) const
+{
+    return at_end_ == other.at_end_;
+}
+
+bool MessageStream::Iterator::operator!=(const Iterator& other) const
+{
+    return !(*this == other);
+}
+
+void MessageStream::Iterator::fetch_next()
+{
+    if (stream_)
+    {
+        current_ = stream_->next();
+        if (!current_)
+        {
+            at_end_ = true;
+        }
+    }
+}
+
+// =============================================================================
+// EventStream Implementation
+// =============================================================================
+
+struct EventStream::Impl
+{
+    EventStreamOptions options;
+    std::atomic<bool> closed{false};
+    std::string error;
+
+    // Buses feeding the stream: one per client, several for a merged stream
+    struct Source
+    {
+        std::weak_ptr<EventBus> bus;
+        EventBus::Id subscription = 0;
+    };
+    std::mutex sources_mutex;
+    std::vector<Source> sources;
+    size_t open_sources = 0; // Guarded by mutex; the stream closes when it reaches 0
+    std::mutex producer_mutex; // Taken by push() when several SSE threads feed the ring
+    bool shared_producers = false;
+
+    // Unbounded and Block streams: lock-free hand-off from the SSE thread
+    SpscQueue<Event> ring;
+    Parking readable;      // Consumer waits for an event
+    Parking writable;      // Producer waits for room in a full Block stream
+    std::mutex read_mutex; // Serializes readers; uncontended with a single consumer
+
+    // Streams whose overflow policy rewrites queued events
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Event> events;
+    uint64_t dropped = 0;
+    uint64_t coalesced = 0;
+
+    std::shared_ptr<TransportObserver> observer; // Told the queue depth after each push
+
+    /// Whether events go through the ring (the policy never touches queued events)
+    bool lock_free() const
+    {
+        return options.overflow == OverflowPolicy::Block ||
+               (options.capacity == 0 && options.overflow != OverflowPolicy::CoalesceDeltas);
+    }
+
+    /// Queue an event from the SSE thread, applying the overflow policy
+    void push(Event event)
+    {
+        if (lock_free())
+        {
+            // The ring has a single producer; merged streams take turns
+            std::unique_lock<std::mutex> producer(producer_mutex, std::defer_lock);
+            if (shared_producers)
+                producer.lock();
+            if (options.capacity)
+                writable.wait([this] { return ring.size() < options.capacity || closed.load(); });
+            if (closed.load())
+                return;
+            ring.push(std::move(event));
+            readable.notify();
+            if (observer)
+                observer->on_event_queued(ring.size());
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed)
+            return;
+
+        if (options.overflow == OverflowPolicy::CoalesceDeltas && coalesce(event))
+        {
+            ++coalesced;
+            return;
+        }
+
+        if (options.capacity && events.size() >= options.capacity)
+        {
+            if (options.overflow == OverflowPolicy::DropHeartbeats)
+            {
+                if (is<ServerHeartbeatEvent>(event))
+                {
+                    ++dropped;
+                    return;
+                }
+                auto heartbeat = std::find_if(events.begin(), events.end(),
+                                              [](const Event& queued) { return is<ServerHeartbeatEvent>(queued); });
+                if (heartbeat != events.end())
+                    events.erase(heartbeat);
+                else
+                    events.pop_front();
+            }
+            else
+            {
+                events.pop_front();
+            }
+            ++dropped;
+        }
+
+        events.push_back(std::move(event));
+        cv.notify_all();
+        if (observer)
+            observer->on_event_queued(events.size());
+    }
+
+    /// Move up to max events into out, waiting for at least one
+    /// @return Number of events moved; 0 once the stream is closed and empty
+    template <typename Out>
+    size_t pop(Out out, size_t max)
+    {
+        size_t count = 0;
+        if (lock_free())
+        {
+            std::lock_guard<std::mutex> lock(read_mutex);
+            readable.wait([this] { return ring.size() > 0 || closed.load(); });
+            Event event;
+            while (count < max && ring.try_pop(event))
+            {
+                out(std::move(event));
+                ++count;
+            }
+            if (count && options.capacity)
+                writable.notify();
+            return count;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return !events.empty() || closed; });
+        while (count < max && !events.empty())
+        {
+            out(std::move(events.front()));
+            events.pop_front();
+            ++count;
+        }
+        return count;
+    }
+
+    /// Mark the stream closed and wake both sides
+    void shut(const std::string* reason = nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (reason)
+                error = *reason;
+            closed = true;
+        }
+        cv.notify_all();
+        readable.notify();
+        writable.notify();
+    }
+
+    /// One source's connection ended; the stream closes after the last one
+    void end_source(const std::string* reason = nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (reason && error.empty())
+                error = *reason;
+            if (open_sources > 0 && --open_sources > 0)
+                return;
+        }
+        shut();
+    }
+
+    /// Fold a delta into the newest queued event if both update the same part
+    bool coalesce(Event& event)
+    {
+        auto* incoming = std::get_if<MessagePartUpdatedEvent>(&event);
+        if (!incoming || !incoming->delta || events.empty())
+            return false;
+        auto* queued = std::get_if<MessagePartUpdatedEvent>(&events.back());
+        if (!queued || !queued->delta || queued->message_id != incoming->message_id ||
+            part_id(queued->part) != part_id(incoming->part))
+            return false;
+
+        // The newer part already holds the full text so far; only the delta accumulates
+        *queued->delta += *incoming->delta;
+        queued->part = std::move(incoming->part);
+        return true;
+    }
+};
+
+EventStream::EventStream() : impl_(std::make_shared<Impl>()) {}
+EventStream::~EventStream()
+{
+    close();
+}
+EventStream::EventStream(EventStream&&) noexcept = default;
+EventStream& EventStream::operator=(EventStream&&) noexcept = default;
+
+EventStream::Iterator EventStream::begin()
+{
+    return Iterator(this);
+}
+
+EventStream::Iterator EventStream::end()
+{
+    return Iterator();
+}
+
+std::optional<Event> EventStream::next()
+{
+    std::optional<Event> event;
+    impl_->pop([&](Event&& e) { event = std::move(e); }, 1);
+    return event;
+}
+
+size_t EventStream::next_batch(std::span<Event> out)
+{
+    if (out.empty())
+        return 0;
+
+    auto it = out.begin();
+    return impl_->pop([&](Event&& e) { *it++ = std::move(e); }, out.size());
+}
+
+std::vector<Event> EventStream::drain()
+{
+    std::vector<Event> events;
+    impl_->pop([&](Event&& e) { events.push_back(std::move(e)); }, SIZE_MAX);
+    return events;
+}
+
+EventStreamStats EventStream::stats() const
+{
+    if (!impl_)
+        return {};
+    if (impl_->lock_free())
+        return {0, 0, impl_->ring.size()};
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return {impl_->dropped, impl_->coalesced, impl_->events.size()};
+}
+
+void EventStream::close()
+{
+    if (!impl_)
+        return; // Moved-from
+
+    impl_->shut();
+
+    std::vector<Impl::Source> sources;
+    {
+        std::lock_guard<std::mutex> lock(impl_->sources_mutex);
+        sources.swap(impl_->sources);
+    }
+    for (const auto& source : sources)
+    {
+        if (auto bus = source.bus.lock())
+            bus->unsubscribe(source.subscription);
+    }
+}
+
+EventStream::Iterator::Iterator() : stream_(nullptr), at_end_(true) {}
+
+EventStream::Iterator::Iterator(EventStream* stream) : stream_(stream), at_end_(false)
+{
+    fetch_next();
+}
+
+EventStream::Iterator::reference EventStream::Iterator::operator*() const
+{
+    return *current_;
+}
+
+EventStream::Iterator::pointer EventStream::Iterator::operator->() const
+{
+    return &*current_;
+}
+
+EventStream::Iterator& EventStream::Iterator::operator++()
+{
+    fetch_next();
+    return *this;
+}
+
+bool EventStream::Iterator::operator==(const Iterator& other) const
+{
+    return at_end_ == other.at_end_;
+}
+
+bool EventStream::Iterator::operator!=(const Iterator& other) const
+{
+    return !(*this == other);
+}
+
+void EventStream::Iterator::fetch_next()
+{
+    if (stream_)
+    {
+        current_ = stream_->next();
+        if (!current_)
+        {
+            at_end_ = true;
+        }
+    }
+}
+
+// =============================================================================
+// MessageCache Implementation
+// =============================================================================
+
+struct MessageCache::Impl
+{
+    Client* client = nullptr;
+    std::string session_id;
+    std::weak_ptr<EventBus> bus;
+    std::chrono::milliseconds connect_timeout{0}; // Longest wait for the event stream before a download
+
+    std::mutex sync_mutex; // Serializes downloads
+    mutable std::mutex mutex;
+    EventBus::Id subscription = 0; // 0 = not subscribed
+    EventBus::Id reconnects = 0;   // server.connected watch; 0 = not subscribed
+    uint64_t connection = 0;       // Bus connection the history was downloaded on
+    bool synced = false;           // Holds the full history
+    bool syncing = false;          // Download in flight; buffer events meanwhile
+    std::vector<Event> pending;
+
+    // Messages in arrival order; IDs map to their position
+    std::map<uint64_t, MessageWithParts> by_seq;
+    std::unordered_map<std::string, uint64_t> seq_of;
+    uint64_t next_seq = 0;
+
+    // Parts that arrived before their message.updated, which says whose they are
+    std::unordered_map<std::string, std::vector<Part>> orphan_parts;
+
+    ~Impl()
+    {
+        if (auto b = bus.lock())
+        {
+            if (subscription)
+                b->unsubscribe(subscription);
+            if (reconnects)
+                b->unsubscribe(reconnects);
+        }
+    }
+
+    /// Download the history if it is not cached
+    /// The cache only counts as synced when the event stream was live for the
+    /// whole download; otherwise the history is served once and fetched again.
+    void sync(const std::shared_ptr<Impl>& self)
+    {
+        std::lock_guard<std::mutex> sync_lock(sync_mutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (synced)
+                return;
+            syncing = true;
+            pending.clear();
+        }
+
+        // Subscribe before downloading so no update falls in between, and wait for
+        // the stream to be live so the updates really are being delivered
+        subscribe(self);
+        auto b = bus.lock();
+        bool live = b && b->wait_connected(connect_timeout);
+        uint64_t downloaded_on = live ? b->connections() : 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connection = downloaded_on;
+        }
+
+        std::vector<MessageWithParts> history;
+        try
+        {
+            history = client->get_messages(session_id);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            syncing = false;
+            pending.clear();
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        by_seq.clear();
+        seq_of.clear();
+        orphan_parts.clear();
+        for (auto& message : history)
+        {
+            auto seq = next_seq++;
+            seq_of[message.id()] = seq;
+            by_seq.emplace(seq, std::move(message));
+        }
+        for (const auto& event : pending)
+            apply(event);
+        pending.clear();
+        syncing = false;
+        // Stream dropped or reconnected meanwhile: stay unsynced
+        synced = live && subscription != 0 && reconnects != 0 && b->connections() == downloaded_on;
+    }
+
+    void subscribe(const std::shared_ptr<Impl>& self)
+    {
+        auto b = bus.lock();
+        if (!b)
+            return;
+        bool want_updates;
+        bool want_reconnects;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            want_updates = subscription == 0;
+            want_reconnects = reconnects == 0;
+        }
+
+        std::weak_ptr<Impl> weak = self;
+        auto dropped = [weak]()
+        {
+            // Updates may be missed from here on
+            if (auto cache = weak.lock())
+            {
+                std::lock_guard<std::mutex> lock(cache->mutex);
+                cache->subscription = 0;
+                cache->reconnects = 0;
+                cache->synced = false;
+            }
+        };
+
+        if (want_updates)
+        {
+            auto id = b->subscribe(
+                {[weak](const BusFrame& frame)
+                 {
+                     auto cache = weak.lock();
+                     const Event* event = cache ? frame.event() : nullptr;
+                     if (!event)
+                         return;
+                     std::lock_guard<std::mutex> lock(cache->mutex);
+                     if (cache->syncing)
+                         cache->pending.push_back(*event);
+                     else if (cache->synced)
+                         cache->apply(*event);
+                 },
+                 {},
+                 dropped,
+                 {.types = {MessageUpdatedEvent::type, MessagePartUpdatedEvent::type, MessageRemovedEvent::type,
+                            MessagePartRemovedEvent::type},
+                  .session_ids = {session_id}}});
+            std::lock_guard<std::mutex> lock(mutex);
+            subscription = id;
+        }
+
+        // The transport reconnects by itself, and updates sent while it was away
+        // are lost; server.connected carries no session, so watch it separately
+        if (want_reconnects)
+        {
+            auto id = b->subscribe(
+                {[weak](const BusFrame& frame)
+                 {
+                     auto cache = weak.lock();
+                     if (!cache)
+                         return;
+                     std::lock_guard<std::mutex> lock(cache->mutex);
+                     if (frame.connection != cache->connection)
+                         cache->synced = false;
+                 },
+                 {},
+                 dropped,
+                 EventFilter::of<ServerConnectedEvent>()});
+            std::lock_guard<std::mutex> lock(mutex);
+            reconnects = id;
+        }
+    }
+
+    /// Fold one event into the cache (mutex held)
+    void apply(const Event& event)
+    {
+        if (auto* e = try_as<MessageUpdatedEvent>(event))
+        {
+            auto id = std::visit([](const auto& m) { return m.id; }, e->info);
+            auto [it, inserted] = seq_of.try_emplace(id, next_seq);
+            if (inserted)
+                ++next_seq;
+            auto& message = by_seq[it->second];
+            message.info = e->info; // User or assistant, as its role says
+            if (auto orphans = orphan_parts.find(id); orphans != orphan_parts.end())
+            {
+                for (auto& part : orphans->second)
+                    upsert_part(message.parts, std::move(part));
+                orphan_parts.erase(orphans);
+            }
+        }
+        else if (auto* e = try_as<MessagePartUpdatedEvent>(event))
+        {
+            if (auto it = seq_of.find(e->message_id); it != seq_of.end())
+                upsert_part(by_seq[it->second].parts, e->part);
+            else
+                upsert_part(orphan_parts[e->message_id], e->part); // Held until the message is known
+        }
+        else if (auto* e = try_as<MessageRemovedEvent>(event))
+        {
+            orphan_parts.erase(e->message_id);
+            if (auto it = seq_of.find(e->message_id); it != seq_of.end())
+            {
+                by_seq.erase(it->second);
+                seq_of.erase(it);
+            }
+        }
+        else if (auto* e = try_as<MessagePartRemovedEvent>(event))
+        {
+            auto drop = [&](std::vector<Part>& parts)
+            {
+                std::erase_if(parts, [&](const Part& p) { return part_id(p) == e->part_id; });
+            };
+            if (auto it = seq_of.find(e->message_id); it != seq_of.end())
+                drop(by_seq[it->second].parts);
+            else if (auto orphans = orphan_parts.find(e->message_id); orphans != orphan_parts.end())
+                drop(orphans->second);
+        }
+    }
+
+    static void upsert_part(std::vector<Part>& parts, Part part)
+    {
+        auto it = std::find_if(parts.begin(), parts.end(),
+                               [&](const Part& p) { return part_id(p) == part_id(part); });
+        if (it != parts.end())
+            *it = std::move(part);
+        else
+            parts.push_back(std::move(part));
+    }
+
+    std::vector<MessageWithParts> page(const MessagePage& query) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto first = by_seq.begin();
+        auto last = by_seq.end();
+        if (query.after)
+        {
+            auto it = seq_of.find(*query.after);
+            if (it == seq_of.end())
+                return {};
+            first = std::next(by_seq.find(it->second));
+        }
+        if (query.before)
+        {
+            auto it = seq_of.find(*query.before);
+            if (it == seq_of.end())
+                return {};
+            last = by_seq.find(it->second);
+        }
+
+        auto count = static_cast<size_t>(std::max<std::ptrdiff_t>(std::distance(first, last), 0));
+        if (query.limit && static_cast<size_t>(std::max(*query.limit, 0)) < count)
+        {
+            auto keep = static_cast<size_t>(std::max(*query.limit, 0));
+            if (query.after)
+                last = std::next(first, keep);
+            else
+                first = std::prev(last, keep);
+            count = keep;
+        }
+
+        std::vector<MessageWithParts> messages;
+        messages.reserve(count);
+        for (auto it = first; it != last && count--; ++it)
+            messages.push_back(it->second);
+        return messages;
+    }
+};
+
+MessageCache::MessageCache() : impl_(std::make_shared<Impl>()) {}
+MessageCache::~MessageCache() = default;
+MessageCache::MessageCache(MessageCache&&) noexcept = default;
+MessageCache& MessageCache::operator=(MessageCache&&) noexcept = default;
+
+std::vector<MessageWithParts> MessageCache::messages(const MessagePage& page)
+{
+    impl_->sync(impl_);
+    return impl_->page(page);
+}
+
+size_t MessageCache::size() const
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->by_seq.size();
+}
+
+void MessageCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->synced = false;
+}
+
+// =============================================================================
+// Metadata Cache
+// =============================================================================
+
+namespace
+{
+
+enum class Metadata : size_t
+{
+    Providers,
+    Modes,
+    Agents,
+    Tools,
+    ToolIds,
+    Config,
+    Project,
+    Count
+};
+
+constexpr size_t index(Metadata key)
+{
+    return static_cast<size_t>(key);
+}
+
+/// TTL cache of slow-changing endpoint responses, one entry per endpoint
+class MetadataCache
+{
+  public:
+    explicit MetadataCache(const MetadataCacheOptions& options)
+    {
+        ttl_[index(Metadata::Providers)] = options.providers;
+        ttl_[index(Metadata::Modes)] = options.modes;
+        ttl_[index(Metadata::Agents)] = options.agents;
+        ttl_[index(Metadata::Tools)] = options.tools;
+        ttl_[index(Metadata::ToolIds)] = options.tool_ids;
+        ttl_[index(Metadata::Config)] = options.config;
+        ttl_[index(Metadata::Project)] = options.project;
+    }
+
+    /// Cached value of an endpoint, calling fetch() when it is missing or expired
+    template <typename T, typename Fetch>
+    T get(Metadata key, Fetch&& fetch)
+    {
+        auto ttl = ttl_[index(key)];
+        if (ttl <= std::chrono::seconds::zero())
+            return fetch();
+
+        auto& entry = entries_[index(key)];
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (entry.value && Clock::now() < entry.expires)
+            {
+                ++stats_.hits;
+                return *std::static_pointer_cast<const T>(entry.value);
+            }
+            ++stats_.misses;
+            generation = entry.generation;
+        }
+
+        // Fetched without the lock; an invalidation meanwhile means the result may be stale
+        auto value = std::make_shared<const T>(fetch());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry.generation == generation)
+            store(entry, value, ttl);
+        return *value;
+    }
+
+    /// Replace an entry with a value known to be current
+    template <typename T>
+    void put(Metadata key, T value)
+    {
+        auto ttl = ttl_[index(key)];
+        if (ttl <= std::chrono::seconds::zero())
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = entries_[index(key)];
+        ++entry.generation;
+        store(entry, std::make_shared<const T>(std::move(value)), ttl);
+    }
+
+    void invalidate(Metadata key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop(entries_[index(key)]);
+    }
+
+    void invalidate_all()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : entries_)
+            drop(entry);
+    }
+
+    MetadataCacheStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        std::shared_ptr<const void> value;
+        Clock::time_point expires;
+        uint64_t generation = 0;  // Bumped on every invalidation
+    };
+
+    static void store(Entry& entry, std::shared_ptr<const void> value, std::chrono::seconds ttl)
+    {
+        entry.value = std::move(value);
+        entry.expires = Clock::now() + ttl;
+    }
+
+    void drop(Entry& entry)
+    {
+        ++entry.generation;
+        if (entry.value && Clock::now() < entry.expires)
+            ++stats_.invalidations;
+        entry.value.reset();
+    }
+
+    mutable std::mutex mutex_;
+    std::array<Entry, index(Metadata::Count)> entries_;
+    std::array<std::chrono::seconds, index(Metadata::Count)> ttl_{};
+    MetadataCacheStats stats_;
+};
+
+// =============================================================================
+// Single-flight Reads
+// =============================================================================
+
+/// Merges concurrent identical reads: the first caller of a key fetches, and
+/// callers arriving while it is in flight share its result or its exception
+/// The fetching caller keeps its own result; it is copied once for the others,
+/// and not at all when nobody joined.
+class SingleFlight
+{
+  public:
+    template <typename T, typename Fetch>
+    T run(const std::string& key, Fetch&& fetch)
+    {
+        std::shared_ptr<Call> call;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& slot = calls_[key];
+            if (!slot)
+            {
+                slot = std::make_shared<Call>();
+                leader = true;
+            }
+            else
+            {
+                ++slot->followers;
+            }
+            call = slot;
+        }
+        if (!leader)
+            return *std::static_pointer_cast<const T>(call->result.get());
+
+        std::optional<T> value;
+        std::exception_ptr error;
+        try
+        {
+            value.emplace(fetch());
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        // Later callers start a fresh fetch
+        size_t followers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            calls_.erase(key);
+            followers = call->followers;
+        }
+        if (error)
+        {
+            if (followers)
+                call->promise.set_exception(error);
+            std::rethrow_exception(error);
+        }
+        if (followers)
+            call->promise.set_value(std::make_shared<const T>(*value));
+        return std::move(*value);
+    }
+
+  private:
+    struct Call
+    {
+        std::promise<std::shared_ptr<const void>> promise;
+        std::shared_future<std::shared_ptr<const void>> result = promise.get_future().share();
+        size_t followers = 0; // Callers waiting on result; guarded by SingleFlight::mutex_
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Call>> calls_; // Keyed by request line
+};
+
+} // namespace
+
+// =============================================================================
+// Streaming Helpers
+// =============================================================================
+
+namespace
+{
+
+/// Request body shared by /message and /prompt_async
+json prompt_body(const std::string& prompt, const std::string& provider_id, const std::string& model_id)
+{
+    json body = json::object();
+    body["parts"] = json::array({json::object({{"type", "text"}, {"text", prompt}})});
+
+    // Add model specification if provided
+    if (!provider_id.empty() || !model_id.empty())
+    {
+        json model = json::object();
+        if (!provider_id.empty())
+            model["providerID"] = provider_id;
+        if (!model_id.empty())
+            model["modelID"] = model_id;
+        body["model"] = model;
+    }
+    return body;
+}
+
+/// New message ID in the server's ascending format: "msg_", 12 hex digits of
+/// the time in ms times 0x1000 plus a counter, then 14 random base62 characters
+/// A message the client names itself thus sorts where the server would put it.
+std::string ascending_message_id()
+{
+    static constexpr char base62[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    static std::mutex mutex;
+    static int64_t last_ms = 0;
+    static uint64_t counter = 0;
+    static std::mt19937_64 random(std::random_device{}());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch()).count();
+    if (ms != last_ms)
+    {
+        last_ms = ms;
+        counter = 0;
+    }
+    uint64_t value = static_cast<uint64_t>(ms) * 0x1000 + ++counter;
+
+    std::string id = "msg_";
+    for (int shift = 44; shift >= 0; shift -= 4)
+        id.push_back("0123456789abcdef"[(value >> shift) & 0xF]);
+    for (int i = 0; i < 14; ++i)
+        id.push_back(base62[random() % 62]);
+    return id;
+}
+
+struct StreamPartUpdate
+{
+    std::string message_id;
+    Part part; // As reported to on_part: a text delta carries only the delta
+};
+
+/// Handle one message.part.updated frame of a streaming call
+///
+/// A text delta is appended to the part store and reported without parsing the
+/// (ever-growing) part; anything else is parsed in full.
+std::optional<StreamPartUpdate> stream_part_update(const json& props, PartStore& store,
+                                                   const StreamOptions& options)
+{
+    const json* part_json = find_key(props, "part");
+    if (!part_json || !part_json->is_object())
+        return std::nullopt;
+
+    StreamPartUpdate update;
+    update.message_id = string_or(*part_json, "messageID");
+    auto delta = props.find("delta");
+    bool has_delta = delta != props.end() && delta->is_string();
+
+    std::string_view added;
+    std::string_view full;
+    if (has_delta && string_or(*part_json, "type", "text") == "text")
+    {
+        TextPart part;
+        read_key(*part_json, "id", part.id);
+        part.text = delta->get<std::string>();
+        part.is_delta = true;
+        update.part = std::move(part);
+        const auto& text = std::get<TextPart>(update.part);
+        added = text.text;
+        full = store.append(update.message_id, text.id, added);
+    }
+    else
+    {
+        update.part = parse_part(*part_json);
+        if (const auto* text = std::get_if<TextPart>(&update.part))
+        {
+            added = text->text;
+            full = store.assign(update.message_id, text->id, added);
+        }
+    }
+
+    if (options.on_text && std::holds_alternative<TextPart>(update.part))
+        options.on_text({update.message_id, part_id(update.part), added, full});
+    if (options.on_part)
+        options.on_part(update.part);
+    return update;
+}
+
+/// Throw CallCancelled if the call's token was stopped or its deadline passed
+void throw_if_ended(const CallOptions& call)
+{
+    if (call.cancel.stop_requested())
+        throw CallCancelled(false);
+    if (call.deadline && std::chrono::steady_clock::now() >= *call.deadline)
+        throw CallCancelled(true);
+}
+
+/// Counts one generation in flight on a client for as long as it lives
+class GenerationGuard
+{
+  public:
+    explicit GenerationGuard(std::shared_ptr<std::atomic<size_t>> counter)
+        : counter_(std::move(counter))
+    {
+        counter_->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~GenerationGuard()
+    {
+        counter_->fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    GenerationGuard(const GenerationGuard&) = delete;
+    GenerationGuard& operator=(const GenerationGuard&) = delete;
+
+  private:
+    std::shared_ptr<std::atomic<size_t>> counter_;
+};
+
+} // anonymous namespace
+
+// =============================================================================
+// Client Implementation
+// =============================================================================
+
+struct Client::Impl
+{
+    std::atomic<Client*> self;  // Client owning this Impl; follows the Client when it is moved
+    ClientOptions opts;
+    std::unique_ptr<Transport> transport;
+    std::unique_ptr<Server> server;  // Owned server if we spawned it
+    std::unique_ptr<ServerLease> lease;  // Pooled server, returned when the client goes away
+    std::string server_url;
+    bool connected = false;
+
+    std::mutex bus_mutex;
+    std::shared_ptr<EventBus> bus;  // Shared /event connection, created on first use
+
+    std::mutex executor_mutex;
+    std::unique_ptr<Executor> executor;  // Workers for *_async(), created on first use
+
+    std::shared_ptr<MetadataCache> metadata;  // Set when opts.metadata_cache.enabled
+
+    /// Event watch that keeps the metadata cache valid
+    struct MetadataWatch
+    {
+        std::atomic<bool> subscribed{false}; // Registered on the bus; cleared when the bus closes it
+        std::atomic<bool> live{false};       // server.connected seen and no error since
+    };
+    std::mutex metadata_watch_mutex;
+    std::shared_ptr<MetadataWatch> metadata_watch = std::make_shared<MetadataWatch>();
+
+    SingleFlight reads;  // Used when opts.coalesce_reads
+
+    // Replies being waited for; shared with event-driven streams that outlive a call
+    std::shared_ptr<std::atomic<size_t>> generations = std::make_shared<std::atomic<size_t>>(0);
+
+    Impl(Client* owner, ClientOptions options)
+        : self(owner), opts(std::move(options))
+    {
+        if (opts.metadata_cache.enabled)
+            metadata = std::make_shared<MetadataCache>(opts.metadata_cache);
+    }
+
+    ~Impl()
+    {
+        shutdown_events();
+        shutdown_executor();
+    }
+
+    /// Close the event stream; workers waiting for it to connect give up at once
+    void shutdown_events()
+    {
+        std::shared_ptr<EventBus> current;
+        {
+            std::lock_guard<std::mutex> lock(bus_mutex);
+            current = bus;
+        }
+        if (current)
+            current->shutdown();
+    }
+
+    /// Run a call on the async worker pool
+    template <typename F>
+    auto submit(F&& f)
+    {
+        std::lock_guard<std::mutex> lock(executor_mutex);
+        if (!executor)
+            executor = std::make_unique<Executor>(static_cast<size_t>(std::max(opts.async_threads, 1)));
+        return executor->submit(std::forward<F>(f));
+    }
+
+    /// Wait for every queued async call to finish
+    void shutdown_executor()
+    {
+        std::unique_ptr<Executor> pending;
+        {
+            std::lock_guard<std::mutex> lock(executor_mutex);
+            pending = std::move(executor);
+        }
+        pending.reset();
+    }
+
+    // Calls with *_async() variants. The async ones run these on the Impl,
+    // which stays put when the Client is moved.
+    std::vector<SessionInfo> list_sessions();
+    SessionInfo create_session(const std::string& title);
+    std::vector<MessageWithParts> get_messages(const std::string& session_id, std::optional<int> limit,
+                                               const CallOptions& call);
+    bool abort_session(const std::string& session_id);
+    FileContent read_file(const std::string& path, const CallOptions& call);
+    TextSearchResult find_text(const TextSearchOptions& options, const CallOptions& call);
+
+    /// Create a separate transport for a long-lived SSE connection
+    std::unique_ptr<Transport> make_sse_transport() const
+    {
+        if (transport)
+        {
+            if (auto custom = transport->stream_transport())
+                return custom;
+        }
+
+        auto [host, port] = parse_url(server_url);
+        std::unique_ptr<HttpTransport> sse_transport;
+
+        if (opts.basic_auth)
+        {
+            sse_transport = std::make_unique<HttpTransport>(
+                host,
+                port,
+                opts.basic_auth->first,
+                opts.basic_auth->second);
+        }
+        else
+        {
+            sse_transport = std::make_unique<HttpTransport>(host, port);
+        }
+
+        if (opts.directory)
+        {
+            sse_transport->set_directory(*opts.directory);
+        }
+        sse_transport->set_sse_reconnect(opts.sse_reconnect);
+        sse_transport->set_observer(opts.observer);
+        return sse_transport;
+    }
+
+    std::shared_ptr<EventBus> event_bus()
+    {
+        std::lock_guard<std::mutex> lock(bus_mutex);
+        if (!bus)
+            bus = std::make_shared<EventBus>(make_sse_transport(), opts.observer);
+        return bus;
+    }
+
+    /// Serve a metadata call from the cache when it is enabled
+    template <typename T, typename Fetch>
+    T cached(Metadata key, Fetch&& fetch)
+    {
+        if (!metadata)
+            return fetch();
+        if (opts.metadata_cache.invalidate_on_events && !watch_metadata())
+            return fetch(); // Changes could go unnoticed; neither serve nor fill the cache
+        return metadata->get<T>(key, std::forward<Fetch>(fetch));
+    }
+
+    /// Run a read once for all concurrent callers with the same key
+    /// A call with its own cancellation or deadline is never shared.
+    template <typename T, typename Fetch>
+    T coalesced(const std::string& key, Fetch&& fetch, const CallOptions& call = {})
+    {
+        if (!opts.coalesce_reads || call.cancel.stop_possible() || call.deadline)
+            return fetch();
+        return reads.run<T>(key, std::forward<Fetch>(fetch));
+    }
+
+    /// Drop cached metadata the server reports as changed. Once the event
+    /// stream fails, changes may be missed, so everything is dropped and the
+    /// cache is bypassed until the stream is back; a closed watch is renewed.
+    /// @return true if the watch is live, so the cache may be used
+    bool watch_metadata()
+    {
+        std::lock_guard<std::mutex> lock(metadata_watch_mutex);
+        auto watch = metadata_watch;
+        if (watch->subscribed)
+            return watch->live;
+
+        std::weak_ptr<MetadataCache> weak = metadata;
+        watch->subscribed = true;
+        watch->live = false;
+        auto bus = event_bus();
+        bus->subscribe(
+            {[weak, watch](const BusFrame& frame)
+             {
+                 auto cache = weak.lock();
+                 if (!cache)
+                     return;
+                 if (frame.type == ProjectUpdatedEvent::type)
+                 {
+                     cache->invalidate(Metadata::Project);
+                     cache->invalidate(Metadata::Config);
+                 }
+                 else
+                 {
+                     // Disposal, or server.connected (after a reconnect, events may have been missed)
+                     cache->invalidate_all();
+                     if (frame.type == ServerConnectedEvent::type)
+                         watch->live = true;
+                 }
+             },
+             [weak, watch](const std::string&)
+             {
+                 watch->live = false;
+                 if (auto cache = weak.lock())
+                     cache->invalidate_all();
+             },
+             [weak, watch]()
+             {
+                 watch->live = false;
+                 watch->subscribed = false; // The next cached() call subscribes again
+                 if (auto cache = weak.lock())
+                     cache->invalidate_all();
+             },
+             EventFilter::of<ProjectUpdatedEvent, ServerInstanceDisposedEvent, GlobalDisposedEvent,
+                             ServerConnectedEvent>()});
+
+        // A bus that connected earlier has sent its server.connected already;
+        // from here on this watch sees every change
+        if (bus->connected())
+            watch->live = true;
+        return watch->live;
+    }
 
-    Impl(ClientOptions options)
-        : opts(std::move(options))
+    HttpResponse request(const std::string& method, const std::string& path, const std::string& body = {},
+                         const CallOptions& call = {})
     {
+        throw_if_ended(call);
+        HttpRequest req;
+        req.method = method;
+        req.path = path;
+        req.body = body;
+        req.content_type = "application/json";
+        req.cancel = call.cancel;
+        req.deadline = call.deadline;
+        auto response = transport->request(req);
+        if (response.status == 0)
+            throw_if_ended(call); // The transport gave up because of it
+        return response;
     }
 
-    HttpResponse request(const std::string& method, const std::string& path, const std::string& body = {})
+    HttpResponse request_stream(const std::string& method, const std::string& path, const std::string& body,
+                                const ContentCallback& on_data, const CallOptions& call = {})
     {
+        throw_if_ended(call);
         HttpRequest req;
         req.method = method;
         req.path = path;
         req.body = body;
         req.content_type = "application/json";
-        return transport->request(req);
+        req.cancel = call.cancel;
+        req.deadline = call.deadline;
+        auto response = transport->request_stream(req, on_data);
+        if (response.status == 0)
+            throw_if_ended(call); // The transport gave up because of it
+        return response;
+    }
+
+    /// Run decode over a response body of `bytes` bytes, timing it for the observer
+    template <typename Decode>
+    auto timed_parse(size_t bytes, Decode&& decode) const
+    {
+        if (!opts.observer)
+            return decode();
+        auto begin = std::chrono::steady_clock::now();
+        auto result = decode();
+        opts.observer->on_parse("response", bytes, std::chrono::steady_clock::now() - begin);
+        return result;
+    }
+
+    /// Parse a JSON response body
+    json parse(const HttpResponse& response) const
+    {
+        return timed_parse(response.body.size(), [&] { return json::parse(response.body); });
+    }
+
+    /// POST a prompt and wait for the reply; the caller counts the generation
+    /// On cancellation, optionally asks the server to stop the generation too
+    MessageWithParts send_prompt(const std::string& session_id, const std::string& body, const CallOptions& call)
+    {
+        HttpResponse response;
+        try
+        {
+            response = request("POST", "/session/" + session_id + "/message", body, call);
+        }
+        catch (const CallCancelled&)
+        {
+            if (call.abort_session)
+            {
+                try
+                {
+                    request("POST", "/session/" + session_id + "/abort");
+                }
+                catch (...)
+                {
+                    // The cancellation is what the caller needs to hear about
+                }
+            }
+            throw;
+        }
+        if (response.status != 200)
+        {
+            throw std::runtime_error("Send message failed: " + response.error);
+        }
+
+        return parse_message_with_parts(parse(response));
+    }
+
+    /// Event-driven send_message_streaming(): submit through /prompt_async and
+    /// finish on the session.idle that follows, without holding a thread
+    /// The prompt carries a message ID chosen here, and only assistant messages
+    /// answering it (parentID) count as the reply, so an earlier turn's reply
+    /// is never taken for this one.
+    /// With on_failure set, failures go there as exceptions (CallCancelled
+    /// when the CallOptions end the call) instead of to options.on_error.
+    void stream_via_events(const std::string& session_id, json body, StreamOptions options,
+                           const CallOptions& call, std::function<void(std::exception_ptr)> on_failure = {})
+    {
+        struct StreamState
+        {
+            StreamOptions options;
+            CallOptions call;
+            std::string message_id; // Of the prompt; replies name it as their parent
+            std::function<void(std::exception_ptr)> on_failure;
+            std::function<void()> abort_session; // Set when call.abort_session
+            std::optional<std::stop_callback<std::function<void()>>> on_stop; // Ends the stream via call.cancel
+            std::atomic<bool> launched{false};  // The prompt is queued for sending
+            std::atomic<bool> submitted{false};
+            std::atomic<bool> accepted{false}; // The server took the prompt
+            std::atomic<bool> done{false};
+            std::atomic<EventBus::Id> subscription{0};
+            std::atomic<EventBus::Id> reconnects{0}; // server.connected watch
+            std::atomic<uint64_t> connection{0};     // Bus connection the reply is followed on
+            std::weak_ptr<EventBus> bus;
+            std::shared_ptr<PartStore> store;
+            std::optional<GenerationGuard> generation; // Released by finish()
+
+            // Only touched on the SSE thread
+            std::optional<Message> last;                           // Latest assistant message of the reply
+            std::unordered_map<std::string, std::vector<Part>> parts; // Message ID -> parts
+
+            /// First caller wins; releases the bus subscription
+            bool finish()
+            {
+                if (done.exchange(true))
+                    return false;
+                if (auto b = bus.lock())
+                {
+                    if (auto id = subscription.load())
+                        b->unsubscribe(id);
+                    if (auto id = reconnects.load())
+                        b->unsubscribe(id);
+                }
+                generation.reset();
+                return true;
+            }
+
+            void fail(const std::string& error)
+            {
+                if (!finish())
+                    return;
+                if (on_failure)
+                    on_failure(std::make_exception_ptr(std::runtime_error(error)));
+                else if (options.on_error)
+                    options.on_error(error);
+            }
+
+            /// End the stream because its CallOptions say so
+            void end_call(bool timed_out)
+            {
+                if (!finish())
+                    return;
+                if (submitted && abort_session)
+                    abort_session();
+                if (on_failure)
+                    on_failure(std::make_exception_ptr(CallCancelled(timed_out)));
+                else if (options.on_error)
+                    options.on_error(CallCancelled(timed_out).what());
+            }
+
+            bool past_deadline() const
+            {
+                return call.deadline && std::chrono::steady_clock::now() >= *call.deadline;
+            }
+        };
+        auto state = std::make_shared<StreamState>();
+        state->options = std::move(options);
+        state->call = call;
+        state->on_failure = std::move(on_failure);
+        if (auto it = body.find("messageID"); it != body.end() && it->is_string())
+            state->message_id = it->get<std::string>();
+        else
+            body["messageID"] = state->message_id = ascending_message_id();
+        if (call.abort_session)
+        {
+            state->abort_session = [this, path = "/session/" + session_id + "/abort"]
+            {
+                submit([this, path]
+                       {
+                           try
+                           {
+                               request("POST", path);
+                           }
+                           catch (...)
+                           {
+                               // Best effort; the stream has ended either way
+                           }
+                       });
+            };
+        }
+        state->store = state->options.part_store ? state->options.part_store : std::make_shared<PartStore>();
+        state->generation.emplace(generations);
+
+        auto bus = event_bus();
+        state->bus = bus;
+        auto id = bus->subscribe(
+            {[state](const BusFrame& frame)
+             {
+                 if (state->done || !state->submitted)
+                     return;
+                 if (state->past_deadline())
+                 {
+                     state->end_call(true);
+                     return;
+                 }
+
+                 try
+                 {
+                     if (frame.type == MessagePartUpdatedEvent::type)
+                     {
+                         auto update = stream_part_update(frame.properties, *state->store, state->options);
+                         if (!update)
+                             return;
+
+                         // Text deltas keep a placeholder; the text is taken from the store at the end
+                         auto& parts = state->parts[update->message_id];
+                         auto it = std::find_if(parts.begin(), parts.end(),
+                                                [&](const Part& p) { return part_id(p) == part_id(update->part); });
+                         auto* text = std::get_if<TextPart>(&update->part);
+                         if (text && text->is_delta)
+                         {
+                             if (it == parts.end())
+                                 parts.push_back(TextPart{.id = text->id});
+                         }
+                         else if (it != parts.end())
+                         {
+                             *it = std::move(update->part);
+                         }
+                         else
+                         {
+                             parts.push_back(std::move(update->part));
+                         }
+                         return;
+                     }
+
+                     const Event* event = frame.event();
+                     if (!event)
+                         return;
+
+                     if (auto* e = try_as<MessageUpdatedEvent>(*event))
+                     {
+                         auto* reply = std::get_if<AssistantMessage>(&e->info);
+                         if (reply && reply->parent_id == state->message_id)
+                             state->last = e->info;
+                     }
+                     else if (is<SessionIdleEvent>(*event))
+                     {
+                         // Ignore an idle that precedes the reply to this prompt
+                         if (!state->last || !state->finish())
+                             return;
+                         MessageWithParts result;
+                         result.info = std::move(*state->last);
+                         if (auto it = state->parts.find(result.id()); it != state->parts.end())
+                             result.parts = std::move(it->second);
+                         for (auto& part : result.parts)
+                         {
+                             auto* text = std::get_if<TextPart>(&part);
+                             if (!text)
+                                 continue;
+                             if (auto accumulated = state->store->text(result.id(), text->id))
+                                 text->text = *accumulated;
+                         }
+                         if (state->options.on_complete)
+                             state->options.on_complete(result);
+                     }
+                     else if (auto* e = try_as<SessionErrorEvent>(*event))
+                     {
+                         state->fail(e->error.empty() ? "Session error" : e->error);
+                     }
+                 }
+                 catch (...)
+                 {
+                     // Ignore parse errors
+                 }
+             },
+             [state](const std::string& error) { state->fail(error); },
+             [state]() { state->fail("Event stream closed"); },
+             {.types = {MessagePartUpdatedEvent::type, MessageUpdatedEvent::type, SessionIdleEvent::type,
+                        SessionErrorEvent::type},
+              .session_ids = {session_id}}});
+        state->subscription = id;
+        if (state->done)
+            bus->unsubscribe(id); // Closed before the ID was known
+        if (call.cancel.stop_possible())
+        {
+            std::weak_ptr<StreamState> weak = state;
+            state->on_stop.emplace(call.cancel, [weak]
+            {
+                if (auto s = weak.lock())
+                    s->end_call(false);
+            });
+        }
+
+        // Events sent while the transport was reconnecting are lost, the
+        // session.idle among them; ask the server whether the reply is done
+        auto recheck = [this, state, path = "/session/" + session_id + "/message?limit=1"]()
+        {
+            submit([this, state, path]
+                   {
+                       if (state->done)
+                           return;
+                       try
+                       {
+                           auto response = request("GET", path);
+                           if (response.status != 200)
+                               throw std::runtime_error("Get messages failed: " + response.error);
+                           auto j = parse(response);
+                           if (!j.is_array() || j.empty())
+                               return;
+                           auto message = parse_message_with_parts(j.back());
+                           // The last message may still be the prompt, or an earlier
+                           // turn's reply if the server has not started on this one
+                           auto* info = std::get_if<AssistantMessage>(&message.info);
+                           if (!info || info->parent_id != state->message_id || !info->time.completed)
+                               return; // Still generating; the new connection sees the rest
+                           if (state->finish() && state->options.on_complete)
+                               state->options.on_complete(message);
+                       }
+                       catch (const std::exception& e)
+                       {
+                           state->fail(std::string("Event stream reconnected and the reply could not be checked: ") +
+                                       e.what());
+                       }
+                   });
+        };
+        auto send = [this, state, bus, recheck, path = "/session/" + session_id + "/prompt_async",
+                     body = body.dump()]()
+        {
+            if (state->done)
+                return; // Already ended through its CallOptions
+            state->connection = bus->connections();
+            state->submitted = true;
+            try
+            {
+                auto response = request("POST", path, body, state->call);
+                if (response.status != 200 && response.status != 204)
+                    throw std::runtime_error("Send prompt failed: " + response.error);
+                state->accepted = true;
+                if (bus->connections() != state->connection)
+                    recheck(); // Reconnected while the prompt was being sent
+            }
+            catch (const CallCancelled& e)
+            {
+                state->end_call(e.timed_out());
+            }
+            catch (const std::exception& e)
+            {
+                state->fail(e.what());
+            }
+        };
+
+        // Replies are only seen once the bus is connected. The prompt goes out
+        // on a pool worker as soon as it is, whether that is now or on the
+        // server.connected frame; nothing waits for the bus in the meantime.
+        // The client shuts the bus down before draining its workers, so the
+        // Impl captured by send outlives the task.
+        auto launch = [this, state, send = std::move(send)]()
+        {
+            if (!state->done && !state->launched.exchange(true))
+                submit(send);
+        };
+        auto watch = bus->subscribe(
+            {[state, recheck, launch](const BusFrame& frame)
+             {
+                 if (state->done)
+                     return;
+                 if (!state->launched)
+                 {
+                     launch();
+                     return;
+                 }
+                 if (!state->accepted)
+                     return;
+                 if (state->connection.exchange(frame.connection) != frame.connection)
+                     recheck();
+             },
+             {},
+             {},
+             EventFilter::of<ServerConnectedEvent>()});
+        state->reconnects = watch;
+        if (state->done)
+            bus->unsubscribe(watch);
+        else if (bus->wait_connected(std::chrono::milliseconds(0)))
+            launch();
     }
 
     bool try_connect(const std::string& host, int port)
@@ -1119,6 +4295,12 @@ struct Client::Impl
 
                 static_cast<HttpTransport*>(transport.get())->set_connection_timeout(opts.connection_timeout);
                 static_cast<HttpTransport*>(transport.get())->set_read_timeout(opts.read_timeout);
+                static_cast<HttpTransport*>(transport.get())->set_max_connections(
+                    static_cast<size_t>(std::max(opts.max_connections, 1)));
+                static_cast<HttpTransport*>(transport.get())->set_idle_timeout(opts.idle_connection_timeout);
+                static_cast<HttpTransport*>(transport.get())->set_compression(opts.compression);
+                static_cast<HttpTransport*>(transport.get())->set_response_cache(opts.response_cache_bytes);
+                static_cast<HttpTransport*>(transport.get())->set_observer(opts.observer);
 
                 server_url = "http://" + host + ":" + std::to_string(port);
                 connected = true;
@@ -1138,19 +4320,29 @@ Client::Client() : Client(ClientOptions{})
 }
 
 Client::Client(ClientOptions opts)
-    : impl_(std::make_unique<Impl>(std::move(opts)))
+    : impl_(std::make_unique<Impl>(this, std::move(opts)))
 {
     connect();
 }
 
 Client::Client(ClientOptions opts, std::unique_ptr<Transport> transport)
-    : impl_(std::make_unique<Impl>(std::move(opts)))
+    : impl_(std::make_unique<Impl>(this, std::move(opts)))
 {
     impl_->transport = std::move(transport);
     impl_->connected = true;
     impl_->server_url = impl_->opts.base_url.value_or("http://127.0.0.1:4096");
 }
 
+Client::Client(ServerLease lease, ClientOptions opts)
+    : impl_(std::make_unique<Impl>(this, std::move(opts)))
+{
+    if (!lease)
+        throw std::runtime_error("Server lease is empty");
+    impl_->opts.base_url = lease.url();
+    impl_->lease = std::make_unique<ServerLease>(std::move(lease));
+    connect();
+}
+
 void Client::connect()
 {
     // If explicit URL provided, connect to it (no spawn)
@@ -1181,9 +4373,34 @@ void Client::connect()
     throw std::runtime_error("Failed to connect to spawned server at " + impl_->server->url());
 }
 
-Client::~Client() = default;
-Client::Client(Client&&) noexcept = default;
-Client& Client::operator=(Client&&) noexcept = default;
+Client::~Client()
+{
+    // Pending async calls still use this client - let them finish first. The
+    // event stream goes first so that calls waiting for it give up.
+    if (impl_)
+    {
+        impl_->shutdown_events();
+        impl_->shutdown_executor();
+    }
+}
+
+Client::Client(Client&& other) noexcept
+    : impl_(std::move(other.impl_))
+{
+    if (impl_)
+        impl_->self = this;
+}
+
+Client& Client::operator=(Client&& other) noexcept
+{
+    if (this != &other)
+    {
+        impl_ = std::move(other.impl_);
+        if (impl_)
+            impl_->self = this;
+    }
+    return *this;
+}
 
 // =============================================================================
 // Connection
@@ -1199,6 +4416,22 @@ std::string Client::server_url() const
     return impl_->server_url;
 }
 
+size_t Client::generations_in_flight() const
+{
+    return impl_->generations->load(std::memory_order_relaxed);
+}
+
+MetadataCacheStats Client::metadata_cache_stats() const
+{
+    return impl_->metadata ? impl_->metadata->stats() : MetadataCacheStats{};
+}
+
+void Client::invalidate_metadata()
+{
+    if (impl_->metadata)
+        impl_->metadata->invalidate_all();
+}
+
 const ClientOptions& Client::options() const
 {
     return impl_->opts;
@@ -1216,7 +4449,7 @@ HealthInfo Client::health()
         throw std::runtime_error("Health check failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     HealthInfo info;
     if (j.contains("healthy"))
         info.healthy = j["healthy"].get<bool>();
@@ -1231,25 +4464,38 @@ HealthInfo Client::health()
 
 std::vector<SessionInfo> Client::list_sessions()
 {
-    auto response = impl_->request("GET", "/session");
-    if (response.status != 200)
-    {
-        throw std::runtime_error("List sessions failed: " + response.error);
-    }
+    return impl_->list_sessions();
+}
 
-    auto j = json::parse(response.body);
-    std::vector<SessionInfo> sessions;
-    if (j.is_array())
+std::vector<SessionInfo> Client::Impl::list_sessions()
+{
+    return coalesced<std::vector<SessionInfo>>("GET /session", [&]
     {
-        for (const auto& item : j)
+        auto response = request("GET", "/session");
+        if (response.status != 200)
         {
-            sessions.push_back(parse_session(item));
+            throw std::runtime_error("List sessions failed: " + response.error);
         }
-    }
-    return sessions;
+
+        auto j = parse(response);
+        std::vector<SessionInfo> sessions;
+        if (j.is_array())
+        {
+            for (const auto& item : j)
+            {
+                sessions.push_back(parse_session(item));
+            }
+        }
+        return sessions;
+    });
 }
 
 Session Client::create_session(const std::string& title)
+{
+    return Session(this, impl_->create_session(title));
+}
+
+SessionInfo Client::Impl::create_session(const std::string& title)
 {
     json body = json::object();
     if (!title.empty())
@@ -1257,14 +4503,13 @@ Session Client::create_session(const std::string& title)
         body["title"] = title;
     }
 
-    auto response = impl_->request("POST", "/session", body.dump());
+    auto response = request("POST", "/session", body.dump());
     if (response.status != 200)
     {
         throw std::runtime_error("Create session failed: " + response.error);
     }
 
-    auto info = parse_session(json::parse(response.body));
-    return Session(this, std::move(info));
+    return parse_session(parse(response));
 }
 
 Session Client::get_session(const std::string& session_id)
@@ -1279,7 +4524,7 @@ Session Client::get_session(const std::string& session_id)
         throw std::runtime_error("Get session failed: " + response.error);
     }
 
-    auto info = parse_session(json::parse(response.body));
+    auto info = parse_session(impl_->parse(response));
     return Session(this, std::move(info));
 }
 
@@ -1297,200 +4542,317 @@ MessageWithParts Client::send_message(
     const std::string& session_id,
     const std::string& prompt,
     const std::string& provider_id,
-    const std::string& model_id)
+    const std::string& model_id,
+    const CallOptions& call)
 {
-    json body = json::object();
-    body["parts"] = json::array({json::object({{"type", "text"}, {"text", prompt}})});
+    GenerationGuard generation(impl_->generations);
+    return impl_->send_prompt(session_id, prompt_body(prompt, provider_id, model_id).dump(), call);
+}
 
-    // Add model specification if provided
-    if (!provider_id.empty() || !model_id.empty())
+void Client::send_message_streaming(
+    const std::string& session_id,
+    const std::string& prompt,
+    const std::string& provider_id,
+    const std::string& model_id,
+    StreamOptions options,
+    const CallOptions& call)
+{
+    if (options.event_driven)
     {
-        json model = json::object();
-        if (!provider_id.empty())
-            model["providerID"] = provider_id;
-        if (!model_id.empty())
-            model["modelID"] = model_id;
-        body["model"] = model;
+        impl_->stream_via_events(session_id, prompt_body(prompt, provider_id, model_id), std::move(options),
+                                 call);
+        return;
+    }
+    GenerationGuard generation(impl_->generations);
+
+    // Shared state for SSE callback
+    struct StreamState
+    {
+        StreamOptions options;
+        std::shared_ptr<PartStore> store;
+        std::atomic<bool> done{false};
+    };
+    auto state = std::make_shared<StreamState>();
+    state->options = std::move(options);
+    state->store = state->options.part_store ? state->options.part_store : std::make_shared<PartStore>();
+
+    // Receive part updates for this session from the shared event bus
+    auto bus = impl_->event_bus();
+    auto subscription = bus->subscribe(
+        {[state](const BusFrame& frame)
+         {
+             if (state->done)
+                 return;
+
+             try
+             {
+                 // Handle message.part.updated events for our session
+                 if (frame.type == MessagePartUpdatedEvent::type &&
+                     (state->options.on_part || state->options.on_text))
+                 {
+                     stream_part_update(frame.properties, *state->store, state->options);
+                 }
+             }
+             catch (...)
+             {
+                 // Ignore parse errors
+             }
+         },
+         [state](const std::string& error)
+         {
+             if (!state->done && state->options.on_error)
+             {
+                 state->options.on_error(error);
+             }
+         },
+         {},
+         {.types = {MessagePartUpdatedEvent::type}, .session_ids = {session_id}}});
+
+    // Wait for the bus to be connected (immediate if it already is)
+    bus->wait_connected(std::chrono::seconds(2));
+
+    // Send the message (blocks until complete)
+    try
+    {
+        // Counted by the guard above, so not through send_message()
+        auto result = impl_->send_prompt(session_id, prompt_body(prompt, provider_id, model_id).dump(), call);
+        state->done = true;
+        bus->unsubscribe(subscription);
+
+        if (state->options.on_complete)
+        {
+            state->options.on_complete(result);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        state->done = true;
+        bus->unsubscribe(subscription);
+
+        if (state->options.on_error)
+        {
+            state->options.on_error(e.what());
+        }
+    }
+}
+
+std::vector<MessageWithParts> Client::get_messages(
+    const std::string& session_id,
+    std::optional<int> limit,
+    const CallOptions& call)
+{
+    return impl_->get_messages(session_id, limit, call);
+}
+
+std::vector<MessageWithParts> Client::Impl::get_messages(
+    const std::string& session_id,
+    std::optional<int> limit,
+    const CallOptions& call)
+{
+    std::string path = "/session/" + session_id + "/message";
+    if (limit)
+    {
+        path += "?limit=" + std::to_string(*limit);
     }
 
-    auto response = impl_->request("POST", "/session/" + session_id + "/message", body.dump());
+    auto response = request("GET", path, {}, call);
     if (response.status != 200)
     {
-        throw std::runtime_error("Send message failed: " + response.error);
+        throw std::runtime_error("Get messages failed: " + response.error);
     }
 
-    return parse_message_with_parts(json::parse(response.body));
+    std::vector<MessageWithParts> messages;
+    timed_parse(response.body.size(), [&]
+    {
+        return decode_array(response.body, {}, [&](json&& item)
+                            {
+                                messages.push_back(parse_message_with_parts(item));
+                                return true;
+                            });
+    });
+    return messages;
 }
 
-void Client::send_message_streaming(
+// =============================================================================
+// Async API
+// =============================================================================
+
+std::future<MessageWithParts> Client::send_message_async(
     const std::string& session_id,
     const std::string& prompt,
     const std::string& provider_id,
     const std::string& model_id,
-    StreamOptions options)
+    const CallOptions& call)
 {
-    // Create SSE transport for events
-    auto [host, port] = parse_url(impl_->server_url);
-    std::unique_ptr<HttpTransport> sse_transport;
+    // Submitted through /prompt_async and completed from the event stream,
+    // so a pending reply holds no thread
+    auto reply = std::make_shared<std::promise<MessageWithParts>>();
+    auto future = reply->get_future();
+    StreamOptions options;
+    options.event_driven = true;
+    options.on_complete = [reply](const MessageWithParts& message) { reply->set_value(message); };
+    impl_->stream_via_events(session_id, prompt_body(prompt, provider_id, model_id), std::move(options),
+                             call, [reply](std::exception_ptr error) { reply->set_exception(error); });
+    return future;
+}
 
-    if (impl_->opts.basic_auth)
+CompactHistory Client::get_messages_compact(const std::string& session_id, std::optional<int> limit)
+{
+    std::string path = "/session/" + session_id + "/message";
+    if (limit)
     {
-        sse_transport = std::make_unique<HttpTransport>(
-            host, port,
-            impl_->opts.basic_auth->first,
-            impl_->opts.basic_auth->second);
+        path += "?limit=" + std::to_string(*limit);
     }
-    else
+
+    auto response = impl_->request("GET", path);
+    if (response.status != 200)
     {
-        sse_transport = std::make_unique<HttpTransport>(host, port);
+        throw std::runtime_error("Get messages failed: " + response.error);
     }
 
-    if (impl_->opts.directory)
+    // Size the arena's first block for roughly the whole history
+    CompactHistory history(response.body.size());
+    impl_->timed_parse(response.body.size(), [&]
     {
-        sse_transport->set_directory(*impl_->opts.directory);
-    }
+        return decode_array(response.body, {}, [&](json&& item)
+                            {
+                                add_compact_message(item, history);
+                                return true;
+                            });
+    });
+    return history;
+}
 
-    // Shared state for SSE callback
-    struct StreamState
+std::future<std::vector<MessageWithParts>> Client::get_messages_async(
+    const std::string& session_id,
+    std::optional<int> limit,
+    const CallOptions& call)
+{
+    return impl_->submit([impl = impl_.get(), session_id, limit, call]
     {
-        std::string session_id;
-        StreamOptions options;
-        std::atomic<bool> done{false};
-        std::atomic<bool> connected{false};
-        std::mutex mutex;
-        std::condition_variable cv;
-    };
-    auto state = std::make_shared<StreamState>();
-    state->session_id = session_id;
-    state->options = std::move(options);
+        return impl->get_messages(session_id, limit, call);
+    });
+}
 
-    // Start SSE in background to receive part updates
-    sse_transport->start_sse(
-        "/event",
-        {},
-        [state](const SSEEvent& sse_event)
-        {
-            if (state->done)
-                return;
+std::future<Session> Client::create_session_async(const std::string& title)
+{
+    return impl_->submit([impl = impl_.get(), title]
+    {
+        auto info = impl->create_session(title);
+        return Session(impl->self.load(), std::move(info)); // Bound to wherever the client is now
+    });
+}
 
-            try
-            {
-                // Parse the JSON data to get event type
-                auto j = json::parse(sse_event.data);
-                std::string event_type = j.value("type", "");
+std::future<std::vector<SessionInfo>> Client::list_sessions_async()
+{
+    return impl_->submit([impl = impl_.get()] { return impl->list_sessions(); });
+}
 
-                // Wait for server.connected to signal we're ready
-                if (event_type == "server.connected")
-                {
-                    state->connected = true;
-                    state->cv.notify_all();
-                    return;
-                }
+std::future<bool> Client::abort_session_async(const std::string& session_id)
+{
+    return impl_->submit([impl = impl_.get(), session_id] { return impl->abort_session(session_id); });
+}
 
-                // Handle message.part.updated events for our session
-                if (event_type == "message.part.updated")
-                {
-                    auto props = j.value("properties", json::object());
-                    if (props.contains("part"))
-                    {
-                        const auto& part_json = props["part"];
-                        std::string event_session_id = part_json.value("sessionID", "");
-                        if (event_session_id == state->session_id && state->options.on_part)
-                        {
-                            // If there's a delta, use it to update the text part
-                            Part part = parse_part(part_json);
-                            if (props.contains("delta") && props["delta"].is_string())
-                            {
-                                std::string delta = props["delta"].get<std::string>();
-                                if (auto* text_part = std::get_if<TextPart>(&part))
-                                {
-                                    text_part->text = delta;  // Use delta as the text
-                                    text_part->is_delta = true;
-                                }
-                            }
-                            state->options.on_part(part);
-                        }
-                    }
-                }
-            }
-            catch (...)
+std::future<FileContent> Client::read_file_async(const std::string& path, const CallOptions& call)
+{
+    return impl_->submit([impl = impl_.get(), path, call] { return impl->read_file(path, call); });
+}
+
+std::future<TextSearchResult> Client::find_text_async(const TextSearchOptions& options, const CallOptions& call)
+{
+    return impl_->submit([impl = impl_.get(), options, call] { return impl->find_text(options, call); });
+}
+
+// =============================================================================
+// Batch
+// =============================================================================
+
+namespace
+{
+
+/// Run task(0..count-1) on up to max_concurrency threads, the caller included
+/// An exception from task is rethrown here once every thread has joined.
+template <typename Task>
+void run_concurrently(size_t count, int max_concurrency, Task&& task)
+{
+    std::atomic<size_t> next{0};
+    std::mutex failure_mutex;
+    std::exception_ptr failure; // First exception out of task; no items are started after it
+    auto worker = [&]
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            try
             {
-                // Ignore parse errors
+                task(i);
             }
-        },
-        [state](const std::string& error)
-        {
-            if (!state->done && state->options.on_error)
+            catch (...)
             {
-                state->options.on_error(error);
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if (!failure)
+                    failure = std::current_exception();
+                next = count;
             }
-            state->connected = true;  // Unblock waiter on error
-            state->cv.notify_all();
-        },
-        [state]()
-        {
-            // Connection closed
-            state->cv.notify_all();
         }
-    );
+    };
 
-    // Wait for SSE connection (max 2 seconds)
-    {
-        std::unique_lock<std::mutex> lock(state->mutex);
-        state->cv.wait_for(lock, std::chrono::seconds(2), [state]
-        {
-            return state->connected.load();
-        });
-    }
+    // The calling thread is one of the workers
+    size_t concurrency = std::min(count, static_cast<size_t>(std::max(max_concurrency, 1)));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < concurrency; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+    if (failure)
+        std::rethrow_exception(failure);
+}
 
-    // Send the message (blocks until complete)
-    try
+} // namespace
+
+std::vector<BatchResult> Client::send_batch(std::span<const BatchItem> items, const BatchOptions& options,
+                                            const CallOptions& call)
+{
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+
+    std::vector<BatchResult> results(items.size());
+    std::mutex callback_mutex;
+    auto batch_start = Clock::now();
+
+    run_concurrently(items.size(), options.max_concurrency, [&](size_t i)
     {
-        auto result = send_message(session_id, prompt, provider_id, model_id);
-        state->done = true;
-        sse_transport->stop_sse();
+        const auto& item = items[i];
+        auto& result = results[i];
+        result.index = i;
+        result.session_id = item.session_id;
 
-        if (state->options.on_complete)
+        result.queued = duration_cast<milliseconds>(Clock::now() - batch_start);
+        std::optional<Clock::time_point> sent; // Session creation is not part of the round trip
+        try
         {
-            state->options.on_complete(result);
+            throw_if_ended(call);
+            if (result.session_id.empty())
+                result.session_id = create_session().id();
+            sent = Clock::now();
+            result.message = send_message(result.session_id, item.prompt, item.provider_id, item.model_id, call);
         }
-    }
-    catch (const std::exception& e)
-    {
-        state->done = true;
-        sse_transport->stop_sse();
-
-        if (state->options.on_error)
+        catch (const std::exception& e)
         {
-            state->options.on_error(e.what());
+            result.error = e.what();
         }
-    }
-}
-
-std::vector<MessageWithParts> Client::get_messages(const std::string& session_id, std::optional<int> limit)
-{
-    std::string path = "/session/" + session_id + "/message";
-    if (limit)
-    {
-        path += "?limit=" + std::to_string(*limit);
-    }
-
-    auto response = impl_->request("GET", path);
-    if (response.status != 200)
-    {
-        throw std::runtime_error("Get messages failed: " + response.error);
-    }
+        if (sent)
+            result.elapsed = duration_cast<milliseconds>(Clock::now() - *sent);
 
-    auto j = json::parse(response.body);
-    std::vector<MessageWithParts> messages;
-    if (j.is_array())
-    {
-        for (const auto& item : j)
+        if (options.on_result)
         {
-            messages.push_back(parse_message_with_parts(item));
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            options.on_result(result);
         }
-    }
-    return messages;
+    });
+
+    return results;
 }
 
 // =============================================================================
@@ -1499,7 +4861,12 @@ std::vector<MessageWithParts> Client::get_messages(const std::string& session_id
 
 bool Client::abort_session(const std::string& session_id)
 {
-    auto response = impl_->request("POST", "/session/" + session_id + "/abort");
+    return impl_->abort_session(session_id);
+}
+
+bool Client::Impl::abort_session(const std::string& session_id)
+{
+    auto response = request("POST", "/session/" + session_id + "/abort");
     return response.status == 200;
 }
 
@@ -1532,7 +4899,7 @@ std::string Client::summarize_session(
         throw std::runtime_error("Summarize session failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     return j.value("summary", "");
 }
 
@@ -1554,7 +4921,7 @@ SessionInfo Client::revert_message(
         throw std::runtime_error("Revert message failed: " + response.error);
     }
 
-    return parse_session(json::parse(response.body));
+    return parse_session(impl_->parse(response));
 }
 
 SessionInfo Client::unrevert_session(const std::string& session_id)
@@ -1565,7 +4932,7 @@ SessionInfo Client::unrevert_session(const std::string& session_id)
         throw std::runtime_error("Unrevert session failed: " + response.error);
     }
 
-    return parse_session(json::parse(response.body));
+    return parse_session(impl_->parse(response));
 }
 
 SessionInfo Client::share_session(const std::string& session_id)
@@ -1576,7 +4943,7 @@ SessionInfo Client::share_session(const std::string& session_id)
         throw std::runtime_error("Share session failed: " + response.error);
     }
 
-    return parse_session(json::parse(response.body));
+    return parse_session(impl_->parse(response));
 }
 
 SessionInfo Client::unshare_session(const std::string& session_id)
@@ -1587,7 +4954,7 @@ SessionInfo Client::unshare_session(const std::string& session_id)
         throw std::runtime_error("Unshare session failed: " + response.error);
     }
 
-    return parse_session(json::parse(response.body));
+    return parse_session(impl_->parse(response));
 }
 
 // =============================================================================
@@ -1602,7 +4969,7 @@ std::vector<PermissionRequest> Client::list_permissions()
         throw std::runtime_error("List permissions failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<PermissionRequest> requests;
     if (j.is_array())
     {
@@ -1639,7 +5006,7 @@ std::vector<Project> Client::list_projects()
         throw std::runtime_error("List projects failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<Project> projects;
     if (j.is_array())
     {
@@ -1653,131 +5020,95 @@ std::vector<Project> Client::list_projects()
 
 Project Client::current_project()
 {
-    auto response = impl_->request("GET", "/project/current");
-    if (response.status != 200)
+    return impl_->cached<Project>(Metadata::Project, [&]
     {
-        throw std::runtime_error("Get current project failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/project/current");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("Get current project failed: " + response.error);
+        }
 
-    return parse_project(json::parse(response.body));
+        return parse_project(impl_->parse(response));
+    });
 }
 
 // =============================================================================
 // Events
 // =============================================================================
 
-EventStream Client::subscribe_events()
+EventStream Client::subscribe_events(const EventFilter& filter, const EventStreamOptions& options)
 {
-    EventStream stream;
+    Client* self = this;
+    return subscribe_events(std::span<Client* const>(&self, 1), filter, options);
+}
 
-    // Create a separate transport for SSE
-    auto [host, port] = parse_url(impl_->server_url);
-    std::unique_ptr<HttpTransport> sse_transport;
+EventStream Client::subscribe_events(
+    std::span<Client* const> clients,
+    const EventFilter& filter,
+    const EventStreamOptions& options)
+{
+    if (clients.empty())
+        throw std::runtime_error("Subscribe events needs at least one client");
 
-    if (impl_->opts.basic_auth)
-    {
-        sse_transport = std::make_unique<HttpTransport>(
-            host,
-            port,
-            impl_->opts.basic_auth->first,
-            impl_->opts.basic_auth->second);
-    }
-    else
-    {
-        sse_transport = std::make_unique<HttpTransport>(host, port);
-    }
+    EventStream stream;
+    auto impl = stream.impl_;
+    impl->options = options;
+    impl->observer = clients.front()->impl_->opts.observer;
+    impl->shared_producers = clients.size() > 1;
+    impl->open_sources = clients.size();
 
-    if (impl_->opts.directory)
+    for (Client* client : clients)
     {
-        sse_transport->set_directory(*impl_->opts.directory);
+        // Attach to each client's shared SSE connection; a bus reports an error
+        // and a close for the same failure, so each source ends only once
+        auto bus = client->impl_->event_bus();
+        auto ended = std::make_shared<std::atomic<bool>>(false);
+        auto id = bus->subscribe(
+            {[impl](const BusFrame& frame)
+             {
+                 // Decode the event and add to queue
+                 try
+                 {
+                     const Event* event = frame.event();
+                     if (!event)
+                         return;
+
+                     impl->push(*event);
+                 }
+                 catch (const std::exception& e)
+                 {
+                     // Log or handle parse errors
+                 }
+             },
+             [impl, ended](const std::string& error)
+             {
+                 if (!ended->exchange(true))
+                     impl->end_source(&error);
+             },
+             [impl, ended]()
+             {
+                 if (!ended->exchange(true))
+                     impl->end_source();
+             },
+             filter});
+
+        std::lock_guard<std::mutex> lock(impl->sources_mutex);
+        impl->sources.push_back({bus, id});
     }
 
-    stream.impl_->transport = std::move(sse_transport);
-
-    // Start SSE connection
-    auto impl = stream.impl_;
-    stream.impl_->transport->start_sse(
-        "/event",
-        {},
-        [impl](const SSEEvent& sse_event)
-        {
-            // Parse the event and add to queue
-            try
-            {
-                std::lock_guard<std::mutex> lock(impl->mutex);
-                if (impl->closed)
-                    return;
-
-                // Parse JSON to get event type from data
-                auto j = json::parse(sse_event.data);
-                std::string event_type = j.value("type", "");
-                auto props = j.value("properties", json::object());
-
-                // Parse based on event type
-                if (event_type == "server.connected")
-                {
-                    impl->events.push(ServerConnectedEvent{});
-                }
-                else if (event_type == "server.heartbeat")
-                {
-                    impl->events.push(ServerHeartbeatEvent{});
-                }
-                else if (event_type == "session.created")
-                {
-                    SessionCreatedEvent event;
-                    event.session = parse_session(props);
-                    impl->events.push(event);
-                }
-                else if (event_type == "session.updated")
-                {
-                    SessionUpdatedEvent event;
-                    event.session = parse_session(props);
-                    impl->events.push(event);
-                }
-                else if (event_type == "permission.asked")
-                {
-                    PermissionAskedEvent event;
-                    event.request = parse_permission_request(props);
-                    impl->events.push(event);
-                }
-                else if (event_type == "message.part.updated")
-                {
-                    if (props.contains("part"))
-                    {
-                        MessagePartUpdatedEvent event;
-                        const auto& part_json = props["part"];
-                        event.session_id = part_json.value("sessionID", "");
-                        event.message_id = part_json.value("messageID", "");
-                        event.part = parse_part(part_json);
-                        impl->events.push(event);
-                    }
-                }
-                // Add more event types as needed...
-
-                impl->cv.notify_all();
-            }
-            catch (const std::exception& e)
-            {
-                // Log or handle parse errors
-            }
-        },
-        [impl](const std::string& error)
-        {
-            std::lock_guard<std::mutex> lock(impl->mutex);
-            impl->error = error;
-            impl->closed = true;
-            impl->cv.notify_all();
-        },
-        [impl]()
-        {
-            std::lock_guard<std::mutex> lock(impl->mutex);
-            impl->closed = true;
-            impl->cv.notify_all();
-        });
-
     return stream;
 }
 
+MessageCache Client::message_cache(const std::string& session_id)
+{
+    MessageCache cache;
+    cache.impl_->client = this;
+    cache.impl_->session_id = session_id;
+    cache.impl_->bus = impl_->event_bus();
+    cache.impl_->connect_timeout = std::chrono::seconds(impl_->opts.connection_timeout);
+    return cache;
+}
+
 // =============================================================================
 // File Operations
 // =============================================================================
@@ -1794,7 +5125,7 @@ std::vector<FileEntry> Client::list_files(const std::string& path)
         throw std::runtime_error("List files failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<FileEntry> entries;
     if (j.is_array())
     {
@@ -1804,9 +5135,37 @@ std::vector<FileEntry> Client::list_files(const std::string& path)
     return entries;
 }
 
-FileContent Client::read_file(const std::string& path)
+FileContent Client::read_file(const std::string& path, const CallOptions& call)
+{
+    return impl_->read_file(path, call);
+}
+
+FileContent Client::Impl::read_file(const std::string& path, const CallOptions& call)
+{
+    return coalesced<FileContent>("GET /file/" + path, [&]
+    {
+        auto response = request("GET", "/file/" + path, {}, call);
+        if (response.status == 404)
+        {
+            throw std::runtime_error("File not found: " + path);
+        }
+        if (response.status != 200)
+        {
+            throw std::runtime_error("Read file failed: " + response.error);
+        }
+
+        return parse_file_content(timed_parse(response.body.size(), [&] { return decode_object(response.body); }));
+    }, call);
+}
+
+FileContent Client::read_file_stream(const std::string& path, const FileChunkCallback& on_chunk, const FileRange& range,
+                                     const CallOptions& call)
 {
-    auto response = impl_->request("GET", "/file/" + path);
+    StringMemberStreamer streamer("content", range, on_chunk);
+    auto response = impl_->request_stream("GET", "/file/" + path, {}, [&](std::string_view data)
+    {
+        return streamer.feed(data);
+    }, call);
     if (response.status == 404)
     {
         throw std::runtime_error("File not found: " + path);
@@ -1816,7 +5175,51 @@ FileContent Client::read_file(const std::string& path)
         throw std::runtime_error("Read file failed: " + response.error);
     }
 
-    return parse_file_content(json::parse(response.body));
+    // Members after the content are not seen when reading stopped early
+    FileContent content;
+    if (streamer.complete())
+        content = parse_file_content(streamer.rest());
+    if (content.path.empty())
+        content.path = path;
+    return content;
+}
+
+size_t Client::read_file_into(const std::string& path, std::span<char> buffer, size_t offset)
+{
+    size_t written = 0;
+    read_file_stream(path, [&](std::string_view chunk)
+    {
+        std::memcpy(buffer.data() + written, chunk.data(), chunk.size());
+        written += chunk.size();
+        return true;
+    }, {.offset = offset, .length = buffer.size()});
+    return written;
+}
+
+size_t Client::read_file_to(const std::string& path, int fd, const FileRange& range)
+{
+    size_t written = 0;
+    read_file_stream(path, [&](std::string_view chunk)
+    {
+        while (!chunk.empty())
+        {
+#ifdef _WIN32
+            auto n = ::_write(fd, chunk.data(), static_cast<unsigned>(std::min<size_t>(chunk.size(), INT_MAX)));
+#else
+            auto n = ::write(fd, chunk.data(), chunk.size());
+#endif
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Write to file descriptor failed: " + std::string(std::strerror(errno)));
+            }
+            chunk.remove_prefix(static_cast<size_t>(n));
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }, range);
+    return written;
 }
 
 FileStatus Client::file_status(const std::string& path)
@@ -1831,14 +5234,70 @@ FileStatus Client::file_status(const std::string& path)
         throw std::runtime_error("Get file status failed: " + response.error);
     }
 
-    return parse_file_status(json::parse(response.body));
+    return parse_file_status(impl_->parse(response));
+}
+
+namespace
+{
+
+/// read_files() / file_statuses(): fetch(path) for each path, concurrently
+template <typename T, typename Fetch>
+std::vector<FileResult<T>> fetch_files(std::span<const std::string> paths, const FileBatchOptions<T>& options, Fetch&& fetch)
+{
+    std::vector<FileResult<T>> results(paths.size());
+    std::mutex callback_mutex;
+
+    run_concurrently(paths.size(), options.max_concurrency, [&](size_t i)
+    {
+        auto& result = results[i];
+        result.index = i;
+        result.path = paths[i];
+        try
+        {
+            result.value = fetch(paths[i]);
+        }
+        catch (const std::exception& e)
+        {
+            // ok() is an empty error, so a failure must never leave it empty
+            result.error = *e.what() ? e.what() : "Unknown error";
+        }
+        catch (...)
+        {
+            result.error = "Unknown error";
+        }
+
+        if (options.on_result)
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            options.on_result(result);
+        }
+        if (!options.collect)
+            result.value.reset();
+    });
+
+    return results;
+}
+
+} // namespace
+
+std::vector<FileReadResult> Client::read_files(std::span<const std::string> paths, const FileBatchOptions<FileContent>& options)
+{
+    return fetch_files(paths, options, [this](const std::string& path) { return read_file(path); });
+}
+
+std::vector<FileStatusResult> Client::file_statuses(std::span<const std::string> paths, const FileBatchOptions<FileStatus>& options)
+{
+    return fetch_files(paths, options, [this](const std::string& path) { return file_status(path); });
 }
 
 // =============================================================================
 // Find Operations
 // =============================================================================
 
-TextSearchResult Client::find_text(const TextSearchOptions& options)
+namespace
+{
+
+json text_search_body(const TextSearchOptions& options)
 {
     json body = json::object();
     body["pattern"] = options.pattern;
@@ -1848,14 +5307,94 @@ TextSearchResult Client::find_text(const TextSearchOptions& options)
         body["limit"] = *options.limit;
     body["regex"] = options.regex;
     body["caseSensitive"] = options.case_sensitive;
+    return body;
+}
+
+} // namespace
+
+TextSearchResult Client::find_text(const TextSearchOptions& options, const CallOptions& call)
+{
+    return impl_->find_text(options, call);
+}
 
-    auto response = impl_->request("POST", "/find/text", body.dump());
+TextSearchResult Client::Impl::find_text(const TextSearchOptions& options, const CallOptions& call)
+{
+    auto response = request("POST", "/find/text", text_search_body(options).dump(), call);
+    if (response.status != 200)
+    {
+        throw std::runtime_error("Find text failed: " + response.error);
+    }
+
+    TextSearchResult result;
+    auto totals = timed_parse(response.body.size(), [&]
+    {
+        return decode_array(response.body, "matches", [&](json&& match)
+                            {
+                                result.matches.push_back(parse_text_match(match));
+                                return true;
+                            });
+    });
+    parse_text_search_totals(totals, result);
+    return result;
+}
+
+TextSearchResult Client::find_text_stream(
+    const TextSearchOptions& options,
+    const TextMatchCallback& on_match,
+    const TextSearchStreamOptions& stream,
+    const CallOptions& call)
+{
+    auto body = text_search_body(options);
+    if (stream.max_matches && !options.limit)
+        body["limit"] = std::min<size_t>(*stream.max_matches, INT_MAX); // Don't let the server find more
+
+    size_t delivered = 0;
+    auto on_element = [&](json&& match)
+    {
+        if (stream.max_matches && delivered >= *stream.max_matches)
+            return false;
+        ++delivered;
+        if (!on_match(parse_text_match(match)))
+            return false;
+        return !(stream.max_matches && delivered >= *stream.max_matches);
+    };
+
+    // Running out of time ends the search like max_matches does: the matches
+    // delivered so far stand and the result is marked truncated. Only a stop
+    // request throws.
+    TextSearchResult result;
+    auto expired = [&]
+    {
+        return call.deadline && std::chrono::steady_clock::now() >= *call.deadline;
+    };
+
+    ArrayMemberStreamer<decltype(on_element)> streamer("matches", on_element);
+    HttpResponse response;
+    try
+    {
+        response = impl_->request_stream("POST", "/find/text", body.dump(), [&](std::string_view data)
+        {
+            return !expired() && streamer.feed(data);
+        }, call);
+    }
+    catch (const CallCancelled& e)
+    {
+        if (!e.timed_out())
+            throw;
+        result.truncated = true;
+        return result;
+    }
     if (response.status != 200)
     {
         throw std::runtime_error("Find text failed: " + response.error);
     }
 
-    return parse_text_search_result(json::parse(response.body));
+    // The totals follow the matches, so they are only known for a full response
+    if (streamer.complete())
+        parse_text_search_totals(streamer.rest(), result);
+    else
+        result.truncated = true;
+    return result;
 }
 
 std::vector<FileMatch> Client::find_files(const FileSearchOptions& options)
@@ -1871,7 +5410,7 @@ std::vector<FileMatch> Client::find_files(const FileSearchOptions& options)
         throw std::runtime_error("Find files failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<FileMatch> matches;
     if (j.is_array())
     {
@@ -1894,7 +5433,7 @@ std::vector<SymbolMatch> Client::find_symbols(const SymbolSearchOptions& options
         throw std::runtime_error("Find symbols failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<SymbolMatch> matches;
     if (j.is_array())
     {
@@ -1910,56 +5449,65 @@ std::vector<SymbolMatch> Client::find_symbols(const SymbolSearchOptions& options
 
 std::vector<ProviderDetails> Client::list_providers()
 {
-    auto response = impl_->request("GET", "/app/providers");
-    if (response.status != 200)
+    return impl_->cached<std::vector<ProviderDetails>>(Metadata::Providers, [&]
     {
-        throw std::runtime_error("List providers failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/app/providers");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("List providers failed: " + response.error);
+        }
 
-    auto j = json::parse(response.body);
-    std::vector<ProviderDetails> providers;
-    if (j.is_array())
-    {
-        for (const auto& item : j)
-            providers.push_back(parse_provider_details(item));
-    }
-    return providers;
+        auto j = impl_->parse(response);
+        std::vector<ProviderDetails> providers;
+        if (j.is_array())
+        {
+            for (const auto& item : j)
+                providers.push_back(parse_provider_details(item));
+        }
+        return providers;
+    });
 }
 
 std::vector<ModeInfo> Client::list_modes()
 {
-    auto response = impl_->request("GET", "/app/modes");
-    if (response.status != 200)
+    return impl_->cached<std::vector<ModeInfo>>(Metadata::Modes, [&]
     {
-        throw std::runtime_error("List modes failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/app/modes");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("List modes failed: " + response.error);
+        }
 
-    auto j = json::parse(response.body);
-    std::vector<ModeInfo> modes;
-    if (j.is_array())
-    {
-        for (const auto& item : j)
-            modes.push_back(parse_mode_info(item));
-    }
-    return modes;
+        auto j = impl_->parse(response);
+        std::vector<ModeInfo> modes;
+        if (j.is_array())
+        {
+            for (const auto& item : j)
+                modes.push_back(parse_mode_info(item));
+        }
+        return modes;
+    });
 }
 
 std::vector<AgentInfo> Client::list_agents()
 {
-    auto response = impl_->request("GET", "/app/agents");
-    if (response.status != 200)
+    return impl_->cached<std::vector<AgentInfo>>(Metadata::Agents, [&]
     {
-        throw std::runtime_error("List agents failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/app/agents");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("List agents failed: " + response.error);
+        }
 
-    auto j = json::parse(response.body);
-    std::vector<AgentInfo> agents;
-    if (j.is_array())
-    {
-        for (const auto& item : j)
-            agents.push_back(parse_agent_info(item));
-    }
-    return agents;
+        auto j = impl_->parse(response);
+        std::vector<AgentInfo> agents;
+        if (j.is_array())
+        {
+            for (const auto& item : j)
+                agents.push_back(parse_agent_info(item));
+        }
+        return agents;
+    });
 }
 
 std::vector<SkillInfo> Client::list_skills()
@@ -1970,7 +5518,7 @@ std::vector<SkillInfo> Client::list_skills()
         throw std::runtime_error("List skills failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<SkillInfo> skills;
     if (j.is_array())
     {
@@ -1996,13 +5544,16 @@ void Client::log(LogLevel level, const std::string& message)
 
 Config Client::get_config()
 {
-    auto response = impl_->request("GET", "/config");
-    if (response.status != 200)
+    return impl_->cached<Config>(Metadata::Config, [&]
     {
-        throw std::runtime_error("Get config failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/config");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("Get config failed: " + response.error);
+        }
 
-    return parse_config(json::parse(response.body));
+        return parse_config(impl_->parse(response));
+    });
 }
 
 Config Client::update_config(const ConfigUpdate& updates)
@@ -2025,7 +5576,10 @@ Config Client::update_config(const ConfigUpdate& updates)
         throw std::runtime_error("Update config failed: " + response.error);
     }
 
-    return parse_config(json::parse(response.body));
+    auto config = parse_config(impl_->parse(response));
+    if (impl_->metadata)
+        impl_->metadata->put(Metadata::Config, config);
+    return config;
 }
 
 std::vector<ConfigProvider> Client::list_config_providers()
@@ -2036,7 +5590,7 @@ std::vector<ConfigProvider> Client::list_config_providers()
         throw std::runtime_error("List config providers failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<ConfigProvider> providers;
     if (j.is_array())
     {
@@ -2052,13 +5606,16 @@ std::vector<ConfigProvider> Client::list_config_providers()
 
 McpStatus Client::mcp_status()
 {
-    auto response = impl_->request("GET", "/mcp/status");
-    if (response.status != 200)
+    return impl_->coalesced<McpStatus>("GET /mcp/status", [&]
     {
-        throw std::runtime_error("MCP status failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/mcp/status");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("MCP status failed: " + response.error);
+        }
 
-    return parse_mcp_status(json::parse(response.body));
+        return parse_mcp_status(impl_->parse(response));
+    });
 }
 
 McpServer Client::mcp_add(const McpServerConfig& config)
@@ -2077,7 +5634,7 @@ McpServer Client::mcp_add(const McpServerConfig& config)
         throw std::runtime_error("MCP add failed: " + response.error);
     }
 
-    return parse_mcp_server(json::parse(response.body));
+    return parse_mcp_server(impl_->parse(response));
 }
 
 McpServer Client::mcp_connect(const std::string& server_id)
@@ -2088,7 +5645,7 @@ McpServer Client::mcp_connect(const std::string& server_id)
         throw std::runtime_error("MCP connect failed: " + response.error);
     }
 
-    return parse_mcp_server(json::parse(response.body));
+    return parse_mcp_server(impl_->parse(response));
 }
 
 McpServer Client::mcp_disconnect(const std::string& server_id)
@@ -2099,7 +5656,7 @@ McpServer Client::mcp_disconnect(const std::string& server_id)
         throw std::runtime_error("MCP disconnect failed: " + response.error);
     }
 
-    return parse_mcp_server(json::parse(response.body));
+    return parse_mcp_server(impl_->parse(response));
 }
 
 // =============================================================================
@@ -2114,7 +5671,7 @@ std::vector<Question> Client::list_questions()
         throw std::runtime_error("List questions failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<Question> questions;
     if (j.is_array())
     {
@@ -2151,7 +5708,7 @@ std::vector<Worktree> Client::list_worktrees()
         throw std::runtime_error("List worktrees failed: " + response.error);
     }
 
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     std::vector<Worktree> worktrees;
     if (j.is_array())
     {
@@ -2177,7 +5734,7 @@ Worktree Client::create_worktree(const WorktreeCreate& options)
         throw std::runtime_error("Create worktree failed: " + response.error);
     }
 
-    return parse_worktree(json::parse(response.body));
+    return parse_worktree(impl_->parse(response));
 }
 
 bool Client::remove_worktree(const std::string& worktree_id)
@@ -2194,7 +5751,7 @@ Worktree Client::reset_worktree(const std::string& worktree_id)
         throw std::runtime_error("Reset worktree failed: " + response.error);
     }
 
-    return parse_worktree(json::parse(response.body));
+    return parse_worktree(impl_->parse(response));
 }
 
 // =============================================================================
@@ -2203,38 +5760,44 @@ Worktree Client::reset_worktree(const std::string& worktree_id)
 
 std::vector<std::string> Client::list_tool_ids()
 {
-    auto response = impl_->request("GET", "/tool/ids");
-    if (response.status != 200)
+    return impl_->cached<std::vector<std::string>>(Metadata::ToolIds, [&]
     {
-        throw std::runtime_error("List tool IDs failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/tool/ids");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("List tool IDs failed: " + response.error);
+        }
 
-    auto j = json::parse(response.body);
-    std::vector<std::string> ids;
-    if (j.is_array())
-    {
-        for (const auto& item : j)
-            ids.push_back(item.get<std::string>());
-    }
-    return ids;
+        auto j = impl_->parse(response);
+        std::vector<std::string> ids;
+        if (j.is_array())
+        {
+            for (const auto& item : j)
+                ids.push_back(item.get<std::string>());
+        }
+        return ids;
+    });
 }
 
 std::vector<ToolInfo> Client::list_tools()
 {
-    auto response = impl_->request("GET", "/tool");
-    if (response.status != 200)
+    return impl_->cached<std::vector<ToolInfo>>(Metadata::Tools, [&]
     {
-        throw std::runtime_error("List tools failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/tool");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("List tools failed: " + response.error);
+        }
 
-    auto j = json::parse(response.body);
-    std::vector<ToolInfo> tools;
-    if (j.is_array())
-    {
-        for (const auto& item : j)
-            tools.push_back(parse_tool_info(item));
-    }
-    return tools;
+        auto j = impl_->parse(response);
+        std::vector<ToolInfo> tools;
+        if (j.is_array())
+        {
+            for (const auto& item : j)
+                tools.push_back(parse_tool_info(item));
+        }
+        return tools;
+    });
 }
 
 // =============================================================================
@@ -2243,13 +5806,16 @@ std::vector<ToolInfo> Client::list_tools()
 
 LspStatus Client::lsp_status()
 {
-    auto response = impl_->request("GET", "/lsp/status");
-    if (response.status != 200)
+    return impl_->coalesced<LspStatus>("GET /lsp/status", [&]
     {
-        throw std::runtime_error("LSP status failed: " + response.error);
-    }
+        auto response = impl_->request("GET", "/lsp/status");
+        if (response.status != 200)
+        {
+            throw std::runtime_error("LSP status failed: " + response.error);
+        }
 
-    return parse_lsp_status(json::parse(response.body));
+        return parse_lsp_status(impl_->parse(response));
+    });
 }
 
 // =============================================================================
@@ -2264,7 +5830,7 @@ FormatterStatus Client::formatter_status()
         throw std::runtime_error("Formatter status failed: " + response.error);
     }
 
-    return parse_formatter_status(json::parse(response.body));
+    return parse_formatter_status(impl_->parse(response));
 }
 
 // =============================================================================
@@ -2287,7 +5853,7 @@ AuthResult Client::set_auth(const std::string& provider_id, const AuthCredential
 
     try
     {
-        auto j = json::parse(response.body);
+        auto j = impl_->parse(response);
         return parse_auth_result(j);
     }
     catch (...)
@@ -2305,7 +5871,7 @@ AuthResult Client::remove_auth(const std::string& provider_id)
 
     try
     {
-        auto j = json::parse(response.body);
+        auto j = impl_->parse(response);
         return parse_auth_result(j);
     }
     catch (...)
@@ -2345,7 +5911,7 @@ Part Client::update_part(
         throw std::runtime_error("Update part failed: " + response.error);
     }
 
-    return parse_part(json::parse(response.body));
+    return parse_part(impl_->parse(response));
 }
 
 
@@ -2406,7 +5972,7 @@ TuiStatus Client::tui_status()
     auto response = impl_->request("GET", "/tui/status");
     if (response.status != 200)
         throw std::runtime_error("TUI status failed: " + response.error);
-    return parse_tui_status(json::parse(response.body));
+    return parse_tui_status(impl_->parse(response));
 }
 
 void Client::tui_scroll(int lines)
@@ -2439,7 +6005,7 @@ std::string Client::tui_paste()
     auto response = impl_->request("POST", "/tui/paste");
     if (response.status != 200)
         throw std::runtime_error("TUI paste failed: " + response.error);
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     return j.value("text", "");
 }
 
@@ -2455,7 +6021,7 @@ TuiRender Client::tui_render()
     auto response = impl_->request("GET", "/tui/render");
     if (response.status != 200)
         throw std::runtime_error("TUI render failed: " + response.error);
-    return parse_tui_render(json::parse(response.body));
+    return parse_tui_render(impl_->parse(response));
 }
 
 // =============================================================================
@@ -2469,7 +6035,7 @@ std::vector<PtySession> Client::list_pty_sessions()
         throw std::runtime_error("List PTY sessions failed: " + response.error);
 
     std::vector<PtySession> sessions;
-    auto j = json::parse(response.body);
+    auto j = impl_->parse(response);
     if (j.is_array())
     {
         for (const auto& item : j)
@@ -2500,7 +6066,7 @@ PtySession Client::create_pty(const PtyCreate& options)
     auto response = impl_->request("POST", "/pty", body.dump());
     if (response.status != 200 && response.status != 201)
         throw std::runtime_error("Create PTY failed: " + response.error);
-    return parse_pty_session(json::parse(response.body));
+    return parse_pty_session(impl_->parse(response));
 }
 
 void Client::pty_write(const std::string& pty_id, const std::string& data)
@@ -2520,7 +6086,15 @@ PtySession Client::pty_resize(const std::string& pty_id, int cols, int rows)
     auto response = impl_->request("POST", "/pty/" + pty_id + "/resize", body.dump());
     if (response.status != 200)
         throw std::runtime_error("PTY resize failed: " + response.error);
-    return parse_pty_session(json::parse(response.body));
+    return parse_pty_session(impl_->parse(response));
+}
+
+PtyChannel Client::open_pty_channel(const std::string& pty_id, PtyChannelOptions options)
+{
+    std::unique_ptr<Transport> output;
+    if (options.on_output)
+        output = impl_->make_sse_transport();
+    return PtyChannel(this, pty_id, std::move(output), std::move(options));
 }
 
 bool Client::close_pty(const std::string& pty_id)
@@ -0,0 +1,323 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <opencode/cluster_client.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace opencode
+{
+
+// =============================================================================
+// ClusterClient Implementation
+// =============================================================================
+
+class ClusterClient::Impl
+{
+  public:
+    // Servers are declared first so the clients on them go away before they stop
+    std::vector<std::unique_ptr<Server>> servers;
+    std::vector<std::unique_ptr<Client>> members;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, size_t> owners; // Session ID -> member index
+    std::vector<size_t> sessions;                     // Owned sessions per member
+
+    explicit Impl(ClusterOptions opts)
+    {
+        // Spawn in parallel; each start waits for the server's banner
+        std::vector<std::future<Server>> spawning;
+        for (size_t i = 0; i < opts.spawn; ++i)
+        {
+            spawning.push_back(std::async(std::launch::async, [server = opts.server]() mutable
+            {
+                server.port = 0; // OS assigns port
+                return Server::spawn(server);
+            }));
+        }
+
+        std::string error;
+        for (auto& started : spawning)
+        {
+            try
+            {
+                servers.push_back(std::make_unique<Server>(started.get()));
+            }
+            catch (const std::exception& e)
+            {
+                if (error.empty())
+                    error = e.what();
+            }
+        }
+        if (!error.empty())
+            throw std::runtime_error("Cluster server failed to start: " + error);
+
+        auto urls = std::move(opts.urls);
+        for (const auto& server : servers)
+            urls.push_back(server->url());
+        if (urls.empty())
+            throw std::runtime_error("Cluster needs at least one server URL or spawned server");
+
+        // Two members on one server would split its sessions and double its load
+        std::unordered_set<std::string> distinct;
+        for (const auto& url : urls)
+        {
+            auto key = url;
+            while (!key.empty() && key.back() == '/')
+                key.pop_back();
+            if (!distinct.insert(key).second)
+                throw std::runtime_error("Cluster server URL given more than once: " + url);
+        }
+
+        for (const auto& url : urls)
+        {
+            auto client = opts.client;
+            client.base_url = url;
+            members.push_back(std::make_unique<Client>(std::move(client)));
+        }
+        sessions.assign(members.size(), 0);
+    }
+
+    /// Pick the member for a new session and count the session against it
+    size_t reserve()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t best = 0;
+        size_t best_generations = members[0]->generations_in_flight();
+        for (size_t i = 1; i < members.size(); ++i)
+        {
+            size_t generations = members[i]->generations_in_flight();
+            if (generations < best_generations ||
+                (generations == best_generations && sessions[i] < sessions[best]))
+            {
+                best = i;
+                best_generations = generations;
+            }
+        }
+        ++sessions[best];
+        return best;
+    }
+
+    void release(size_t member)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --sessions[member];
+    }
+
+    /// Record that member owns a session
+    void own(const std::string& session_id, size_t member)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, inserted] = owners.emplace(session_id, member);
+        if (inserted)
+            ++sessions[member];
+    }
+
+    void disown(const std::string& session_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = owners.find(session_id);
+        if (it == owners.end())
+            return;
+        --sessions[it->second];
+        owners.erase(it);
+    }
+
+    /// Index of the member owning a session, asking each server if it is unknown
+    size_t owner(const std::string& session_id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (auto it = owners.find(session_id); it != owners.end())
+                return it->second;
+        }
+
+        for (size_t i = 0; i < members.size(); ++i)
+        {
+            try
+            {
+                members[i]->get_session(session_id);
+            }
+            catch (const std::exception&)
+            {
+                continue; // Not found there, or the server did not answer
+            }
+            own(session_id, i);
+            return i;
+        }
+        throw std::runtime_error("Session not found on any cluster server: " + session_id);
+    }
+};
+
+// =============================================================================
+// ClusterClient Public Interface
+// =============================================================================
+
+ClusterClient::ClusterClient(ClusterOptions opts)
+    : impl_(std::make_unique<Impl>(std::move(opts)))
+{
+}
+
+ClusterClient::~ClusterClient() = default;
+
+ClusterClient::ClusterClient(ClusterClient&&) noexcept = default;
+ClusterClient& ClusterClient::operator=(ClusterClient&&) noexcept = default;
+
+size_t ClusterClient::size() const
+{
+    return impl_->members.size();
+}
+
+Client& ClusterClient::member(size_t i)
+{
+    if (i >= impl_->members.size())
+        throw std::runtime_error("Cluster member index out of range");
+    return *impl_->members[i];
+}
+
+Client& ClusterClient::client_for(const std::string& session_id)
+{
+    return *impl_->members[impl_->owner(session_id)];
+}
+
+std::vector<ClusterMemberStats> ClusterClient::stats() const
+{
+    std::vector<ClusterMemberStats> stats;
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    for (size_t i = 0; i < impl_->members.size(); ++i)
+    {
+        const auto& member = *impl_->members[i];
+        stats.push_back({member.server_url(), impl_->sessions[i], member.generations_in_flight()});
+    }
+    return stats;
+}
+
+Session ClusterClient::create_session(const std::string& title)
+{
+    size_t i = impl_->reserve();
+    try
+    {
+        auto session = impl_->members[i]->create_session(title);
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        // The reservation already counted the session
+        if (!impl_->owners.emplace(session.id(), i).second)
+            --impl_->sessions[i];
+        return session;
+    }
+    catch (...)
+    {
+        impl_->release(i);
+        throw;
+    }
+}
+
+Session ClusterClient::get_session(const std::string& session_id)
+{
+    return client_for(session_id).get_session(session_id);
+}
+
+std::vector<SessionInfo> ClusterClient::list_sessions()
+{
+    std::vector<std::future<std::vector<SessionInfo>>> listings;
+    for (const auto& member : impl_->members)
+        listings.push_back(member->list_sessions_async());
+
+    std::vector<std::pair<size_t, SessionInfo>> listed; // Member, session
+    for (size_t i = 0; i < listings.size(); ++i)
+    {
+        auto listing = listings[i].get();
+        for (auto& info : listing)
+        {
+            impl_->own(info.id, i);
+            listed.emplace_back(i, std::move(info));
+        }
+    }
+
+    // Servers sharing a storage directory list the same sessions; keep the
+    // owner's copy, or the first one if the owner no longer lists it
+    std::vector<bool> from_owner(listed.size());
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        for (size_t i = 0; i < listed.size(); ++i)
+        {
+            auto it = impl_->owners.find(listed[i].second.id);
+            from_owner[i] = it != impl_->owners.end() && it->second == listed[i].first;
+        }
+    }
+    std::vector<SessionInfo> sessions;
+    std::unordered_set<std::string> seen;
+    for (bool owners_pass : {true, false})
+    {
+        for (size_t i = 0; i < listed.size(); ++i)
+        {
+            if (from_owner[i] == owners_pass && !seen.contains(listed[i].second.id))
+            {
+                seen.insert(listed[i].second.id);
+                sessions.push_back(std::move(listed[i].second)); // Not looked at again
+            }
+        }
+    }
+
+    // Most recently updated first, as each server lists them
+    std::stable_sort(sessions.begin(), sessions.end(), [](const SessionInfo& a, const SessionInfo& b)
+    {
+        return a.time.updated > b.time.updated;
+    });
+    return sessions;
+}
+
+bool ClusterClient::delete_session(const std::string& session_id)
+{
+    bool deleted = client_for(session_id).delete_session(session_id);
+    if (deleted)
+        impl_->disown(session_id);
+    return deleted;
+}
+
+bool ClusterClient::abort_session(const std::string& session_id)
+{
+    return client_for(session_id).abort_session(session_id);
+}
+
+MessageWithParts ClusterClient::send_message(
+    const std::string& session_id,
+    const std::string& prompt,
+    const std::string& provider_id,
+    const std::string& model_id,
+    const CallOptions& call)
+{
+    return client_for(session_id).send_message(session_id, prompt, provider_id, model_id, call);
+}
+
+std::future<MessageWithParts> ClusterClient::send_message_async(
+    const std::string& session_id,
+    const std::string& prompt,
+    const std::string& provider_id,
+    const std::string& model_id,
+    const CallOptions& call)
+{
+    return client_for(session_id).send_message_async(session_id, prompt, provider_id, model_id, call);
+}
+
+std::vector<MessageWithParts> ClusterClient::get_messages(
+    const std::string& session_id,
+    std::optional<int> limit,
+    const CallOptions& call)
+{
+    return client_for(session_id).get_messages(session_id, limit, call);
+}
+
+EventStream ClusterClient::subscribe_events(const EventFilter& filter, const EventStreamOptions& options)
+{
+    std::vector<Client*> clients;
+    for (const auto& member : impl_->members)
+        clients.push_back(member.get());
+    return Client::subscribe_events(clients, filter, options);
+}
+
+} // namespace opencode
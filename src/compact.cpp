@@ -0,0 +1,307 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <opencode/compact.hpp>
+
+#include <algorithm>
+#include <memory_resource>
+#include <unordered_set>
+
+namespace opencode
+{
+
+namespace
+{
+
+/// Heap resource that keeps count of the bytes it hands out
+class CountingResource : public std::pmr::memory_resource
+{
+  public:
+    size_t bytes() const
+    {
+        return bytes_;
+    }
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        bytes_ += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        bytes_ -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    size_t bytes_ = 0;
+};
+
+std::optional<std::string> owned(const std::optional<std::string_view>& text)
+{
+    return text ? std::optional<std::string>(*text) : std::nullopt;
+}
+
+} // namespace
+
+// =============================================================================
+// CompactHistory Implementation
+// =============================================================================
+
+struct CompactHistory::Impl
+{
+    explicit Impl(size_t initial)
+        : initial_bytes(std::max<size_t>(initial, 1024)), arena(initial_bytes, &upstream), strings(&arena)
+    {
+    }
+
+    size_t initial_bytes;
+
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::unordered_set<std::string_view> strings; // Interned, pointing into arena
+    std::vector<CompactMessage> messages;
+};
+
+CompactHistory::CompactHistory(size_t initial_bytes)
+    : impl_(std::make_unique<Impl>(initial_bytes))
+{
+}
+
+CompactHistory::~CompactHistory() = default;
+
+CompactHistory::CompactHistory(CompactHistory&&) noexcept = default;
+CompactHistory& CompactHistory::operator=(CompactHistory&&) noexcept = default;
+
+void* CompactHistory::allocate_bytes(size_t bytes, size_t alignment)
+{
+    return impl_->arena.allocate(bytes, alignment);
+}
+
+std::string_view CompactHistory::copy(std::string_view text)
+{
+    if (text.empty())
+        return {};
+    auto* data = static_cast<char*>(impl_->arena.allocate(text.size(), 1));
+    std::char_traits<char>::copy(data, text.data(), text.size());
+    return {data, text.size()};
+}
+
+std::string_view CompactHistory::intern(std::string_view text)
+{
+    if (text.empty())
+        return {};
+    if (auto it = impl_->strings.find(text); it != impl_->strings.end())
+        return *it;
+    return *impl_->strings.insert(copy(text)).first;
+}
+
+const CompactMessage& CompactHistory::push(const CompactMessage& message)
+{
+    return impl_->messages.emplace_back(message);
+}
+
+const CompactMessage& CompactHistory::add(const MessageWithParts& message)
+{
+    CompactMessage compact;
+    if (auto* user = std::get_if<UserMessage>(&message.info))
+    {
+        compact.id = intern(user->id);
+        compact.session_id = intern(user->session_id);
+        compact.time = user->time;
+        compact.agent = intern(user->agent);
+        compact.model_id = intern(user->model.model_id);
+        compact.provider_id = intern(user->model.provider_id);
+        if (user->system)
+            compact.system = copy(*user->system);
+        if (user->variant)
+            compact.variant = intern(*user->variant);
+    }
+    else
+    {
+        const auto& assistant = std::get<AssistantMessage>(message.info);
+        compact.assistant = true;
+        compact.id = intern(assistant.id);
+        compact.session_id = intern(assistant.session_id);
+        compact.time = assistant.time;
+        compact.agent = intern(assistant.agent);
+        compact.model_id = intern(assistant.model_id);
+        compact.provider_id = intern(assistant.provider_id);
+        compact.parent_id = intern(assistant.parent_id);
+        compact.mode = intern(assistant.mode);
+        compact.cwd = intern(assistant.path.cwd);
+        compact.root = intern(assistant.path.root);
+        compact.cost = assistant.cost;
+        compact.tokens = assistant.tokens;
+        if (assistant.finish)
+            compact.finish = intern(*assistant.finish);
+        compact.summary = assistant.summary;
+    }
+
+    auto parts = allocate<CompactPart>(message.parts.size());
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        const auto& part = message.parts[i];
+        auto& out = parts[i];
+        out.kind = part_kind(part);
+        std::visit([&](const auto& p) { out.id = copy(p.id); }, part);
+
+        if (auto* text = std::get_if<TextPart>(&part))
+        {
+            out.text = copy(text->text);
+        }
+        else if (auto* file = std::get_if<FilePart>(&part))
+        {
+            out.text = copy(file->file);
+            if (file->content)
+                out.content = copy(*file->content);
+        }
+        else if (auto* tool = std::get_if<ToolPart>(&part))
+        {
+            out.text = intern(tool->tool);
+            auto input = allocate<CompactToolInput>(tool->input.size());
+            size_t n = 0;
+            for (const auto& [key, value] : tool->input)
+                input[n++] = {intern(key), copy(value)};
+            out.input = input;
+            if (tool->state)
+            {
+                out.status = intern(tool->state->status);
+                if (tool->state->error)
+                    out.error = copy(*tool->state->error);
+            }
+        }
+        else if (auto* reasoning = std::get_if<ReasoningPart>(&part))
+        {
+            out.text = copy(reasoning->text);
+        }
+    }
+    compact.parts = parts;
+    return push(compact);
+}
+
+std::span<const CompactMessage> CompactHistory::messages() const
+{
+    return impl_->messages;
+}
+
+size_t CompactHistory::size() const
+{
+    return impl_->messages.size();
+}
+
+bool CompactHistory::empty() const
+{
+    return impl_->messages.empty();
+}
+
+size_t CompactHistory::bytes() const
+{
+    return impl_->upstream.bytes();
+}
+
+size_t CompactHistory::interned() const
+{
+    return impl_->strings.size();
+}
+
+void CompactHistory::clear()
+{
+    // The arena only releases its memory as a whole
+    impl_ = std::make_unique<Impl>(impl_->initial_bytes);
+}
+
+// =============================================================================
+// Expansion
+// =============================================================================
+
+MessageWithParts expand(const CompactMessage& message)
+{
+    MessageWithParts result;
+    if (message.assistant)
+    {
+        AssistantMessage assistant;
+        assistant.id = message.id;
+        assistant.session_id = message.session_id;
+        assistant.time = message.time;
+        assistant.parent_id = message.parent_id;
+        assistant.model_id = message.model_id;
+        assistant.provider_id = message.provider_id;
+        assistant.mode = message.mode;
+        assistant.agent = message.agent;
+        assistant.path.cwd = message.cwd;
+        assistant.path.root = message.root;
+        assistant.cost = message.cost;
+        assistant.tokens = message.tokens;
+        assistant.finish = owned(message.finish);
+        assistant.summary = message.summary;
+        result.info = std::move(assistant);
+    }
+    else
+    {
+        UserMessage user;
+        user.id = message.id;
+        user.session_id = message.session_id;
+        user.time = message.time;
+        user.agent = message.agent;
+        user.model.model_id = message.model_id;
+        user.model.provider_id = message.provider_id;
+        user.system = owned(message.system);
+        user.variant = owned(message.variant);
+        result.info = std::move(user);
+    }
+
+    result.parts.reserve(message.parts.size());
+    for (const auto& part : message.parts)
+    {
+        switch (part.kind)
+        {
+        case PartKind::Text:
+        {
+            TextPart text;
+            text.id = part.id;
+            text.text = part.text;
+            result.parts.push_back(std::move(text));
+            break;
+        }
+        case PartKind::File:
+        {
+            FilePart file;
+            file.id = part.id;
+            file.file = part.text;
+            file.content = owned(part.content);
+            result.parts.push_back(std::move(file));
+            break;
+        }
+        case PartKind::Tool:
+        {
+            ToolPart tool;
+            tool.id = part.id;
+            tool.tool = part.text;
+            for (const auto& input : part.input)
+                tool.input.emplace(input.key, input.value);
+            if (part.status)
+                tool.state = ToolState{std::string(*part.status), owned(part.error)};
+            result.parts.push_back(std::move(tool));
+            break;
+        }
+        case PartKind::Reasoning:
+        {
+            ReasoningPart reasoning;
+            reasoning.id = part.id;
+            reasoning.text = part.text;
+            result.parts.push_back(std::move(reasoning));
+            break;
+        }
+        }
+    }
+    return result;
+}
+
+} // namespace opencode
@@ -3,6 +3,9 @@
 
 #include <opencode/events.hpp>
 
+#include <algorithm>
+#include <numeric>
+
 namespace opencode
 {
 
@@ -17,4 +20,87 @@ std::string get_event_type(const Event& event)
         event);
 }
 
+// =============================================================================
+// TuiScreen
+// =============================================================================
+
+void TuiScreen::reset(TuiRender render)
+{
+    render_ = std::move(render);
+    changed_.resize(render_.lines.size());
+    std::iota(changed_.begin(), changed_.end(), 0);
+    full_redraw_ = true;
+}
+
+bool TuiScreen::update(TuiRender render)
+{
+    changed_.clear();
+    full_redraw_ = false;
+    if (render_.seq && render.seq && *render.seq <= *render_.seq)
+        return false; // Not newer than the screen shown
+
+    // Rows past the new end are gone, and a new size can reflow every row
+    full_redraw_ = render.size.width != render_.size.width || render.size.height != render_.size.height ||
+                   render.lines.size() < render_.lines.size();
+    for (size_t row = 0; row < render.lines.size(); ++row)
+    {
+        if (row >= render_.lines.size() || render.lines[row] != render_.lines[row])
+            changed_.push_back(static_cast<int>(row));
+    }
+    render_ = std::move(render);
+    return full_redraw_ || !changed_.empty();
+}
+
+bool TuiScreen::apply(const TuiRenderDiffEvent& diff)
+{
+    changed_.clear();
+    full_redraw_ = false;
+    if (render_.seq)
+    {
+        if (diff.seq <= *render_.seq)
+            return true; // Already part of the snapshot
+        if (diff.seq != *render_.seq + 1)
+            return false;
+    }
+    render_.seq = diff.seq;
+
+    const size_t rows = render_.lines.size();
+    if (diff.size.width > 0 && diff.size.width != render_.size.width)
+    {
+        render_.size.width = diff.size.width;
+        full_redraw_ = true;
+    }
+    if (diff.size.height > 0 && diff.size.height != render_.size.height)
+    {
+        full_redraw_ = true;
+        render_.size.height = diff.size.height;
+        render_.lines.resize(static_cast<size_t>(diff.size.height));
+    }
+
+    for (const auto& change : diff.lines)
+    {
+        if (change.row < 0)
+            continue;
+        auto row = static_cast<size_t>(change.row);
+        if (row >= render_.lines.size())
+        {
+            if (render_.size.height > 0)
+                continue; // Outside the screen
+            render_.lines.resize(row + 1);
+        }
+        render_.lines[row] = change.text;
+        if (row < rows)
+            changed_.push_back(change.row);
+    }
+
+    // Rows a resize (or a row past an unknown height) added are new on screen
+    if (render_.lines.size() < rows)
+        full_redraw_ = true;
+    for (size_t row = rows; row < render_.lines.size(); ++row)
+        changed_.push_back(static_cast<int>(row));
+    std::sort(changed_.begin(), changed_.end());
+    changed_.erase(std::unique(changed_.begin(), changed_.end()), changed_.end());
+    return true;
+}
+
 } // namespace opencode
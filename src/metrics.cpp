@@ -0,0 +1,392 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <opencode/metrics.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace opencode
+{
+
+namespace
+{
+
+/// Histogram upper bounds in seconds, shared by every histogram
+constexpr std::array<double, 14> kBuckets = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+
+double seconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+struct Histogram
+{
+    std::array<uint64_t, kBuckets.size()> counts{}; // Not cumulative
+    uint64_t count = 0;
+    double sum = 0;
+
+    void observe(double value)
+    {
+        auto bucket = std::lower_bound(kBuckets.begin(), kBuckets.end(), value);
+        if (bucket != kBuckets.end())
+            ++counts[static_cast<size_t>(bucket - kBuckets.begin())];
+        ++count;
+        sum += value;
+    }
+};
+
+struct EndpointStats
+{
+    Histogram duration;
+    Histogram time_to_first_byte;
+    std::map<int, uint64_t> statuses; // 0 = no response
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    uint64_t reused = 0;
+    uint64_t revalidated = 0;
+    double connection_wait = 0;
+};
+
+struct StreamStats
+{
+    uint64_t events = 0;
+    uint64_t bytes = 0;
+    uint64_t connects = 0;
+    uint64_t reconnects = 0;
+};
+
+struct ParseStats
+{
+    Histogram duration;
+    uint64_t bytes = 0;
+};
+
+/// Escape a label value (backslash, double quote and newline)
+std::string escape(std::string_view value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+/// Shortest text that reads back as the same double
+std::string format_number(double value)
+{
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, end);
+}
+
+void header(std::string& out, const char* name, const char* type, const char* help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+template <typename Value>
+void sample(std::string& out, std::string_view name, const std::string& labels, Value value)
+{
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    if constexpr (std::is_floating_point_v<Value>)
+        out += format_number(value);
+    else
+        out += std::to_string(value);
+    out += '\n';
+}
+
+void histogram(std::string& out, std::string_view name, const std::string& labels, const Histogram& h)
+{
+    std::string bucket_name = std::string(name) + "_bucket";
+    std::string prefix = labels.empty() ? std::string() : labels + ",";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kBuckets.size(); ++i)
+    {
+        cumulative += h.counts[i];
+        sample(out, bucket_name, prefix + "le=\"" + format_number(kBuckets[i]) + "\"", cumulative);
+    }
+    sample(out, bucket_name, prefix + "le=\"+Inf\"", h.count);
+    sample(out, std::string(name) + "_sum", labels, h.sum);
+    sample(out, std::string(name) + "_count", labels, h.count);
+}
+
+} // namespace
+
+// =============================================================================
+// MetricsRegistry Implementation
+// =============================================================================
+
+class MetricsRegistry::Impl
+{
+  public:
+    using EndpointKey = std::pair<std::string, std::string>; // Method, endpoint
+
+    mutable std::mutex mutex;
+    std::map<EndpointKey, EndpointStats, std::less<>> endpoints;
+    std::map<std::string, StreamStats, std::less<>> streams;
+    std::map<std::string, ParseStats, std::less<>> parses;
+    // Updated once per queued event on the stream thread, so kept outside the mutex
+    std::atomic<size_t> queue_depth{0};
+    std::atomic<size_t> queue_depth_max{0};
+    std::atomic<uint64_t> queued{0};
+
+    /// Find or create the entry for key without copying it when it exists
+    template <typename Map>
+    static typename Map::mapped_type& entry(Map& map, std::string_view key)
+    {
+        auto it = map.find(key);
+        if (it == map.end())
+            it = map.emplace(std::string(key), typename Map::mapped_type{}).first;
+        return it->second;
+    }
+
+    static std::string endpoint_labels(const EndpointKey& key)
+    {
+        return "method=\"" + escape(key.first) + "\",endpoint=\"" + escape(key.second) + "\"";
+    }
+
+    std::string render() const
+    {
+        std::string out;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        header(out, "opencode_http_request_duration_seconds", "histogram", "Duration of HTTP requests.");
+        for (const auto& [key, stats] : endpoints)
+            histogram(out, "opencode_http_request_duration_seconds", endpoint_labels(key), stats.duration);
+
+        header(out, "opencode_http_time_to_first_byte_seconds", "histogram",
+               "Time until response headers arrived, including connection setup.");
+        for (const auto& [key, stats] : endpoints)
+            histogram(out, "opencode_http_time_to_first_byte_seconds", endpoint_labels(key), stats.time_to_first_byte);
+
+        header(out, "opencode_http_requests_total", "counter", "HTTP requests by status (0 = no response).");
+        for (const auto& [key, stats] : endpoints)
+            for (const auto& [status, count] : stats.statuses)
+                sample(out, "opencode_http_requests_total",
+                       endpoint_labels(key) + ",status=\"" + std::to_string(status) + "\"", count);
+
+        header(out, "opencode_http_sent_bytes_total", "counter", "Request body bytes sent.");
+        for (const auto& [key, stats] : endpoints)
+            sample(out, "opencode_http_sent_bytes_total", endpoint_labels(key), stats.bytes_sent);
+
+        header(out, "opencode_http_received_bytes_total", "counter", "Response body bytes received.");
+        for (const auto& [key, stats] : endpoints)
+            sample(out, "opencode_http_received_bytes_total", endpoint_labels(key), stats.bytes_received);
+
+        header(out, "opencode_http_connection_wait_seconds_total", "counter",
+               "Time spent waiting for a pooled connection.");
+        for (const auto& [key, stats] : endpoints)
+            sample(out, "opencode_http_connection_wait_seconds_total", endpoint_labels(key), stats.connection_wait);
+
+        header(out, "opencode_http_reused_connections_total", "counter",
+               "Requests sent on a reused keep-alive connection.");
+        for (const auto& [key, stats] : endpoints)
+            sample(out, "opencode_http_reused_connections_total", endpoint_labels(key), stats.reused);
+
+        header(out, "opencode_http_revalidated_total", "counter", "Requests answered by a 304 from the cache.");
+        for (const auto& [key, stats] : endpoints)
+            sample(out, "opencode_http_revalidated_total", endpoint_labels(key), stats.revalidated);
+
+        header(out, "opencode_sse_events_total", "counter", "SSE events received.");
+        for (const auto& [path, stats] : streams)
+            sample(out, "opencode_sse_events_total", "path=\"" + escape(path) + "\"", stats.events);
+
+        header(out, "opencode_sse_bytes_total", "counter", "SSE event data bytes received.");
+        for (const auto& [path, stats] : streams)
+            sample(out, "opencode_sse_bytes_total", "path=\"" + escape(path) + "\"", stats.bytes);
+
+        header(out, "opencode_sse_connects_total", "counter", "SSE connections established.");
+        for (const auto& [path, stats] : streams)
+            sample(out, "opencode_sse_connects_total", "path=\"" + escape(path) + "\"", stats.connects);
+
+        header(out, "opencode_sse_reconnects_total", "counter", "SSE connections re-established after a drop.");
+        for (const auto& [path, stats] : streams)
+            sample(out, "opencode_sse_reconnects_total", "path=\"" + escape(path) + "\"", stats.reconnects);
+
+        header(out, "opencode_json_parse_seconds", "histogram", "Time spent parsing JSON documents.");
+        for (const auto& [kind, stats] : parses)
+            histogram(out, "opencode_json_parse_seconds", "kind=\"" + escape(kind) + "\"", stats.duration);
+
+        header(out, "opencode_json_parsed_bytes_total", "counter", "JSON bytes parsed.");
+        for (const auto& [kind, stats] : parses)
+            sample(out, "opencode_json_parsed_bytes_total", "kind=\"" + escape(kind) + "\"", stats.bytes);
+
+        header(out, "opencode_event_queue_depth", "gauge", "Events waiting in the last EventStream that queued one.");
+        sample(out, "opencode_event_queue_depth", {}, queue_depth.load(std::memory_order_relaxed));
+        header(out, "opencode_event_queue_depth_max", "gauge", "Deepest EventStream queue seen.");
+        sample(out, "opencode_event_queue_depth_max", {}, queue_depth_max.load(std::memory_order_relaxed));
+        header(out, "opencode_event_queued_total", "counter", "Events queued on EventStreams.");
+        sample(out, "opencode_event_queued_total", {}, queued.load(std::memory_order_relaxed));
+        return out;
+    }
+};
+
+// =============================================================================
+// MetricsRegistry Public Interface
+// =============================================================================
+
+MetricsRegistry::MetricsRegistry()
+    : impl_(std::make_unique<Impl>())
+{
+}
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+void MetricsRegistry::on_request(const RequestMetrics& metrics)
+{
+    Impl::EndpointKey key{metrics.method, endpoint(metrics.path)};
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& stats = impl_->endpoints[std::move(key)];
+    stats.duration.observe(seconds(metrics.total));
+    if (metrics.status != 0)
+        stats.time_to_first_byte.observe(seconds(metrics.time_to_first_byte));
+    ++stats.statuses[metrics.status];
+    stats.bytes_sent += metrics.bytes_sent;
+    stats.bytes_received += metrics.bytes_received;
+    stats.connection_wait += seconds(metrics.connection_wait);
+    stats.reused += metrics.reused_connection ? 1 : 0;
+    stats.revalidated += metrics.revalidated ? 1 : 0;
+}
+
+void MetricsRegistry::on_sse_connect(std::string_view path, bool reconnect)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& stats = Impl::entry(impl_->streams, path);
+    ++stats.connects;
+    stats.reconnects += reconnect ? 1 : 0;
+}
+
+void MetricsRegistry::on_sse_event(std::string_view path, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& stats = Impl::entry(impl_->streams, path);
+    ++stats.events;
+    stats.bytes += bytes;
+}
+
+void MetricsRegistry::on_parse(std::string_view kind, size_t bytes, std::chrono::nanoseconds elapsed)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& stats = Impl::entry(impl_->parses, kind);
+    stats.duration.observe(seconds(elapsed));
+    stats.bytes += bytes;
+}
+
+void MetricsRegistry::on_event_queued(size_t depth)
+{
+    impl_->queue_depth.store(depth, std::memory_order_relaxed);
+    size_t deepest = impl_->queue_depth_max.load(std::memory_order_relaxed);
+    while (depth > deepest && !impl_->queue_depth_max.compare_exchange_weak(deepest, depth, std::memory_order_relaxed))
+    {
+    }
+    impl_->queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string MetricsRegistry::prometheus_text() const
+{
+    return impl_->render();
+}
+
+void MetricsRegistry::reset()
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->endpoints.clear();
+    impl_->streams.clear();
+    impl_->parses.clear();
+    impl_->queue_depth.store(0, std::memory_order_relaxed);
+    impl_->queue_depth_max.store(0, std::memory_order_relaxed);
+    impl_->queued.store(0, std::memory_order_relaxed);
+}
+
+std::string MetricsRegistry::endpoint(std::string_view path)
+{
+    path = path.substr(0, path.find_first_of("?#"));
+
+    // Routes whose tail is a file path: "/file/src/a.cpp/status" -> "/file/{path}/status"
+    constexpr std::string_view kFile = "/file/";
+    if (path.starts_with(kFile))
+    {
+        constexpr std::string_view kStatus = "/status";
+        bool status = path.size() > kFile.size() + kStatus.size() && path.ends_with(kStatus);
+        return std::string(kFile) + "{path}" + (status ? std::string(kStatus) : std::string());
+    }
+
+    // Collections whose child segment is always a resource name, even one
+    // without digits ("/mcp/github/connect", "/auth/anthropic"), except for
+    // the fixed routes listed next to them
+    struct Collection
+    {
+        std::string_view name;
+        std::string_view fixed;
+    };
+    constexpr std::array<Collection, 9> kCollections = {{
+        {"session", ""}, {"message", ""}, {"part", ""}, {"pty", ""}, {"permission", ""},
+        {"question", ""}, {"worktree", ""}, {"auth", ""}, {"mcp", "status"},
+    }};
+
+    std::string out;
+    out.reserve(path.size());
+    std::string_view parent;
+    size_t pos = 0;
+    while (pos < path.size())
+    {
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos)
+            end = path.size();
+        auto segment = path.substr(pos, end - pos);
+        bool id = std::any_of(kCollections.begin(), kCollections.end(), [&](const Collection& collection)
+        {
+            return parent == collection.name && segment != collection.fixed;
+        });
+        id = id || std::any_of(segment.begin(), segment.end(), [](char c)
+        {
+            return (c >= '0' && c <= '9') || c == '_';
+        });
+        out += id ? std::string_view("{id}") : segment;
+        if (end < path.size())
+            out += '/';
+        parent = id ? std::string_view() : segment;
+        pos = end + 1;
+    }
+    return out;
+}
+
+} // namespace opencode
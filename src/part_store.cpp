@@ -0,0 +1,245 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <opencode/part_store.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace opencode
+{
+
+// =============================================================================
+// PartStore Implementation
+// =============================================================================
+
+namespace
+{
+
+/// Text of one part, always contiguous in the newest block
+///
+/// Growing copies the text into a block twice as large and keeps the old one,
+/// which may still back views handed out earlier.
+struct TextBuffer
+{
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+    };
+
+    std::vector<Block> blocks;
+    size_t size = 0;
+    bool reasoning = false; // Reasoning text rather than reply text
+
+    std::string_view view() const
+    {
+        return blocks.empty() ? std::string_view{} : std::string_view(blocks.back().data.get(), size);
+    }
+
+    void append(std::string_view delta, size_t initial_capacity)
+    {
+        if (delta.empty())
+            return;
+        size_t needed = size + delta.size();
+        if (blocks.empty() || needed > blocks.back().capacity)
+            new_block(needed, size, initial_capacity);
+        std::memcpy(blocks.back().data.get() + size, delta.data(), delta.size());
+        size = needed;
+    }
+
+    void assign(std::string_view text, size_t initial_capacity)
+    {
+        auto current = view();
+        if (!blocks.empty() && text.starts_with(current))
+        {
+            append(text.substr(current.size()), initial_capacity);
+            return;
+        }
+        // Bytes behind existing views must not change: start a fresh block
+        new_block(text.size(), 0, initial_capacity);
+        if (!text.empty())
+            std::memcpy(blocks.back().data.get(), text.data(), text.size());
+        size = text.size();
+    }
+
+    /// Switch to a new block of at least `needed` bytes, carrying `keep` bytes over
+    void new_block(size_t needed, size_t keep, size_t initial_capacity)
+    {
+        size_t capacity = blocks.empty() ? initial_capacity : blocks.back().capacity * 2;
+        capacity = std::max(capacity, needed);
+        Block block{std::make_unique_for_overwrite<char[]>(capacity), capacity};
+        if (keep)
+            std::memcpy(block.data.get(), blocks.back().data.get(), keep);
+        blocks.push_back(std::move(block));
+    }
+
+    /// Free every block but the one holding the current text
+    void compact()
+    {
+        if (blocks.size() > 1)
+            blocks.erase(blocks.begin(), std::prev(blocks.end()));
+    }
+
+    size_t bytes() const
+    {
+        size_t total = 0;
+        for (const auto& block : blocks)
+            total += block.capacity;
+        return total;
+    }
+};
+
+struct MessageParts
+{
+    std::vector<std::pair<std::string, TextBuffer>> parts; // In order of first appearance
+
+    TextBuffer& part(std::string_view part_id)
+    {
+        auto it = std::find_if(parts.begin(), parts.end(), [&](const auto& p) { return p.first == part_id; });
+        if (it != parts.end())
+            return it->second;
+        return parts.emplace_back(std::string(part_id), TextBuffer{}).second;
+    }
+
+    const TextBuffer* find(std::string_view part_id) const
+    {
+        auto it = std::find_if(parts.begin(), parts.end(), [&](const auto& p) { return p.first == part_id; });
+        return it != parts.end() ? &it->second : nullptr;
+    }
+};
+
+} // anonymous namespace
+
+struct PartStore::Impl
+{
+    size_t initial_capacity;
+    mutable std::mutex mutex;
+    std::map<std::string, MessageParts, std::less<>> messages;
+
+    TextBuffer& part(std::string_view message_id, std::string_view part_id)
+    {
+        auto it = messages.find(message_id);
+        if (it == messages.end())
+            it = messages.emplace(std::string(message_id), MessageParts{}).first;
+        return it->second.part(part_id);
+    }
+};
+
+PartStore::PartStore(size_t initial_capacity)
+    : impl_(std::make_unique<Impl>())
+{
+    impl_->initial_capacity = std::max<size_t>(initial_capacity, 16);
+}
+
+PartStore::~PartStore() = default;
+
+std::string_view PartStore::append(std::string_view message_id, std::string_view part_id, std::string_view delta)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& text = impl_->part(message_id, part_id);
+    text.append(delta, impl_->initial_capacity);
+    return text.view();
+}
+
+std::string_view PartStore::assign(std::string_view message_id, std::string_view part_id, std::string_view text)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& part = impl_->part(message_id, part_id);
+    part.assign(text, impl_->initial_capacity);
+    return part.view();
+}
+
+std::string_view PartStore::apply(const MessagePartUpdatedEvent& event)
+{
+    const auto& part_id = std::visit([](const auto& p) -> const std::string& { return p.id; }, event.part);
+    auto* text = std::get_if<TextPart>(&event.part);
+    auto* reasoning = std::get_if<ReasoningPart>(&event.part);
+    if (!event.delta && !text && !reasoning)
+        return {};
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto& part = impl_->part(event.message_id, part_id);
+    part.reasoning = reasoning != nullptr;
+    if (event.delta)
+        part.append(*event.delta, impl_->initial_capacity);
+    else
+        part.assign(text ? text->text : reasoning->text, impl_->initial_capacity);
+    return part.view();
+}
+
+std::optional<std::string_view> PartStore::text(std::string_view message_id, std::string_view part_id) const
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto it = impl_->messages.find(message_id);
+    if (it == impl_->messages.end())
+        return std::nullopt;
+    if (const auto* part = it->second.find(part_id))
+        return part->view();
+    return std::nullopt;
+}
+
+std::string PartStore::message_text(std::string_view message_id, bool include_reasoning) const
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto it = impl_->messages.find(message_id);
+    if (it == impl_->messages.end())
+        return {};
+
+    size_t total = 0;
+    for (const auto& [id, part] : it->second.parts)
+    {
+        if (include_reasoning || !part.reasoning)
+            total += part.size;
+    }
+    std::string result;
+    result.reserve(total);
+    for (const auto& [id, part] : it->second.parts)
+    {
+        if (include_reasoning || !part.reasoning)
+            result += part.view();
+    }
+    return result;
+}
+
+void PartStore::compact(std::string_view message_id)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (auto it = impl_->messages.find(message_id); it != impl_->messages.end())
+    {
+        for (auto& [part_id, part] : it->second.parts)
+            part.compact();
+    }
+}
+
+void PartStore::erase_message(std::string_view message_id)
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (auto it = impl_->messages.find(message_id); it != impl_->messages.end())
+        impl_->messages.erase(it);
+}
+
+void PartStore::clear()
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->messages.clear();
+}
+
+size_t PartStore::bytes() const
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    size_t total = 0;
+    for (const auto& [message_id, message] : impl_->messages)
+    {
+        for (const auto& [part_id, part] : message.parts)
+            total += part.bytes();
+    }
+    return total;
+}
+
+} // namespace opencode
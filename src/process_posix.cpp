@@ -18,9 +18,14 @@
 #include <filesystem>
 #include <signal.h>
 #include <sstream>
-#include <sys/select.h>
+#include <string_view>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <utility>
+#include <vector>
 
 // Global environ pointer for environment manipulation (needed for macOS)
 extern "C" char** environ;
@@ -36,11 +41,83 @@ struct PipeHandle
 {
     int fd = -1;
 
+    // Read-ahead ring used by ReadPipe::read_line(). The capacity is a power of
+    // two and head/tail only grow, so tail - head is the number of bytes held.
+    std::vector<char> ring;
+    size_t head = 0;
+    size_t tail = 0;
+
     ~PipeHandle()
     {
         if (fd >= 0)
             ::close(fd);
     }
+
+    size_t buffered() const
+    {
+        return tail - head;
+    }
+
+    /// Offset (from head) of the first c in [from, limit), or npos
+    size_t find(char c, size_t from, size_t limit) const
+    {
+        const size_t mask = ring.size() - 1;
+        while (from < limit)
+        {
+            size_t start = (head + from) & mask;
+            size_t run = std::min(limit - from, ring.size() - start);
+            if (auto* hit = static_cast<const char*>(std::memchr(ring.data() + start, c, run)))
+                return from + static_cast<size_t>(hit - (ring.data() + start));
+            from += run;
+        }
+        return std::string::npos;
+    }
+
+    /// Move count buffered bytes out of the ring
+    void take(char* out, size_t count)
+    {
+        if (count == 0)
+            return;
+        size_t start = head & (ring.size() - 1);
+        size_t first = std::min(count, ring.size() - start);
+        std::memcpy(out, ring.data() + start, first);
+        std::memcpy(out + first, ring.data(), count - first);
+        head += count;
+    }
+
+    /// One read() into the free part of the ring, growing it when full
+    /// @return Bytes read, 0 on EOF, -1 with errno set on failure
+    ssize_t fill()
+    {
+        if (ring.empty())
+        {
+            ring.resize(4096);
+        }
+        else if (buffered() == ring.size())
+        {
+            std::vector<char> larger(ring.size() * 2);
+            size_t count = buffered();
+            take(larger.data(), count);
+            ring.swap(larger);
+            head = 0;
+            tail = count;
+        }
+
+        size_t start = tail & (ring.size() - 1);
+        size_t space = ring.size() - buffered();
+        size_t first = std::min(space, ring.size() - start);
+        iovec segments[2] = {{ring.data() + start, first}, {ring.data(), space - first}};
+
+        ssize_t bytes_read;
+        do
+        {
+            bytes_read = ::readv(fd, segments, space > first ? 2 : 1);
+        } while (bytes_read < 0 && errno == EINTR);
+
+        if (bytes_read > 0)
+            tail += static_cast<size_t>(bytes_read);
+        return bytes_read;
+    }
 };
 
 struct ProcessHandle
@@ -73,6 +150,175 @@ static void set_nonblocking(int fd)
         throw ProcessError("fcntl F_SETFL failed: " + get_errno_message());
 }
 
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define OPENCODE_SPAWN_ADDCHDIR 1
+#else
+#define OPENCODE_SPAWN_ADDCHDIR 0
+#endif
+
+/// Both ends of a pipe, created close-on-exec and closed on destruction
+/// unless released. Close-on-exec keeps a child spawned concurrently on
+/// another thread from inheriting (and holding open) this child's pipes.
+struct PipeFds
+{
+    int read = -1;
+    int write = -1;
+
+    ~PipeFds()
+    {
+        if (read >= 0)
+            ::close(read);
+        if (write >= 0)
+            ::close(write);
+    }
+
+    void open(const char* name)
+    {
+        int fds[2];
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+        if (::pipe2(fds, O_CLOEXEC) != 0)
+            throw ProcessError(std::string("Failed to create ") + name + " pipe: " + get_errno_message());
+#else
+        // No pipe2(): a fork() on another thread between these calls can still leak
+        if (::pipe(fds) != 0)
+            throw ProcessError(std::string("Failed to create ") + name + " pipe: " + get_errno_message());
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+        read = fds[0];
+        write = fds[1];
+    }
+
+    int release_read()
+    {
+        return std::exchange(read, -1);
+    }
+
+    int release_write()
+    {
+        return std::exchange(write, -1);
+    }
+};
+
+/// Build the child's environment as "KEY=VALUE" strings, in the parent, so the
+/// child does not have to allocate or touch environ between fork and exec
+static std::vector<std::string> build_environment(const ProcessOptions& options)
+{
+    std::vector<std::string> variables;
+    if (options.inherit_environment && environ)
+    {
+        for (char** entry = environ; *entry; ++entry)
+        {
+            std::string_view variable(*entry);
+            std::string key(variable.substr(0, variable.find('=')));
+            if (!options.environment.contains(key))
+                variables.emplace_back(variable);
+        }
+    }
+    for (const auto& [key, value] : options.environment)
+        variables.push_back(key + "=" + value);
+    return variables;
+}
+
+/// Null-terminated pointer array over strings, for argv/envp
+static std::vector<char*> to_pointers(std::vector<std::string>& strings)
+{
+    std::vector<char*> pointers;
+    pointers.reserve(strings.size() + 1);
+    for (auto& string : strings)
+        pointers.push_back(string.data());
+    pointers.push_back(nullptr);
+    return pointers;
+}
+
+/// Launch with posix_spawnp(); glibc and macOS implement it with vfork
+/// semantics, so the parent's page tables are not copied
+/// @return 0 on success, otherwise the errno-style failure code
+static int launch_spawn(pid_t& pid, char* const* argv, char* const* envp, const PipeFds& in,
+                        const PipeFds& out, const PipeFds& err, const ProcessOptions& options)
+{
+    posix_spawn_file_actions_t actions;
+    if (int rc = posix_spawn_file_actions_init(&actions))
+        return rc;
+
+    // dup2 clears close-on-exec on the target; the originals close on exec
+    int rc = 0;
+    if (!rc && in.read >= 0)
+        rc = posix_spawn_file_actions_adddup2(&actions, in.read, STDIN_FILENO);
+    if (!rc && out.write >= 0)
+        rc = posix_spawn_file_actions_adddup2(&actions, out.write, STDOUT_FILENO);
+    if (!rc && err.write >= 0)
+        rc = posix_spawn_file_actions_adddup2(&actions, err.write, STDERR_FILENO);
+#if OPENCODE_SPAWN_ADDCHDIR
+    if (!rc && !options.working_directory.empty())
+        rc = posix_spawn_file_actions_addchdir_np(&actions, options.working_directory.c_str());
+#else
+    (void)options;
+#endif
+
+    // PATH is searched using the parent's environment
+    if (!rc)
+        rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv, envp);
+
+    posix_spawn_file_actions_destroy(&actions);
+    return rc;
+}
+
+/// Launch with fork()/exec, for a working directory without addchdir support
+/// The child only calls async-signal-safe functions.
+/// @return 0 on success, otherwise the errno-style failure code
+static int launch_fork(pid_t& pid, char* const* argv, char* const* envp, const PipeFds& in, const PipeFds& out,
+                       const PipeFds& err, const ProcessOptions& options)
+{
+    // Error pipe for detecting exec failures; close-on-exec closes it on success
+    PipeFds error_pipe;
+    error_pipe.open("error");
+
+    pid = fork();
+    if (pid < 0)
+        return errno;
+
+    if (pid == 0)
+    {
+        // Child process
+        auto fail = [&]
+        {
+            int code = errno;
+            (void)::write(error_pipe.write, &code, sizeof(code));
+            _exit(127);
+        };
+
+        if (in.read >= 0 && dup2(in.read, STDIN_FILENO) < 0)
+            fail();
+        if (out.write >= 0 && dup2(out.write, STDOUT_FILENO) < 0)
+            fail();
+        if (err.write >= 0 && dup2(err.write, STDERR_FILENO) < 0)
+            fail();
+        if (!options.working_directory.empty() && chdir(options.working_directory.c_str()) != 0)
+            fail();
+
+        environ = const_cast<char**>(envp);
+        execvp(argv[0], argv);
+        fail();
+    }
+
+    // Parent process: wait for exec (pipe closes) or an error code
+    ::close(error_pipe.release_write());
+    int child_errno = 0;
+    ssize_t error_bytes;
+    do
+    {
+        error_bytes = ::read(error_pipe.read, &child_errno, sizeof(child_errno));
+    } while (error_bytes < 0 && errno == EINTR);
+
+    if (error_bytes > 0)
+    {
+        waitpid(pid, nullptr, 0); // Reap zombie child
+        return child_errno;
+    }
+    return 0;
+}
+
 // =============================================================================
 // ReadPipe implementation
 // =============================================================================
@@ -92,7 +338,20 @@ size_t ReadPipe::read(char* buffer, size_t size)
     if (!is_open())
         throw ProcessError("Pipe is not open");
 
-    ssize_t bytes_read = ::read(handle_->fd, buffer, size);
+    // Serve read-ahead from read_line() first
+    if (size_t buffered = handle_->buffered())
+    {
+        size_t count = std::min(buffered, size);
+        handle_->take(buffer, count);
+        return count;
+    }
+
+    ssize_t bytes_read;
+    do
+    {
+        bytes_read = ::read(handle_->fd, buffer, size);
+    } while (bytes_read < 0 && errno == EINTR);
+
     if (bytes_read < 0)
     {
         if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -105,41 +364,85 @@ size_t ReadPipe::read(char* buffer, size_t size)
 
 std::string ReadPipe::read_line(size_t max_size)
 {
-    std::string line;
-    line.reserve(256);
+    if (!is_open())
+        throw ProcessError("Pipe is not open");
 
-    char ch;
-    while (line.size() < max_size)
+    auto& pipe = *handle_;
+    size_t scanned = 0;
+    for (;;)
     {
-        size_t bytes_read = read(&ch, 1);
-        if (bytes_read == 0)
-            break; // EOF
-        line.push_back(ch);
-        if (ch == '\n')
-            break;
-    }
+        size_t limit = std::min(pipe.buffered(), max_size);
+        size_t newline = pipe.find('\n', scanned, limit);
+        if (newline != std::string::npos)
+        {
+            limit = newline + 1;
+        }
+        else if (limit < max_size)
+        {
+            // No complete line yet: read another chunk after what we have
+            scanned = limit;
+            ssize_t bytes_read = pipe.fill();
+            if (bytes_read > 0)
+                continue;
+            if (bytes_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                throw ProcessError("Read failed: " + get_errno_message());
+            // EOF or no data: return the partial line
+        }
 
-    return line;
+        std::string line(limit, '\0');
+        pipe.take(line.data(), limit);
+        return line;
+    }
 }
 
 bool ReadPipe::has_data(int timeout_ms)
 {
     if (!is_open())
         return false;
+    return !wait_any({this}, timeout_ms).empty();
+}
 
-    fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(handle_->fd, &read_fds);
+std::vector<size_t> ReadPipe::wait_any(const std::vector<ReadPipe*>& pipes, int timeout_ms)
+{
+    // The set of pipes changes from call to call (stdout and stderr of one
+    // child, minus any that closed), so it is passed to poll() as an array
+    // each time rather than kept registered with the kernel
+    std::vector<size_t> ready;
+    std::vector<pollfd> entries;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < pipes.size(); ++i)
+    {
+        ReadPipe* pipe = pipes[i];
+        if (!pipe || !pipe->is_open())
+            continue;
+        if (pipe->handle_->buffered() > 0)
+        {
+            ready.push_back(i);
+            continue;
+        }
+        entries.push_back({pipe->handle_->fd, POLLIN, 0});
+        indices.push_back(i);
+    }
+    if (entries.empty())
+        return ready;
 
-    struct timeval timeout;
-    timeout.tv_sec = timeout_ms / 1000;
-    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    int result;
+    do
+    {
+        result = ::poll(entries.data(), entries.size(), ready.empty() ? timeout_ms : 0);
+    } while (result < 0 && errno == EINTR);
 
-    int result = select(handle_->fd + 1, &read_fds, nullptr, nullptr, &timeout);
     if (result < 0)
-        throw ProcessError("select failed: " + get_errno_message());
+        throw ProcessError("poll failed: " + get_errno_message());
 
-    return result > 0 && FD_ISSET(handle_->fd, &read_fds);
+    // POLLHUP without POLLIN still means read() will return EOF without blocking
+    for (size_t k = 0; k < entries.size(); ++k)
+    {
+        if (entries[k].revents & (POLLIN | POLLHUP | POLLERR))
+            ready.push_back(indices[k]);
+    }
+    std::sort(ready.begin(), ready.end());
+    return ready;
 }
 
 void ReadPipe::close()
@@ -252,234 +555,42 @@ void Process::spawn(
     const ProcessOptions& options
 )
 {
-    // Create pipes for stdin
-    int stdin_pipe[2] = {-1, -1};
+    // Create pipes for the redirected streams
+    PipeFds stdin_fds, stdout_fds, stderr_fds;
     if (options.redirect_stdin)
-    {
-        if (pipe(stdin_pipe) != 0)
-            throw ProcessError("Failed to create stdin pipe: " + get_errno_message());
-    }
-
-    // Create pipes for stdout
-    int stdout_pipe[2] = {-1, -1};
+        stdin_fds.open("stdin");
     if (options.redirect_stdout)
-    {
-        if (pipe(stdout_pipe) != 0)
-        {
-            if (stdin_pipe[0] >= 0)
-            {
-                ::close(stdin_pipe[0]);
-                ::close(stdin_pipe[1]);
-            }
-            throw ProcessError("Failed to create stdout pipe: " + get_errno_message());
-        }
-    }
-
-    // Create pipes for stderr
-    int stderr_pipe[2] = {-1, -1};
+        stdout_fds.open("stdout");
     if (options.redirect_stderr)
-    {
-        if (pipe(stderr_pipe) != 0)
-        {
-            if (stdin_pipe[0] >= 0)
-            {
-                ::close(stdin_pipe[0]);
-                ::close(stdin_pipe[1]);
-            }
-            if (stdout_pipe[0] >= 0)
-            {
-                ::close(stdout_pipe[0]);
-                ::close(stdout_pipe[1]);
-            }
-            throw ProcessError("Failed to create stderr pipe: " + get_errno_message());
-        }
-    }
-
-    // Create error pipe for detecting exec failures (O_CLOEXEC closes on successful exec)
-    int error_pipe[2] = {-1, -1};
-    if (pipe(error_pipe) != 0)
-    {
-        if (stdin_pipe[0] >= 0)
-        {
-            ::close(stdin_pipe[0]);
-            ::close(stdin_pipe[1]);
-        }
-        if (stdout_pipe[0] >= 0)
-        {
-            ::close(stdout_pipe[0]);
-            ::close(stdout_pipe[1]);
-        }
-        if (stderr_pipe[0] >= 0)
-        {
-            ::close(stderr_pipe[0]);
-            ::close(stderr_pipe[1]);
-        }
-        throw ProcessError("Failed to create error pipe: " + get_errno_message());
-    }
-    // Set close-on-exec for write end - will be closed automatically on successful exec
-    fcntl(error_pipe[1], F_SETFD, FD_CLOEXEC);
-
-    // Fork the process
-    pid_t pid = fork();
-    if (pid < 0)
-    {
-        // Fork failed - clean up pipes
-        if (stdin_pipe[0] >= 0)
-        {
-            ::close(stdin_pipe[0]);
-            ::close(stdin_pipe[1]);
-        }
-        if (stdout_pipe[0] >= 0)
-        {
-            ::close(stdout_pipe[0]);
-            ::close(stdout_pipe[1]);
-        }
-        if (stderr_pipe[0] >= 0)
-        {
-            ::close(stderr_pipe[0]);
-            ::close(stderr_pipe[1]);
-        }
-        ::close(error_pipe[0]);
-        ::close(error_pipe[1]);
-        throw ProcessError("Failed to fork process: " + get_errno_message());
-    }
-
-    if (pid == 0)
-    {
-        // Child process
-
-        // Close error pipe read end - we only write to it
-        ::close(error_pipe[0]);
-
-        // Redirect stdin
-        if (options.redirect_stdin)
-        {
-            ::close(stdin_pipe[1]); // Close write end
-            if (dup2(stdin_pipe[0], STDIN_FILENO) < 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-            ::close(stdin_pipe[0]);
-        }
-
-        // Redirect stdout
-        if (options.redirect_stdout)
-        {
-            ::close(stdout_pipe[0]); // Close read end
-            if (dup2(stdout_pipe[1], STDOUT_FILENO) < 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-            ::close(stdout_pipe[1]);
-        }
-
-        // Redirect stderr
-        if (options.redirect_stderr)
-        {
-            ::close(stderr_pipe[0]); // Close read end
-            if (dup2(stderr_pipe[1], STDERR_FILENO) < 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-            ::close(stderr_pipe[1]);
-        }
-
-        // Change working directory
-        if (!options.working_directory.empty())
-        {
-            if (chdir(options.working_directory.c_str()) != 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-        }
-
-        // Set environment variables
-        if (!options.inherit_environment)
-        {
-#if defined(__linux__) && defined(_GNU_SOURCE)
-            clearenv();
-#else
-            // Fallback: best-effort clearing by resetting environ
-            if (environ)
-                environ[0] = nullptr;
-#endif
-        }
-
-        for (const auto& [key, value] : options.environment)
-            setenv(key.c_str(), value.c_str(), 1); // Overwrite if exists
-
-        // Build argv array
-        std::vector<char*> argv;
-        argv.push_back(const_cast<char*>(executable.c_str()));
-        for (const auto& arg : args)
-            argv.push_back(const_cast<char*>(arg.c_str()));
-        argv.push_back(nullptr);
+        stderr_fds.open("stderr");
 
-        // Execute the program
-        execvp(executable.c_str(), argv.data());
+    // Build argv and envp up front
+    std::vector<std::string> arguments;
+    arguments.reserve(args.size() + 1);
+    arguments.push_back(executable);
+    arguments.insert(arguments.end(), args.begin(), args.end());
+    auto argv = to_pointers(arguments);
 
-        // If execvp returns, it failed - write error to pipe
-        int err = errno;
-        (void)::write(error_pipe[1], &err, sizeof(err));
-        _exit(127);
-    }
-
-    // Parent process
+    auto variables = build_environment(options);
+    auto envp = to_pointers(variables);
 
-    // Close write end of error pipe and check for exec errors
-    ::close(error_pipe[1]);
-    int child_errno = 0;
-    ssize_t error_bytes = ::read(error_pipe[0], &child_errno, sizeof(child_errno));
-    ::close(error_pipe[0]);
+    pid_t pid = 0;
+    int rc;
+    if (OPENCODE_SPAWN_ADDCHDIR || options.working_directory.empty())
+        rc = launch_spawn(pid, argv.data(), envp.data(), stdin_fds, stdout_fds, stderr_fds, options);
+    else
+        rc = launch_fork(pid, argv.data(), envp.data(), stdin_fds, stdout_fds, stderr_fds, options);
 
-    if (error_bytes > 0)
-    {
-        // Exec failed in child - clean up and throw
-        waitpid(pid, nullptr, 0); // Reap zombie child
-        if (options.redirect_stdin)
-        {
-            ::close(stdin_pipe[0]);
-            ::close(stdin_pipe[1]);
-        }
-        if (options.redirect_stdout)
-        {
-            ::close(stdout_pipe[0]);
-            ::close(stdout_pipe[1]);
-        }
-        if (options.redirect_stderr)
-        {
-            ::close(stderr_pipe[0]);
-            ::close(stderr_pipe[1]);
-        }
-        throw ProcessError("Failed to execute '" + executable + "': " + std::strerror(child_errno));
-    }
+    if (rc != 0)
+        throw ProcessError("Failed to execute '" + executable + "': " + std::strerror(rc));
 
-    // Close unused pipe ends and store handles
+    // Keep our ends; the child's ends are closed when the PipeFds go away
     if (options.redirect_stdin)
-    {
-        ::close(stdin_pipe[0]); // Close read end
-        stdin_->handle_->fd = stdin_pipe[1];
-    }
-
+        stdin_->handle_->fd = stdin_fds.release_write();
     if (options.redirect_stdout)
-    {
-        ::close(stdout_pipe[1]); // Close write end
-        stdout_->handle_->fd = stdout_pipe[0];
-    }
-
+        stdout_->handle_->fd = stdout_fds.release_read();
     if (options.redirect_stderr)
-    {
-        ::close(stderr_pipe[1]); // Close write end
-        stderr_->handle_->fd = stderr_pipe[0];
-    }
+        stderr_->handle_->fd = stderr_fds.release_read();
 
     // Store process information
     handle_->pid = pid;
@@ -515,16 +626,26 @@ bool Process::is_running() const
     if (!handle_->running)
         return false;
 
-    // Check process status using kill with signal 0
-    int result = ::kill(handle_->pid, 0);
+    // Reap without blocking; kill(pid, 0) would report an exited, unreaped child as running
+    int status;
+    pid_t result = waitpid(handle_->pid, &status, WNOHANG);
     if (result == 0)
-        return true; // Process exists
+        return true; // Still running
 
-    if (errno == ESRCH)
-        return false; // Process doesn't exist
+    if (result == handle_->pid)
+    {
+        if (WIFEXITED(status))
+            handle_->exit_code = WEXITSTATUS(status);
+        else if (WIFSIGNALED(status))
+            handle_->exit_code = 128 + WTERMSIG(status);
+        else
+            handle_->exit_code = -1;
+        handle_->running = false;
+        return false;
+    }
 
-    // For other errors (EPERM), assume process exists
-    return true;
+    // waitpid failed (e.g. ECHILD when SIGCHLD is ignored): fall back to probing the pid
+    return ::kill(handle_->pid, 0) == 0 || errno != ESRCH;
 }
 
 std::optional<int> Process::try_wait()
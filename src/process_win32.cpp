@@ -16,6 +16,7 @@
 #endif
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <sstream>
 #include <windows.h>
@@ -31,6 +32,10 @@ struct PipeHandle
 {
     HANDLE handle = INVALID_HANDLE_VALUE;
 
+    // Bytes read ahead by ReadPipe::read_line, consumed from buffer_pos
+    std::string buffer;
+    size_t buffer_pos = 0;
+
     ~PipeHandle()
     {
         if (handle != INVALID_HANDLE_VALUE)
@@ -214,6 +219,16 @@ size_t ReadPipe::read(char* buffer, size_t size)
     if (!is_open())
         throw ProcessError("Pipe is not open");
 
+    // Serve read-ahead from read_line() first
+    size_t buffered = handle_->buffer.size() - handle_->buffer_pos;
+    if (buffered > 0)
+    {
+        size_t count = (std::min)(buffered, size);
+        std::memcpy(buffer, handle_->buffer.data() + handle_->buffer_pos, count);
+        handle_->buffer_pos += count;
+        return count;
+    }
+
     DWORD bytes_read = 0;
     BOOL success =
         ReadFile(handle_->handle, buffer, static_cast<DWORD>(size), &bytes_read, nullptr);
@@ -231,53 +246,105 @@ size_t ReadPipe::read(char* buffer, size_t size)
 
 std::string ReadPipe::read_line(size_t max_size)
 {
-    std::string line;
-    line.reserve(256);
+    if (!is_open())
+        throw ProcessError("Pipe is not open");
+
+    auto& buffer = handle_->buffer;
+    auto& pos = handle_->buffer_pos;
+    constexpr size_t chunk_size = 4096;
 
-    char ch;
-    while (line.size() < max_size)
+    size_t scanned = pos;
+    for (;;)
     {
-        size_t bytes_read = read(&ch, 1);
-        if (bytes_read == 0)
-            break; // EOF
-        line.push_back(ch);
-        if (ch == '\n')
-            break;
+        size_t limit = (std::min)(buffer.size(), pos + max_size);
+        size_t newline = buffer.find('\n', scanned);
+        if (newline != std::string::npos && newline < limit)
+            limit = newline + 1;
+        else if (limit < pos + max_size)
+        {
+            // No complete line yet: read another chunk after what we have
+            scanned = buffer.size();
+            if (pos > 0)
+            {
+                buffer.erase(0, pos);
+                scanned -= pos;
+                pos = 0;
+            }
+            buffer.resize(scanned + chunk_size);
+            DWORD bytes_read = 0;
+            BOOL success = ReadFile(handle_->handle, buffer.data() + scanned, static_cast<DWORD>(chunk_size),
+                                    &bytes_read, nullptr);
+            DWORD error = success ? ERROR_SUCCESS : GetLastError();
+            buffer.resize(scanned + bytes_read);
+
+            if (success && bytes_read > 0)
+                continue;
+            if (!success && error != ERROR_BROKEN_PIPE && error != ERROR_NO_DATA)
+            {
+                SetLastError(error);
+                throw ProcessError("Read failed: " + get_last_error_message());
+            }
+            limit = buffer.size(); // EOF: return the partial line
+        }
+
+        std::string line = buffer.substr(pos, limit - pos);
+        pos = limit;
+        if (pos == buffer.size())
+        {
+            buffer.clear();
+            pos = 0;
+        }
+        return line;
     }
+}
 
-    return line;
+// Anonymous pipes cannot be waited on, so peek; a broken pipe reads as EOF
+static bool pipe_ready(const PipeHandle& pipe)
+{
+    if (pipe.buffer_pos < pipe.buffer.size())
+        return true;
+    DWORD bytes_available = 0;
+    if (PeekNamedPipe(pipe.handle, nullptr, 0, nullptr, &bytes_available, nullptr))
+        return bytes_available > 0;
+    return GetLastError() == ERROR_BROKEN_PIPE;
 }
 
 bool ReadPipe::has_data(int timeout_ms)
 {
     if (!is_open())
         return false;
+    return !wait_any({this}, timeout_ms).empty();
+}
 
-    DWORD bytes_available = 0;
-    if (PeekNamedPipe(handle_->handle, nullptr, 0, nullptr, &bytes_available, nullptr))
-    {
-        if (bytes_available > 0)
-            return true;
-    }
-
-    if (timeout_ms > 0)
+std::vector<size_t> ReadPipe::wait_any(const std::vector<ReadPipe*>& pipes, int timeout_ms)
+{
+    std::vector<size_t> ready;
+    auto check = [&]
     {
-        // Simple polling implementation for timeout
-        int remaining = timeout_ms;
-        const int poll_interval = 10;
-        while (remaining > 0)
+        for (size_t i = 0; i < pipes.size(); ++i)
         {
-            Sleep(poll_interval);
-            remaining -= poll_interval;
-            if (PeekNamedPipe(handle_->handle, nullptr, 0, nullptr, &bytes_available, nullptr))
-            {
-                if (bytes_available > 0)
-                    return true;
-            }
+            if (pipes[i] && pipes[i]->is_open() && pipe_ready(*pipes[i]->handle_))
+                ready.push_back(i);
         }
+        return !ready.empty();
+    };
+
+    bool any_open = std::any_of(pipes.begin(), pipes.end(), [](ReadPipe* pipe) { return pipe && pipe->is_open(); });
+    if (check() || !any_open)
+        return ready;
+
+    // Simple polling implementation for timeout
+    int remaining = timeout_ms;
+    const int poll_interval = 10;
+    while (timeout_ms < 0 || remaining > 0)
+    {
+        Sleep(poll_interval);
+        remaining -= poll_interval;
+        if (check())
+            break;
     }
 
-    return false;
+    return ready;
 }
 
 void ReadPipe::close()
@@ -0,0 +1,267 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <opencode/pty_channel.hpp>
+#include <opencode/client.hpp>
+#include <opencode/transport.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace opencode
+{
+
+// =============================================================================
+// PtyChannel Implementation
+// =============================================================================
+
+class PtyChannel::Impl
+{
+  public:
+    Impl(Client* client, std::string pty_id, std::unique_ptr<Transport> output, PtyChannelOptions options)
+        : client_(client), id_(std::move(pty_id)), output_(std::move(output)), options_(std::move(options))
+    {
+        if (options_.max_batch_bytes == 0)
+            options_.max_batch_bytes = 1;
+
+        writer_ = std::thread([this] { run_writer(); });
+
+        if (output_ && options_.on_output)
+        {
+            bool started = output_->start_websocket(
+                "/pty/" + id_ + "/connect",
+                {},
+                [this](std::string_view data)
+                {
+                    if (!data.empty())
+                        options_.on_output(data);
+                },
+                [this](const std::string& error) { output_error_ = error; },
+                [this]()
+                {
+                    if (options_.on_closed)
+                        options_.on_closed(output_error_);
+                });
+            if (!started && options_.on_closed)
+                options_.on_closed("Transport cannot open a WebSocket for PTY output");
+        }
+    }
+
+    ~Impl()
+    {
+        close();
+    }
+
+    const std::string& id() const
+    {
+        return id_;
+    }
+
+    void write(std::string_view data)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_)
+            throw std::runtime_error("PTY write failed: " + *error_);
+        if (stopping_)
+            throw std::runtime_error("PTY channel is closed");
+        if (data.empty())
+            return;
+
+        if (pending_.empty())
+            oldest_ = std::chrono::steady_clock::now();
+        pending_.append(data);
+        ++stats_.writes;
+        cv_.notify_all();
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++flushing_;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return (pending_.empty() && !in_flight_) || error_; });
+        --flushing_;
+        if (error_)
+            throw std::runtime_error("PTY write failed: " + *error_);
+    }
+
+    void resize(int cols, int rows)
+    {
+        flush();
+        client_->pty_resize(id_, cols, rows);
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            cv_.notify_all();
+        }
+        // The writer sends what is still pending before it exits
+        if (writer_.joinable())
+            writer_.join();
+        if (output_)
+            output_->stop_websocket();
+    }
+
+    PtyChannelStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+  private:
+    /// Send pending input, one request at a time so it arrives in order
+    void run_writer()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty())
+                return; // Stopping with nothing left
+
+            // Give a burst up to coalesce_window (from its first byte) to grow
+            cv_.wait_until(lock, oldest_ + options_.coalesce_window, [this]
+            {
+                return stopping_ || flushing_ > 0 || pending_.size() >= options_.max_batch_bytes;
+            });
+
+            std::string batch = take_batch();
+            in_flight_ = true;
+            lock.unlock();
+
+            // Input rides the output WebSocket while it is up, as the server
+            // expects; the write endpoint covers the rest
+            std::optional<std::string> failure;
+            try
+            {
+                if (!output_ || !output_->websocket_send(batch))
+                    client_->pty_write(id_, batch);
+            }
+            catch (const std::exception& e)
+            {
+                failure = e.what();
+            }
+
+            lock.lock();
+            in_flight_ = false;
+            if (failure)
+            {
+                // Input after a lost batch would arrive out of context; drop it
+                error_ = std::move(failure);
+                pending_.clear();
+            }
+            else
+            {
+                ++stats_.requests;
+                stats_.bytes_sent += batch.size();
+            }
+            cv_.notify_all();
+        }
+    }
+
+    /// Remove up to max_batch_bytes from pending_, not splitting a UTF-8 sequence
+    /// Caller must hold mutex_
+    std::string take_batch()
+    {
+        size_t size = pending_.size();
+        if (size > options_.max_batch_bytes)
+        {
+            size = options_.max_batch_bytes;
+            size_t cut = size;
+            while (cut > 0 && size - cut < 3 && (static_cast<unsigned char>(pending_[cut]) & 0xC0) == 0x80)
+                --cut;
+            if (cut > 0)
+                size = cut;
+        }
+
+        std::string batch;
+        if (size == pending_.size())
+        {
+            batch.swap(pending_);
+        }
+        else
+        {
+            batch.assign(pending_, 0, size);
+            pending_.erase(0, size);
+            oldest_ = std::chrono::steady_clock::now();
+        }
+        return batch;
+    }
+
+    Client* client_;
+    std::string id_;
+    std::unique_ptr<Transport> output_;
+    PtyChannelOptions options_;
+    std::string output_error_; // Set on the stream thread before on_close
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string pending_;
+    std::chrono::steady_clock::time_point oldest_; // When pending_'s first byte was queued
+    bool in_flight_ = false;
+    bool stopping_ = false;
+    int flushing_ = 0; // flush() callers waiting; skip the coalesce window
+    std::optional<std::string> error_;
+    PtyChannelStats stats_;
+    std::thread writer_;
+};
+
+// =============================================================================
+// PtyChannel Public Interface
+// =============================================================================
+
+PtyChannel::PtyChannel(Client* client, std::string pty_id, std::unique_ptr<Transport> output,
+                       PtyChannelOptions options)
+    : impl_(std::make_unique<Impl>(client, std::move(pty_id), std::move(output), std::move(options)))
+{
+}
+
+PtyChannel::~PtyChannel() = default;
+
+PtyChannel::PtyChannel(PtyChannel&&) noexcept = default;
+PtyChannel& PtyChannel::operator=(PtyChannel&&) noexcept = default;
+
+const std::string& PtyChannel::id() const
+{
+    static const std::string empty;
+    return impl_ ? impl_->id() : empty;
+}
+
+void PtyChannel::write(std::string_view data)
+{
+    if (!impl_)
+        throw std::runtime_error("PTY channel is closed");
+    impl_->write(data);
+}
+
+void PtyChannel::flush()
+{
+    if (impl_)
+        impl_->flush();
+}
+
+void PtyChannel::resize(int cols, int rows)
+{
+    if (!impl_)
+        throw std::runtime_error("PTY channel is closed");
+    impl_->resize(cols, rows);
+}
+
+void PtyChannel::close()
+{
+    if (impl_)
+        impl_->close();
+}
+
+PtyChannelStats PtyChannel::stats() const
+{
+    return impl_ ? impl_->stats() : PtyChannelStats{};
+}
+
+} // namespace opencode
@@ -3,15 +3,113 @@
 
 #include <opencode/server.hpp>
 #include <opencode/process.hpp>
+#include <opencode/transport.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <chrono>
 #include <stdexcept>
 #include <thread>
-#include <regex>
 
 namespace opencode
 {
 
+// =============================================================================
+// Startup Output Matching
+// =============================================================================
+
+namespace
+{
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+/// Case-insensitive prefix test; prefix must be lowercase
+bool starts_with_icase(std::string_view text, std::string_view prefix)
+{
+    return text.size() >= prefix.size() &&
+           std::equal(prefix.begin(), prefix.end(), text.begin(),
+                      [](char p, char c) { return p == std::tolower(static_cast<unsigned char>(c)); });
+}
+
+/// Find the URL in a listening line, case-insensitively:
+/// (listening|running|started|bound) <space> (on|at) <space> http(s)://<non-space>
+/// Common forms:
+/// - "Listening on http://127.0.0.1:4096"
+/// - "Server running at http://localhost:4096"
+/// - "opencode server listening on http://127.0.0.1:4096"
+std::optional<std::string_view> find_listening_url(std::string_view line)
+{
+    static constexpr std::string_view verbs[] = {"listening", "running", "started", "bound"};
+
+    auto skip_spaces = [&](size_t pos)
+    {
+        while (pos < line.size() && is_space(line[pos]))
+            ++pos;
+        return pos;
+    };
+
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        for (auto verb : verbs)
+        {
+            if (!starts_with_icase(line.substr(i), verb))
+                continue;
+
+            size_t pos = i + verb.size();
+            size_t next = skip_spaces(pos);
+            if (next == pos)
+                continue;
+            pos = next;
+
+            auto rest = line.substr(pos);
+            if (!starts_with_icase(rest, "on") && !starts_with_icase(rest, "at"))
+                continue;
+            pos += 2;
+            next = skip_spaces(pos);
+            if (next == pos)
+                continue;
+            pos = next;
+
+            rest = line.substr(pos);
+            size_t scheme = starts_with_icase(rest, "https://") ? 8 : starts_with_icase(rest, "http://") ? 7 : 0;
+            if (scheme == 0)
+                continue;
+
+            size_t end = pos + scheme;
+            while (end < line.size() && !is_space(line[end]))
+                ++end;
+            if (end > pos + scheme)
+                return line.substr(pos, end - pos);
+        }
+    }
+    return std::nullopt;
+}
+
+/// Port of an http(s) URL, if it names one
+std::optional<int> url_port(std::string_view url)
+{
+    auto authority = url.substr(url.find("://") + 3);
+    authority = authority.substr(0, authority.find_first_of("/?#"));
+
+    // The last colon, unless it is inside an IPv6 literal ("[::1]")
+    size_t colon = authority.rfind(':');
+    if (colon == std::string_view::npos || authority.find(']', colon) != std::string_view::npos)
+        return std::nullopt;
+
+    int port = 0;
+    auto digits = authority.substr(colon + 1);
+    auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), port);
+    if (ec != std::errc() || ptr == digits.data())
+        return std::nullopt;
+    return port;
+}
+
+} // namespace
+
 Server::Server(std::string url, std::string hostname, int port, std::unique_ptr<Process> process)
     : url_(std::move(url)), hostname_(std::move(hostname)), port_(port), process_(std::move(process))
 {
@@ -91,64 +189,116 @@ Server Server::spawn(const ServerOptions& opts)
 
     // Wait for server to output the listening message
     // OpenCode outputs something like: "opencode server listening on http://127.0.0.1:4096"
-    // or similar format based on the server implementation
-    auto start_time = std::chrono::steady_clock::now();
+    // Output is read in chunks as soon as the pipe is readable and split into lines
+    auto deadline = std::chrono::steady_clock::now() + opts.startup_timeout;
     std::string accumulated_output;
+    size_t line_start = 0;
     std::string detected_url;
     int detected_port = opts.port;
     std::string detected_hostname = opts.hostname;
+    const std::string port_text = ":" + std::to_string(opts.port);
+
+    auto check_line = [&](std::string_view line)
+    {
+        if (auto url = find_listening_url(line))
+        {
+            detected_url = std::string(*url);
+            if (auto port = url_port(*url))
+                detected_port = *port;
+            return true;
+        }
+
+        // Also check for simple port binding messages
+        if (opts.port != 0 && line.find(port_text) != std::string_view::npos &&
+            (line.find("listen") != std::string_view::npos || line.find("bound") != std::string_view::npos ||
+             line.find("server") != std::string_view::npos))
+        {
+            detected_url = "http://" + opts.hostname + port_text;
+            return true;
+        }
+        return false;
+    };
 
-    // Pattern to match server listening line
-    // Common patterns:
-    // - "Listening on http://127.0.0.1:4096"
-    // - "Server running at http://localhost:4096"
-    // - "opencode server listening on http://127.0.0.1:4096"
-    std::regex url_pattern(R"((?:listening|running|started|bound)\s+(?:on|at)\s+(https?://[^\s]+))",
-                          std::regex::icase);
-    std::regex port_pattern(R"(:(\d+))");
+    // Optional health probe racing the output, on the fixed port
+    std::unique_ptr<HttpTransport> probe;
+    auto next_probe = std::chrono::steady_clock::time_point::max();
+    if (opts.health_probe_interval && opts.port != 0)
+    {
+        if (opts.password)
+            probe = std::make_unique<HttpTransport>(opts.hostname, opts.port, opts.username.value_or("opencode"),
+                                                    *opts.password);
+        else
+            probe = std::make_unique<HttpTransport>(opts.hostname, opts.port);
+        probe->set_connection_timeout(1);
+        probe->set_read_timeout(1);
+        next_probe = std::chrono::steady_clock::now() + *opts.health_probe_interval;
+    }
+
+    auto& output = process->stdout_pipe();
+    bool output_open = output.is_open();
+    bool ready = false;
+    char chunk[4096];
 
-    while (process->is_running())
+    // try_wait() reaps the child, so a server that exits is noticed right away
+    while (!ready && !process->try_wait())
     {
-        auto elapsed = std::chrono::steady_clock::now() - start_time;
-        if (elapsed >= opts.startup_timeout)
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
         {
             process->kill();
             throw std::runtime_error("Server startup timeout: did not detect listening message within " +
                                      std::to_string(opts.startup_timeout.count()) + "ms. Output: " + accumulated_output);
         }
 
-        // Check for data with a short timeout
-        if (process->stdout_pipe().has_data(100))
+        // Sleep in the pipe wait until output arrives, the probe is due or time runs out.
+        // Only the server's stdout is watched, and only until its banner appears.
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(std::min(deadline, next_probe) - now);
+        if (output_open)
         {
-            std::string line = process->stdout_pipe().read_line();
-            accumulated_output += line;
-
-            // Check for URL in output
-            std::smatch match;
-            if (std::regex_search(line, match, url_pattern))
+            if (output.has_data(static_cast<int>(wait.count())))
             {
-                detected_url = match[1].str();
-
-                // Extract port from URL
-                std::smatch port_match;
-                if (std::regex_search(detected_url, port_match, port_pattern))
+                size_t bytes_read = output.read(chunk, sizeof(chunk));
+                if (bytes_read == 0)
                 {
-                    detected_port = std::stoi(port_match[1].str());
+                    output_open = false; // EOF: the server closed its output
+                }
+                else
+                {
+                    accumulated_output.append(chunk, bytes_read);
+                    size_t newline;
+                    while (!ready && (newline = accumulated_output.find('\n', line_start)) != std::string::npos)
+                    {
+                        auto line = std::string_view(accumulated_output).substr(line_start, newline + 1 - line_start);
+                        ready = check_line(line);
+                        line_start = newline + 1;
+                    }
                 }
-
-                // We found the listening message, server is ready
-                break;
             }
+        }
+        else
+        {
+            // Nothing left to read: wait for the process to exit, the probe or the deadline
+            std::this_thread::sleep_for(std::min(wait, std::chrono::milliseconds(50)));
+        }
 
-            // Also check for simple port binding messages
-            if (line.find(":" + std::to_string(opts.port)) != std::string::npos &&
-                (line.find("listen") != std::string::npos ||
-                 line.find("bound") != std::string::npos ||
-                 line.find("server") != std::string::npos))
+        if (!ready && probe && std::chrono::steady_clock::now() >= next_probe)
+        {
+            try
             {
-                detected_url = "http://" + opts.hostname + ":" + std::to_string(opts.port);
-                break;
+                HttpRequest req;
+                req.method = "GET";
+                req.path = "/global/health";
+                if (probe->request(req).status == 200 && process->is_running())
+                {
+                    detected_url = "http://" + opts.hostname + port_text;
+                    ready = true;
+                }
+            }
+            catch (...)
+            {
+                // Not listening yet
             }
+            next_probe = std::chrono::steady_clock::now() + *opts.health_probe_interval;
         }
     }
 
@@ -0,0 +1,607 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <opencode/server_pool.hpp>
+#include <opencode/transport.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace opencode
+{
+
+namespace
+{
+
+/// Resident memory of a process, where the platform makes it cheap to read
+std::optional<size_t> resident_bytes(int pid)
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (statm >> total_pages >> resident_pages)
+        return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    (void)pid;
+#endif
+    return std::nullopt;
+}
+
+} // namespace
+
+// =============================================================================
+// ServerPool Implementation
+// =============================================================================
+
+class ServerPool::Impl : public std::enable_shared_from_this<ServerPool::Impl>
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Impl(ServerPoolOptions options)
+        : options_(std::move(options))
+    {
+        maintenance_ = std::thread([this] { maintain(); });
+    }
+
+    ~Impl()
+    {
+        shutdown();
+    }
+
+    void prewarm(const std::string& directory)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                throw std::runtime_error("Server pool is shut down");
+            directories_[key(directory)];
+            wake_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    ServerLease lease(const std::string& directory)
+    {
+        auto dir = key(directory);
+        auto deadline = Clock::now() + options_.lease_timeout;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            if (stopping_)
+                throw std::runtime_error("Server pool is shut down");
+
+            auto& state = directories_[dir];
+            if (!state.idle.empty())
+            {
+                // Most recently used first
+                auto candidate = std::move(state.idle.back());
+                state.idle.pop_back();
+                ++leased_;
+                wake_ = true;
+                lock.unlock();
+                cv_.notify_all(); // Restore the warm count
+
+                if (healthy(*candidate.server))
+                    return ServerLease(weak_from_this(), dir, std::move(candidate.server), candidate.leases + 1);
+
+                lock.lock();
+                --leased_;
+                ++health_failures_;
+                retire(std::move(candidate.server));
+                continue;
+            }
+
+            if (state.starting > 0)
+            {
+                // A server for this directory is on its way; it is sooner than a new one
+                if (cv_.wait_until(lock, deadline) == std::cv_status::timeout)
+                    throw std::runtime_error("Timed out waiting for a pooled server");
+                continue;
+            }
+
+            if (total() < options_.max_servers || evict_idle_elsewhere(dir))
+            {
+                ++state.starting;
+                lock.unlock();
+                std::unique_ptr<Server> server;
+                try
+                {
+                    server = spawn(dir);
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    --directories_[dir].starting;
+                    cv_.notify_all();
+                    throw;
+                }
+                lock.lock();
+                --directories_[dir].starting;
+                ++leased_;
+                wake_ = true;
+                cv_.notify_all();
+                return ServerLease(weak_from_this(), dir, std::move(server), 1);
+            }
+
+            if (cv_.wait_until(lock, deadline) == std::cv_status::timeout)
+                throw std::runtime_error("Timed out waiting for a pooled server");
+        }
+    }
+
+    /// A lease ended; keep the server unless it is due for recycling
+    void give_back(const std::string& dir, std::unique_ptr<Server> server, size_t leases, bool discard)
+    {
+        bool recycle = !discard && recycle_due(*server, leases);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --leased_;
+            if (stopping_)
+            {
+                // No maintenance thread any more; stopped below
+            }
+            else if (discard || recycle || !server->running())
+            {
+                if (recycle)
+                    ++recycled_;
+                retire(std::move(server));
+            }
+            else
+            {
+                directories_[dir].idle.push_back({std::move(server), leases, Clock::now(), Clock::now()});
+            }
+        }
+        cv_.notify_all();
+        if (server)
+            server->stop();
+    }
+
+    ServerPoolStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ServerPoolStats stats;
+        for (const auto& [dir, state] : directories_)
+        {
+            stats.idle += state.idle.size();
+            stats.starting += state.starting;
+        }
+        stats.leased = leased_;
+        stats.spawned = spawned_;
+        stats.recycled = recycled_;
+        stats.health_failures = health_failures_;
+        return stats;
+    }
+
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ && !maintenance_.joinable())
+                return;
+            stopping_ = true;
+            for (auto& [dir, state] : directories_)
+            {
+                for (auto& idle : state.idle)
+                    retire(std::move(idle.server));
+                state.idle.clear();
+            }
+        }
+        cv_.notify_all();
+        if (maintenance_.joinable())
+            maintenance_.join();
+        stop_retired();
+    }
+
+  private:
+    struct IdleServer
+    {
+        std::unique_ptr<Server> server;
+        size_t leases = 0;
+        Clock::time_point idle_since;
+        Clock::time_point checked;
+    };
+
+    struct Directory
+    {
+        std::vector<IdleServer> idle; // Least recently used first
+        size_t starting = 0;
+    };
+
+    std::string key(const std::string& directory) const
+    {
+        if (!directory.empty())
+            return directory;
+        return options_.server.working_directory.value_or(std::string());
+    }
+
+    /// Servers alive or on their way, excluding the ones being stopped
+    /// Caller must hold mutex_
+    size_t total() const
+    {
+        size_t total = leased_;
+        for (const auto& [dir, state] : directories_)
+            total += state.idle.size() + state.starting;
+        return total;
+    }
+
+    /// Make room by stopping the longest-idle server of another directory
+    /// Caller must hold mutex_
+    bool evict_idle_elsewhere(const std::string& dir)
+    {
+        Directory* oldest = nullptr;
+        for (auto& [other, state] : directories_)
+        {
+            if (other == dir || state.idle.empty())
+                continue;
+            if (!oldest || state.idle.front().idle_since < oldest->idle.front().idle_since)
+                oldest = &state;
+        }
+        if (!oldest)
+            return false;
+        retire(std::move(oldest->idle.front().server));
+        oldest->idle.erase(oldest->idle.begin());
+        return true;
+    }
+
+    /// Hand a server to the maintenance thread to stop; stopping can take seconds
+    /// Caller must hold mutex_
+    void retire(std::unique_ptr<Server> server)
+    {
+        retired_.push_back(std::move(server));
+        wake_ = true;
+    }
+
+    void stop_retired()
+    {
+        std::vector<std::unique_ptr<Server>> retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retired.swap(retired_);
+        }
+        for (auto& server : retired)
+            server->stop();
+    }
+
+    std::unique_ptr<Server> spawn(const std::string& dir)
+    {
+        auto opts = options_.server;
+        opts.port = 0; // OS assigns port
+        if (!dir.empty())
+            opts.working_directory = dir;
+        auto server = std::make_unique<Server>(Server::spawn(opts));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++spawned_;
+        return server;
+    }
+
+    bool healthy(Server& server) const
+    {
+        if (!server.running())
+            return false;
+        try
+        {
+            std::unique_ptr<HttpTransport> transport;
+            if (options_.server.password)
+            {
+                transport = std::make_unique<HttpTransport>(server.hostname(), server.port(),
+                                                            options_.server.username.value_or("opencode"),
+                                                            *options_.server.password);
+            }
+            else
+            {
+                transport = std::make_unique<HttpTransport>(server.hostname(), server.port());
+            }
+            transport->set_connection_timeout(2);
+            transport->set_read_timeout(2);
+
+            HttpRequest req;
+            req.method = "GET";
+            req.path = "/global/health";
+            return transport->request(req).status == 200;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    bool recycle_due(Server& server, size_t leases) const
+    {
+        if (options_.max_leases_per_server && leases >= options_.max_leases_per_server)
+            return true;
+        if (options_.max_rss_bytes)
+        {
+            auto rss = resident_bytes(server.pid());
+            return rss && *rss > *options_.max_rss_bytes;
+        }
+        return false;
+    }
+
+    /// Background thread: stop retired servers, check idle ones, keep the warm count
+    void maintain()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_)
+        {
+            cv_.wait_for(lock, options_.maintenance_interval, [this] { return stopping_ || wake_; });
+            if (stopping_)
+                break;
+            wake_ = false;
+            lock.unlock();
+
+            stop_retired();
+            check_idle();
+            trim_idle();
+            warm_up();
+
+            lock.lock();
+        }
+    }
+
+    /// Health-check idle servers not checked within the maintenance interval
+    void check_idle()
+    {
+        while (true)
+        {
+            std::string dir;
+            IdleServer candidate;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto due = Clock::now() - options_.maintenance_interval;
+                bool found = false;
+                for (auto& [other, state] : directories_)
+                {
+                    auto it = std::find_if(state.idle.begin(), state.idle.end(),
+                                           [&](const IdleServer& s) { return s.checked <= due; });
+                    if (it != state.idle.end())
+                    {
+                        dir = other;
+                        candidate = std::move(*it);
+                        state.idle.erase(it);
+                        ++state.starting; // Count it as on its way while it is out
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found || stopping_)
+                    return;
+            }
+
+            bool ok = healthy(*candidate.server);
+            bool recycle = ok && recycle_due(*candidate.server, candidate.leases);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto& state = directories_[dir];
+                --state.starting;
+                if (!ok || recycle || stopping_)
+                {
+                    if (!ok)
+                        ++health_failures_;
+                    else if (recycle)
+                        ++recycled_;
+                    retire(std::move(candidate.server));
+                }
+                else
+                {
+                    candidate.checked = Clock::now();
+                    // Keep least recently used first
+                    auto pos = std::find_if(state.idle.begin(), state.idle.end(), [&](const IdleServer& s)
+                                            { return s.idle_since > candidate.idle_since; });
+                    state.idle.insert(pos, std::move(candidate));
+                }
+            }
+            cv_.notify_all();
+        }
+    }
+
+    /// Stop servers beyond the warm count that have been idle for max_idle
+    void trim_idle()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto cutoff = Clock::now() - options_.max_idle;
+            for (auto& [dir, state] : directories_)
+            {
+                while (state.idle.size() > options_.warm_per_directory && state.idle.front().idle_since < cutoff)
+                {
+                    retire(std::move(state.idle.front().server));
+                    state.idle.erase(state.idle.begin());
+                }
+            }
+        }
+        stop_retired();
+    }
+
+    /// Spawn servers until every known directory has its warm count
+    void warm_up()
+    {
+        while (true)
+        {
+            std::string dir;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_ || total() >= options_.max_servers)
+                    return;
+                auto it = std::find_if(directories_.begin(), directories_.end(), [&](const auto& entry)
+                {
+                    return entry.second.idle.size() + entry.second.starting < options_.warm_per_directory;
+                });
+                if (it == directories_.end())
+                    return;
+                dir = it->first;
+                ++it->second.starting;
+            }
+
+            std::unique_ptr<Server> server;
+            try
+            {
+                server = spawn(dir);
+            }
+            catch (...)
+            {
+                // Leave it to the next pass; lease() reports spawn errors
+            }
+
+            bool started = server != nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto& state = directories_[dir];
+                --state.starting;
+                if (server && !stopping_)
+                    state.idle.push_back({std::move(server), 0, Clock::now(), Clock::now()});
+                else if (server)
+                    retire(std::move(server));
+            }
+            cv_.notify_all();
+            if (!started)
+                return;
+        }
+    }
+
+    ServerPoolOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, Directory> directories_; // Working directory -> servers
+    std::vector<std::unique_ptr<Server>> retired_; // Waiting to be stopped
+    size_t leased_ = 0;
+    uint64_t spawned_ = 0;
+    uint64_t recycled_ = 0;
+    uint64_t health_failures_ = 0;
+    bool stopping_ = false;
+    bool wake_ = false; // Work for the maintenance thread before its next interval
+
+    std::thread maintenance_;
+};
+
+// =============================================================================
+// ServerPool Public Interface
+// =============================================================================
+
+ServerPool::ServerPool(ServerPoolOptions options)
+    : impl_(std::make_shared<Impl>(std::move(options)))
+{
+}
+
+ServerPool::~ServerPool()
+{
+    if (impl_)
+        impl_->shutdown();
+}
+
+ServerPool::ServerPool(ServerPool&&) noexcept = default;
+
+ServerPool& ServerPool::operator=(ServerPool&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (impl_)
+            impl_->shutdown();
+        impl_ = std::move(other.impl_);
+    }
+    return *this;
+}
+
+void ServerPool::prewarm(const std::string& directory)
+{
+    impl_->prewarm(directory);
+}
+
+ServerLease ServerPool::lease(const std::string& directory)
+{
+    return impl_->lease(directory);
+}
+
+ServerPoolStats ServerPool::stats() const
+{
+    return impl_->stats();
+}
+
+void ServerPool::shutdown()
+{
+    impl_->shutdown();
+}
+
+// =============================================================================
+// ServerLease
+// =============================================================================
+
+ServerLease::ServerLease(std::weak_ptr<ServerPool::Impl> pool, std::string directory, std::unique_ptr<Server> server,
+                         size_t leases)
+    : pool_(std::move(pool)), directory_(std::move(directory)), server_(std::move(server)), leases_(leases)
+{
+}
+
+ServerLease::~ServerLease()
+{
+    release();
+}
+
+ServerLease::ServerLease(ServerLease&&) noexcept = default;
+
+ServerLease& ServerLease::operator=(ServerLease&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pool_ = std::move(other.pool_);
+        directory_ = std::move(other.directory_);
+        server_ = std::move(other.server_);
+        leases_ = other.leases_;
+    }
+    return *this;
+}
+
+ServerLease::operator bool() const
+{
+    return server_ != nullptr;
+}
+
+std::string ServerLease::url() const
+{
+    return server_ ? server_->url() : std::string();
+}
+
+Server& ServerLease::server()
+{
+    if (!server_)
+        throw std::runtime_error("Server lease is empty");
+    return *server_;
+}
+
+const std::string& ServerLease::directory() const
+{
+    return directory_;
+}
+
+void ServerLease::release()
+{
+    if (!server_)
+        return;
+    if (auto pool = pool_.lock())
+        pool->give_back(directory_, std::move(server_), leases_, false);
+    server_.reset(); // Pool is gone; Server's destructor stops it
+}
+
+void ServerLease::discard()
+{
+    if (!server_)
+        return;
+    if (auto pool = pool_.lock())
+        pool->give_back(directory_, std::move(server_), leases_, true);
+    server_.reset();
+}
+
+} // namespace opencode
@@ -63,9 +63,45 @@ void Session::send_streaming(
     );
 }
 
+MessageCache& Session::cache()
+{
+    if (!cache_)
+        cache_ = std::make_unique<MessageCache>(client_->message_cache(info_.id));
+    return *cache_;
+}
+
 std::vector<MessageWithParts> Session::messages(std::optional<int> limit)
 {
-    return client_->get_messages(info_.id, limit);
+    return cache().messages({.limit = limit});
+}
+
+std::vector<MessageWithParts> Session::messages_page(const MessagePage& page)
+{
+    return cache().messages(page);
+}
+
+std::future<MessageWithParts> Session::send_async(const std::string& prompt)
+{
+    const auto& opts = client_->options();
+    return client_->send_message_async(
+        info_.id,
+        prompt,
+        opts.default_provider.value_or(""),
+        opts.default_model.value_or("")
+    );
+}
+
+std::future<MessageWithParts> Session::send_async(
+    const std::string& prompt,
+    const std::string& provider_id,
+    const std::string& model_id)
+{
+    return client_->send_message_async(info_.id, prompt, provider_id, model_id);
+}
+
+std::future<std::vector<MessageWithParts>> Session::messages_async(std::optional<int> limit)
+{
+    return client_->get_messages_async(info_.id, limit);
 }
 
 bool Session::abort()
@@ -4,9 +4,36 @@
 #include <opencode/transport.hpp>
 
 #include <httplib.h>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <list>
 #include <mutex>
+#include <random>
 #include <thread>
+#include <unordered_map>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 namespace opencode
 {
@@ -15,327 +42,1934 @@ namespace opencode
 // SSEParser Implementation
 // =============================================================================
 
-void SSEParser::feed(const std::string& data, const std::function<void(const SSEEvent&)>& on_event)
+void SSEParser::feed(std::string_view data, const std::function<void(const SSEEvent&)>& on_event)
+{
+    feed_views(data, [this, &on_event](const SSEEventView& view)
+    {
+        // assign() reuses the strings' capacity from earlier events
+        scratch_.event.assign(view.event);
+        scratch_.data.assign(view.data);
+        scratch_.id.assign(view.id);
+        scratch_.retry = view.retry;
+        on_event(scratch_);
+    });
+}
+
+void SSEParser::feed_views(std::string_view data, const std::function<void(const SSEEventView&)>& on_event)
+{
+    if (data.empty())
+    {
+        return;
+    }
+
+    const char* cursor = data.data();
+    const char* end = cursor + data.size();
+
+    // Complete the partial line left over from the previous chunk
+    if (!partial_.empty())
+    {
+        auto* nl = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+        if (!nl)
+        {
+            partial_.append(cursor, end);
+            return;
+        }
+        partial_.append(cursor, nl);
+        process_line(partial_, on_event);
+        own_data(); // partial_ is about to be reused
+        partial_.clear();
+        cursor = nl + 1;
+    }
+
+    // Scan complete lines in place
+    while (cursor < end)
+    {
+        auto* nl = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+        if (!nl)
+        {
+            // No complete line, keep remainder for the next chunk
+            partial_.assign(cursor, end);
+            break;
+        }
+        process_line(std::string_view(cursor, static_cast<size_t>(nl - cursor)), on_event);
+        cursor = nl + 1;
+    }
+
+    // The chunk is gone after this call
+    own_data();
+}
+
+void SSEParser::process_line(std::string_view line, const std::function<void(const SSEEventView&)>& on_event)
+{
+    // SSE uses \n or \r\n
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+
+    // Empty line = event dispatch
+    if (line.empty())
+    {
+        dispatch(on_event);
+        return;
+    }
+
+    // Parse field
+    size_t colon = line.find(':');
+    std::string_view field;
+    std::string_view value;
+
+    if (colon == 0)
+    {
+        // Comment line (starts with :), ignore
+        return;
+    }
+    else if (colon != std::string_view::npos)
+    {
+        field = line.substr(0, colon);
+        // Skip space after colon if present
+        size_t value_start = colon + 1;
+        if (value_start < line.size() && line[value_start] == ' ')
+        {
+            value_start++;
+        }
+        value = line.substr(value_start);
+    }
+    else
+    {
+        field = line;
+    }
+
+    // Handle known fields
+    if (field == "event")
+    {
+        event_.assign(value);
+    }
+    else if (field == "data")
+    {
+        if (data_borrowed_ ? data_view_.empty() : data_.empty())
+        {
+            // Common case: one data line, borrowed without copying
+            data_view_ = value;
+            data_borrowed_ = true;
+        }
+        else
+        {
+            own_data();
+            data_ += '\n';
+            data_.append(value);
+        }
+    }
+    else if (field == "id")
+    {
+        id_.assign(value);
+        if (value.find('\0') == std::string_view::npos)
+        {
+            last_event_id_.assign(value);
+        }
+    }
+    else if (field == "retry")
+    {
+        int retry = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), retry);
+        if (ec == std::errc{})
+        {
+            retry_ = retry;
+            // Only ASCII digits set the reconnection time
+            if (retry >= 0 && ptr == value.data() + value.size())
+            {
+                reconnection_time_ = retry;
+            }
+        }
+        // Ignore invalid retry values
+    }
+}
+
+void SSEParser::dispatch(const std::function<void(const SSEEventView&)>& on_event)
+{
+    std::string_view data = data_borrowed_ ? data_view_ : std::string_view(data_);
+    if (data.empty() && event_.empty())
+    {
+        return; // Nothing to dispatch; other fields carry over
+    }
+
+    // Remove trailing newline from data if present
+    if (!data.empty() && data.back() == '\n')
+    {
+        data.remove_suffix(1);
+    }
+    on_event(SSEEventView{event_, data, id_, retry_});
+
+    event_.clear();
+    id_.clear();
+    data_.clear();
+    data_view_ = {};
+    data_borrowed_ = false;
+    retry_ = 0;
+}
+
+void SSEParser::own_data()
+{
+    if (data_borrowed_)
+    {
+        data_.assign(data_view_);
+        data_view_ = {};
+        data_borrowed_ = false;
+    }
+}
+
+void SSEParser::reset()
+{
+    partial_.clear();
+    event_.clear();
+    id_.clear();
+    data_.clear();
+    data_view_ = {};
+    data_borrowed_ = false;
+    retry_ = 0;
+    last_event_id_.clear();
+    reconnection_time_ = 0;
+}
+
+// =============================================================================
+// WebSocket Framing
+// =============================================================================
+
+namespace
+{
+
+/// SHA-1 digest (FIPS 180-4), as the WebSocket handshake needs it
+std::array<uint8_t, 20> sha1(std::string_view data)
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+
+    // Padding: 0x80, zeros, then the bit length, to a multiple of 64 bytes
+    std::string message(data);
+    uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56)
+        message.push_back('\0');
+    for (int shift = 56; shift >= 0; shift -= 8)
+        message.push_back(static_cast<char>((bits >> shift) & 0xFF));
+
+    for (size_t block = 0; block < message.size(); block += 64)
+    {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+        {
+            w[i] = 0;
+            for (int j = 0; j < 4; ++j)
+                w[i] = (w[i] << 8) | static_cast<uint8_t>(message[block + i * 4 + j]);
+        }
+        for (int i = 16; i < 80; ++i)
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t next = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = next;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest{};
+    for (int i = 0; i < 20; ++i)
+        digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+    return digest;
+}
+
+std::string base64(std::string_view data)
+{
+    static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        uint32_t n = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < data.size())
+            n |= static_cast<uint8_t>(data[i + 1]) << 8;
+        if (i + 2 < data.size())
+            n |= static_cast<uint8_t>(data[i + 2]);
+        out.push_back(alphabet[(n >> 18) & 0x3F]);
+        out.push_back(alphabet[(n >> 12) & 0x3F]);
+        out.push_back(i + 1 < data.size() ? alphabet[(n >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < data.size() ? alphabet[n & 0x3F] : '=');
+    }
+    return out;
+}
+
+bool known_opcode(uint8_t opcode)
+{
+    return opcode <= 0x2 || (opcode >= 0x8 && opcode <= 0xA);
+}
+
+} // namespace
+
+void WebSocketParser::feed(std::string_view data, const FrameCallback& on_frame)
+{
+    // Whole frames are parsed straight from the chunk; only a trailing
+    // partial frame is copied
+    std::string_view input = data;
+    if (!partial_.empty())
+    {
+        partial_.append(data);
+        input = partial_;
+    }
+
+    size_t consumed = 0;
+    while (consumed < input.size())
+    {
+        size_t used = parse_frame(input.substr(consumed), on_frame);
+        if (used == 0)
+            break;
+        consumed += used;
+    }
+
+    if (input.data() == partial_.data())
+        partial_.erase(0, consumed);
+    else
+        partial_.assign(input.substr(consumed));
+}
+
+size_t WebSocketParser::parse_frame(std::string_view data, const FrameCallback& on_frame)
+{
+    if (data.size() < 2)
+        return 0;
+    auto byte = [&data](size_t i) { return static_cast<uint8_t>(data[i]); };
+
+    bool fin = (byte(0) & 0x80) != 0;
+    uint8_t code = byte(0) & 0x0F;
+    if (byte(0) & 0x70)
+        throw std::runtime_error("WebSocket frame uses reserved bits");
+    if (!known_opcode(code))
+        throw std::runtime_error("WebSocket frame has unknown opcode " + std::to_string(code));
+
+    uint64_t length = byte(1) & 0x7F;
+    size_t header = 2;
+    if (length == 126)
+    {
+        if (data.size() < 4)
+            return 0;
+        length = (static_cast<uint64_t>(byte(2)) << 8) | byte(3);
+        header = 4;
+    }
+    else if (length == 127)
+    {
+        if (data.size() < 10)
+            return 0;
+        length = 0;
+        for (size_t i = 2; i < 10; ++i)
+            length = (length << 8) | byte(i);
+        if (length >> 63)
+            throw std::runtime_error("WebSocket frame length is invalid");
+        header = 10;
+    }
+    bool masked = (byte(1) & 0x80) != 0; // Servers do not mask, but unmasking is cheap
+    if (masked)
+        header += 4;
+    if (data.size() < header || length > data.size() - header)
+        return 0;
+
+    std::string_view payload = data.substr(header, static_cast<size_t>(length));
+    std::string unmasked;
+    if (masked)
+    {
+        unmasked.assign(payload);
+        for (size_t i = 0; i < unmasked.size(); ++i)
+            unmasked[i] = static_cast<char>(unmasked[i] ^ data[header - 4 + i % 4]);
+        payload = unmasked;
+    }
+
+    auto opcode = static_cast<WebSocketOpcode>(code);
+    if (code & 0x8)
+    {
+        if (!fin || length > 125)
+            throw std::runtime_error("WebSocket control frame is fragmented or too long");
+        on_frame(opcode, payload);
+    }
+    else if (opcode == WebSocketOpcode::Continuation)
+    {
+        if (message_opcode_ == WebSocketOpcode::Continuation)
+            throw std::runtime_error("WebSocket continuation frame without a message");
+        message_.append(payload);
+        if (fin)
+        {
+            auto whole = message_opcode_;
+            message_opcode_ = WebSocketOpcode::Continuation;
+            on_frame(whole, message_);
+            message_.clear();
+        }
+    }
+    else
+    {
+        if (message_opcode_ != WebSocketOpcode::Continuation)
+            throw std::runtime_error("WebSocket message started before the previous one ended");
+        if (fin)
+        {
+            on_frame(opcode, payload);
+        }
+        else
+        {
+            message_opcode_ = opcode;
+            message_.assign(payload);
+        }
+    }
+    return header + static_cast<size_t>(length);
+}
+
+void WebSocketParser::reset()
+{
+    partial_.clear();
+    message_.clear();
+    message_opcode_ = WebSocketOpcode::Continuation;
+}
+
+std::string websocket_frame(WebSocketOpcode opcode, std::string_view payload, uint32_t mask)
+{
+    std::string frame;
+    frame.reserve(payload.size() + 14);
+    frame.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(opcode)));
+
+    size_t size = payload.size();
+    if (size < 126)
+    {
+        frame.push_back(static_cast<char>(0x80 | size));
+    }
+    else if (size <= 0xFFFF)
+    {
+        frame.push_back(static_cast<char>(0x80 | 126));
+        frame.push_back(static_cast<char>((size >> 8) & 0xFF));
+        frame.push_back(static_cast<char>(size & 0xFF));
+    }
+    else
+    {
+        frame.push_back(static_cast<char>(0x80 | 127));
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(size) >> shift) & 0xFF));
+    }
+
+    char key[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        key[i] = static_cast<char>((mask >> (24 - i * 8)) & 0xFF);
+        frame.push_back(key[i]);
+    }
+    for (size_t i = 0; i < size; ++i)
+        frame.push_back(static_cast<char>(payload[i] ^ key[i % 4]));
+    return frame;
+}
+
+std::string websocket_accept(std::string_view key)
+{
+    std::string input(key);
+    input += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"; // RFC 6455, section 1.3
+    auto digest = sha1(input);
+    return base64(std::string_view(reinterpret_cast<const char*>(digest.data()), digest.size()));
+}
+
+// =============================================================================
+// Sockets
+// =============================================================================
+
+namespace
+{
+
+// httplib 0.15 cannot upgrade a connection, so WebSocket runs on its own socket
+
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL; // A dropped peer is an error, not SIGPIPE
+#else
+constexpr int send_flags = 0;
+#endif
+
+void close_socket(socket_t sock)
+{
+#ifdef _WIN32
+    ::closesocket(sock);
+#else
+    ::close(sock);
+#endif
+}
+
+/// Make a blocked read or write on sock return, from any thread
+void shutdown_socket(socket_t sock)
+{
+#ifdef _WIN32
+    ::shutdown(sock, SD_BOTH);
+#else
+    ::shutdown(sock, SHUT_RDWR);
+#endif
+}
+
+void set_nonblocking(socket_t sock, bool nonblocking)
+{
+#ifdef _WIN32
+    u_long mode = nonblocking ? 1 : 0;
+    ::ioctlsocket(sock, FIONBIO, &mode);
+#else
+    int flags = ::fcntl(sock, F_GETFL, 0);
+    ::fcntl(sock, F_SETFL, nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+}
+
+/// Wait until sock is readable (or writable)
+/// @return false if the timeout passed first
+bool wait_socket(socket_t sock, bool write, std::chrono::milliseconds timeout)
+{
+    pollfd entry{};
+    entry.fd = sock;
+    entry.events = write ? POLLOUT : POLLIN;
+    auto ms = static_cast<int>(std::min<int64_t>(timeout.count(), std::numeric_limits<int>::max()));
+#ifdef _WIN32
+    return ::WSAPoll(&entry, 1, ms) > 0;
+#else
+    int ready;
+    do
+    {
+        ready = ::poll(&entry, 1, ms);
+    } while (ready < 0 && errno == EINTR);
+    return ready > 0;
+#endif
+}
+
+/// Open a TCP connection, trying each address host resolves to
+/// @return INVALID_SOCKET with error set if none could be reached in time
+socket_t connect_socket(const std::string& host, int port, std::chrono::milliseconds timeout, std::string& error)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0)
+    {
+        error = "Cannot resolve " + host;
+        return INVALID_SOCKET;
+    }
+
+    socket_t connected = INVALID_SOCKET;
+    error = "Cannot connect to " + host + ":" + std::to_string(port);
+    for (auto* address = found; address && connected == INVALID_SOCKET; address = address->ai_next)
+    {
+        socket_t sock = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (sock == INVALID_SOCKET)
+            continue;
+
+        // Connect without blocking so the attempt can time out
+        set_nonblocking(sock, true);
+        int rc = ::connect(sock, address->ai_addr, static_cast<int>(address->ai_addrlen));
+#ifdef _WIN32
+        bool pending = rc != 0 && ::WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        bool pending = rc != 0 && errno == EINPROGRESS;
+#endif
+        if (pending && wait_socket(sock, true, timeout))
+        {
+            int failure = 0;
+            socklen_t size = sizeof(failure);
+            ::getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&failure), &size);
+            rc = failure;
+        }
+        if (rc != 0)
+        {
+            close_socket(sock);
+            continue;
+        }
+
+        set_nonblocking(sock, false);
+        int on = 1; // Keystrokes go out as they are typed
+        ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+#ifdef SO_NOSIGPIPE
+        ::setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        connected = sock;
+    }
+    ::freeaddrinfo(found);
+    return connected;
+}
+
+bool send_all(socket_t sock, std::string_view data)
+{
+    while (!data.empty())
+    {
+        auto sent = ::send(sock, data.data(), static_cast<int>(std::min<size_t>(data.size(), INT_MAX)), send_flags);
+        if (sent <= 0)
+            return false;
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+/// Value of a header in a raw HTTP response head (name matched case-insensitively)
+std::string_view head_value(std::string_view head, std::string_view name)
+{
+    size_t line = head.find("\r\n");
+    while (line != std::string_view::npos && line + 2 < head.size())
+    {
+        size_t start = line + 2;
+        line = head.find("\r\n", start);
+        auto field = head.substr(start, line == std::string_view::npos ? std::string_view::npos : line - start);
+        size_t colon = field.find(':');
+        if (colon == std::string_view::npos || colon != name.size() ||
+            !std::equal(name.begin(), name.end(), field.begin(), [](char a, char b)
+            {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            }))
+        {
+            continue;
+        }
+        auto value = field.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+            value.remove_suffix(1);
+        return value;
+    }
+    return {};
+}
+
+} // namespace
+
+// =============================================================================
+// Response Validator Cache
+// =============================================================================
+
+namespace
+{
+
+/// Content codings offered in Accept-Encoding, as far as httplib can decode them
+constexpr const char* accepted_encodings()
+{
+#if defined(CPPHTTPLIB_BROTLI_SUPPORT) && defined(CPPHTTPLIB_ZLIB_SUPPORT)
+    return "br, gzip, deflate";
+#elif defined(CPPHTTPLIB_BROTLI_SUPPORT)
+    return "br";
+#elif defined(CPPHTTPLIB_ZLIB_SUPPORT)
+    return "gzip, deflate";
+#else
+    return nullptr;
+#endif
+}
+
+bool has_header(const std::vector<std::pair<std::string, std::string>>& headers, std::string_view name)
+{
+    return std::any_of(headers.begin(), headers.end(), [&](const auto& header)
+    {
+        return header.first.size() == name.size() &&
+               std::equal(name.begin(), name.end(), header.first.begin(),
+                          [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) ==
+                                                      std::tolower(static_cast<unsigned char>(b)); });
+    });
+}
+
+/// GET responses that carry an ETag or Last-Modified, kept for revalidation
+///
+/// Entries are immutable and shared, so a request can hold on to the one it
+/// revalidates even if it is evicted before the 304 arrives. Least recently
+/// used entries are evicted once the stored bodies exceed the byte budget.
+class ValidatorCache
 {
-    buffer_ += data;
+  public:
+    struct Entry
+    {
+        std::string etag;
+        std::string last_modified;
+        std::string body;
+        std::vector<std::pair<std::string, std::string>> headers;
+    };
+
+    std::shared_ptr<const Entry> find(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(path);
+        if (it == index_.end())
+        {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    void store(const std::string& path, std::shared_ptr<const Entry> entry)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(path);
+        if (entry->body.size() > max_bytes_ / 4)
+        {
+            return; // A single body shouldn't flush everything else
+        }
+        bytes_ += entry->body.size();
+        lru_.emplace_front(path, std::move(entry));
+        index_[path] = lru_.begin();
+        evict_locked();
+    }
+
+    void erase(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(path);
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        index_.clear();
+        bytes_ = 0;
+    }
+
+    void set_max_bytes(size_t max_bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_bytes_ = max_bytes;
+        evict_locked();
+    }
+
+    bool enabled() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_bytes_ > 0;
+    }
 
-    // Process complete lines
-    size_t pos = 0;
-    while (true)
+  private:
+    using Lru = std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+    void erase_locked(const std::string& path)
+    {
+        auto it = index_.find(path);
+        if (it == index_.end())
+        {
+            return;
+        }
+        bytes_ -= it->second->second->body.size();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    void evict_locked()
+    {
+        while (bytes_ > max_bytes_ && !lru_.empty())
+        {
+            bytes_ -= lru_.back().second->body.size();
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+    mutable std::mutex mutex_;
+    Lru lru_; // Most recently used first
+    std::unordered_map<std::string, Lru::iterator> index_;
+    size_t bytes_ = 0;
+    size_t max_bytes_ = 4 * 1024 * 1024;
+};
+
+/// Why a request's cancel token or deadline ends it, or nullptr if neither does
+const char* call_ended(const HttpRequest& req)
+{
+    if (req.cancel.stop_requested())
+    {
+        return "Canceled";
+    }
+    if (req.deadline && std::chrono::steady_clock::now() >= *req.deadline)
+    {
+        return "Deadline exceeded";
+    }
+    return nullptr;
+}
+
+bool bounded(const HttpRequest& req)
+{
+    return req.cancel.stop_possible() || req.deadline.has_value();
+}
+
+} // namespace
+
+// =============================================================================
+// HttpTransport Implementation
+// =============================================================================
+
+class HttpTransport::Impl
+{
+  public:
+    Impl(const std::string& host, int port)
+        : host_(host), port_(port)
+    {
+    }
+
+    Impl(const std::string& host, int port, const std::string& username, const std::string& password)
+        : host_(host), port_(port), basic_auth_(std::make_pair(username, password))
+    {
+    }
+
+    ~Impl()
+    {
+        stop_sse();
+        stop_websocket();
+    }
+
+    /// Headers sent with every request() / request_stream() call
+    httplib::Headers headers_for(const HttpRequest& req) const
+    {
+        httplib::Headers headers;
+        for (const auto& [key, value] : req.headers)
+        {
+            headers.insert({key, value});
+        }
+
+        // Add directory header if set
+        if (!directory_.empty())
+        {
+            headers.insert({"x-opencode-directory", directory_});
+        }
+
+        // Always request JSON responses
+        headers.insert({"Accept", "application/json"});
+
+        // httplib decodes whatever it offers here
+        if (!compression_)
+        {
+            headers.insert({"Accept-Encoding", "identity"});
+        }
+        else if (constexpr auto encodings = accepted_encodings())
+        {
+            headers.insert({"Accept-Encoding", encodings});
+        }
+        return headers;
+    }
+
+    HttpResponse request(const HttpRequest& req)
+    {
+        HttpResponse response;
+        auto begin = Clock::now();
+        auto metrics = start_metrics(req);
+
+        httplib::Request http_req;
+        http_req.method = req.method;
+        http_req.path = req.path;
+        http_req.headers = headers_for(req);
+
+        // Revalidate a stored response instead of transferring it again,
+        // unless the caller manages validators itself
+        std::shared_ptr<const ValidatorCache::Entry> cached;
+        bool cacheable = req.method == "GET" && validators_.enabled() &&
+                         !has_header(req.headers, "If-None-Match") && !has_header(req.headers, "If-Modified-Since");
+        if (cacheable && (cached = validators_.find(req.path)))
+        {
+            if (!cached->etag.empty())
+            {
+                http_req.headers.insert({"If-None-Match", cached->etag});
+            }
+            if (!cached->last_modified.empty())
+            {
+                http_req.headers.insert({"If-Modified-Since", cached->last_modified});
+            }
+        }
+
+        if (!supported(req.method))
+        {
+            response.error = "Unsupported HTTP method: " + req.method;
+            return response;
+        }
+        if (req.method != "GET" && req.method != "DELETE")
+        {
+            http_req.headers.insert({"Content-Type", req.content_type.value_or("application/json")});
+            http_req.body = req.body;
+        }
+        if (metrics || bounded(req))
+        {
+            http_req.response_handler = [&](const httplib::Response&)
+            {
+                if (metrics)
+                {
+                    metrics->time_to_first_byte = Clock::now() - begin;
+                }
+                return !call_ended(req);
+            };
+        }
+        if (bounded(req))
+        {
+            http_req.progress = [&](uint64_t, uint64_t) { return !call_ended(req); };
+        }
+
+        // Each request gets exclusive use of one pooled keep-alive connection
+        auto client = acquire(req, metrics ? &*metrics : nullptr, begin);
+        if (!client)
+        {
+            response.error = call_ended(req);
+            return response;
+        }
+        auto result = send(*client, req, http_req);
+
+        if (result && cached && result->status == 304)
+        {
+            // Not modified - answer with the stored response
+            response.status = 200;
+            response.body = cached->body;
+            response.headers = cached->headers;
+            if (metrics)
+            {
+                metrics->revalidated = true;
+            }
+        }
+        else if (result)
+        {
+            response.status = result->status;
+            response.body = std::move(result->body);
+            for (const auto& [key, value] : result->headers)
+            {
+                response.headers.push_back({key, value});
+            }
+            if (cacheable)
+            {
+                remember(req.path, *result, response);
+            }
+        }
+        else
+        {
+            auto ended = call_ended(req);
+            response.error = ended ? ended : httplib::to_string(result.error());
+        }
+
+        // Don't hand a connection in an unknown state to the next caller
+        client.release(static_cast<bool>(result));
+
+        if (metrics)
+        {
+            // A revalidated response reports the 304 and no body on the wire
+            metrics->status = result ? result->status : 0;
+            metrics->bytes_received = metrics->revalidated ? 0 : response.body.size();
+            finish_metrics(*metrics, begin);
+        }
+        return response;
+    }
+
+    HttpResponse request_stream(const HttpRequest& req, const ContentCallback& on_data)
+    {
+        HttpResponse response;
+        if (!supported(req.method))
+        {
+            response.error = "Unsupported HTTP method: " + req.method;
+            return response;
+        }
+
+        auto begin = Clock::now();
+        auto metrics = start_metrics(req);
+        bool stopped = false;          // on_data asked to stop
+        std::exception_ptr failure;    // Thrown by on_data, rethrown once the connection is back
+        size_t received = 0;
+
+        httplib::Request http_req;
+        http_req.method = req.method;
+        http_req.path = req.path;
+        http_req.headers = headers_for(req);
+        if (req.method != "GET" && req.method != "DELETE")
+        {
+            http_req.headers.insert({"Content-Type", req.content_type.value_or("application/json")});
+            http_req.body = req.body;
+        }
+        http_req.response_handler = [&](const httplib::Response& head)
+        {
+            if (metrics)
+            {
+                metrics->time_to_first_byte = Clock::now() - begin;
+            }
+            response.status = head.status;
+            for (const auto& [key, value] : head.headers)
+            {
+                response.headers.push_back({key, value});
+            }
+            return true;
+        };
+        http_req.content_receiver = [&](const char* data, size_t data_length, uint64_t, uint64_t)
+        {
+            received += data_length;
+            if (response.status < 200 || response.status >= 300)
+            {
+                response.body.append(data, data_length);
+                return true;
+            }
+            if (call_ended(req))
+            {
+                return false;
+            }
+            try
+            {
+                stopped = !on_data(std::string_view(data, data_length));
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+                stopped = true;
+            }
+            return !stopped;
+        };
+
+        auto client = acquire(req, metrics ? &*metrics : nullptr, begin);
+        if (!client)
+        {
+            response.error = call_ended(req);
+            return response;
+        }
+        auto result = send(*client, req, http_req);
+
+        if (!result && !stopped)
+        {
+            auto ended = call_ended(req);
+            response.error = ended ? ended : httplib::to_string(result.error());
+            response.status = ended ? 0 : response.status;
+        }
+
+        // A transfer cut short leaves unread data on the socket
+        client.release(static_cast<bool>(result) && !stopped);
+
+        if (metrics)
+        {
+            metrics->status = response.status;
+            metrics->bytes_received = received;
+            finish_metrics(*metrics, begin);
+        }
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+        return response;
+    }
+
+    bool start_sse(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        SSEEventCallback on_event,
+        SSEErrorCallback on_error,
+        SSECloseCallback on_close
+    )
+    {
+        stop_sse();
+
+        sse_running_ = true;
+        sse_thread_ = std::thread([this, path, headers, on_event, on_error, on_close, reconnect = sse_reconnect_]()
+        {
+            run_sse(path, headers, reconnect, on_event, on_error, on_close);
+        });
+
+        return true;
+    }
+
+    void stop_sse()
+    {
+        sse_running_ = false;
+        {
+            // Shut down the socket so a read blocked on a quiet stream returns,
+            // and wake a reconnect backoff
+            std::lock_guard<std::mutex> lock(sse_client_mutex_);
+            if (sse_client_)
+            {
+                sse_client_->stop();
+            }
+            sse_cv_.notify_all();
+        }
+        if (sse_thread_.joinable())
+        {
+            sse_thread_.join();
+        }
+    }
+
+    bool sse_connected() const
+    {
+        return sse_connected_;
+    }
+
+    bool start_websocket(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        WebSocketMessageCallback on_message,
+        SSEErrorCallback on_error,
+        SSECloseCallback on_close
+    )
+    {
+        stop_websocket();
+
+        ws_running_ = true;
+        ws_thread_ = std::thread([this, path, headers, on_message, on_error, on_close, reconnect = sse_reconnect_]()
+        {
+            run_websocket(path, headers, reconnect, on_message, on_error, on_close);
+        });
+        return true;
+    }
+
+    bool websocket_send(std::string_view text)
+    {
+        std::lock_guard<std::mutex> lock(ws_send_mutex_);
+        if (!ws_connected_)
+        {
+            return false;
+        }
+        // A frame cut short is never delivered; dropping the connection
+        // makes the reader reconnect
+        if (!send_all(ws_socket_, websocket_frame(WebSocketOpcode::Text, text, ws_mask_())))
+        {
+            ws_connected_ = false;
+            shutdown_socket(ws_socket_);
+            return false;
+        }
+        return true;
+    }
+
+    void stop_websocket()
+    {
+        ws_running_ = false;
+        {
+            std::lock_guard<std::mutex> lock(ws_mutex_);
+            if (ws_socket_ != INVALID_SOCKET)
+            {
+                shutdown_socket(ws_socket_);
+            }
+            ws_cv_.notify_all();
+        }
+        if (ws_thread_.joinable())
+        {
+            ws_thread_.join();
+        }
+    }
+
+    void set_sse_reconnect(const SSEReconnectOptions& options)
+    {
+        sse_reconnect_ = options;
+    }
+
+    void set_directory(const std::string& directory)
+    {
+        directory_ = directory;
+        validators_.clear(); // Stored responses belong to the old directory
+    }
+
+    void set_compression(bool enabled)
+    {
+        compression_ = enabled;
+    }
+
+    void set_observer(std::shared_ptr<TransportObserver> observer)
+    {
+        std::lock_guard<std::mutex> lock(observer_mutex_);
+        observer_ = std::move(observer);
+    }
+
+    /// The current observer; requests in flight keep the one they started with
+    std::shared_ptr<TransportObserver> observer() const
+    {
+        std::lock_guard<std::mutex> lock(observer_mutex_);
+        return observer_;
+    }
+
+    void set_response_cache(size_t max_bytes)
+    {
+        validators_.set_max_bytes(max_bytes);
+    }
+
+    void set_connection_timeout(int seconds)
+    {
+        connection_timeout_ = seconds;
+    }
+
+    void set_read_timeout(int seconds)
+    {
+        read_timeout_ = seconds;
+    }
+
+    void set_max_connections(size_t max_connections)
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        max_connections_ = std::max<size_t>(max_connections, 1);
+        pool_cv_.notify_all();
+    }
+
+    void set_idle_timeout(int seconds)
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        idle_timeout_ = std::chrono::seconds(seconds);
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static bool supported(const std::string& method)
+    {
+        return method == "GET" || method == "POST" || method == "PUT" || method == "PATCH" || method == "DELETE";
+    }
+
+    /// Store a 200 response that can be revalidated, or forget a stale one
+    void remember(const std::string& path, const httplib::Response& result, const HttpResponse& response)
+    {
+        auto etag = result.get_header_value("ETag");
+        auto last_modified = result.get_header_value("Last-Modified");
+        bool no_store = result.get_header_value("Cache-Control").find("no-store") != std::string::npos;
+        if (response.status != 200 || no_store || (etag.empty() && last_modified.empty()))
+        {
+            validators_.erase(path);
+            return;
+        }
+
+        auto entry = std::make_shared<ValidatorCache::Entry>();
+        entry->etag = std::move(etag);
+        entry->last_modified = std::move(last_modified);
+        entry->body = response.body;
+        entry->headers = response.headers;
+        validators_.store(path, std::move(entry));
+    }
+
+    struct IdleConnection
+    {
+        std::unique_ptr<httplib::Client> client;
+        Clock::time_point last_used;
+    };
+
+    /// A pooled connection slot on loan to one request
+    /// The slot goes back in the destructor if release() wasn't called, with
+    /// the connection dropped: whatever threw may have left it mid-exchange.
+    class Lease
+    {
+      public:
+        Lease() = default;
+
+        Lease(Impl& pool, std::unique_ptr<httplib::Client> client)
+            : pool_(&pool), client_(std::move(client))
+        {
+        }
+
+        ~Lease()
+        {
+            release(false);
+        }
+
+        Lease(Lease&& other) noexcept
+            : pool_(std::exchange(other.pool_, nullptr)), client_(std::move(other.client_))
+        {
+        }
+
+        Lease& operator=(Lease&&) = delete;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        /// False if no slot was granted
+        explicit operator bool() const
+        {
+            return pool_ != nullptr;
+        }
+
+        httplib::Client& operator*() const
+        {
+            return *client_;
+        }
+
+        httplib::Client* operator->() const
+        {
+            return client_.get();
+        }
+
+        /// Hand the slot back, keeping the connection for reuse if reusable
+        void release(bool reusable)
+        {
+            if (auto* pool = std::exchange(pool_, nullptr))
+            {
+                pool->release(std::move(client_), reusable);
+            }
+        }
+
+      private:
+        friend class Impl;
+
+        Impl* pool_ = nullptr;
+        std::unique_ptr<httplib::Client> client_; // Null until acquire() connects it
+    };
+
+    /// Metrics for req if an observer is set, else nullopt
+    std::optional<RequestMetrics> start_metrics(const HttpRequest& req) const
+    {
+        if (!observer())
+        {
+            return std::nullopt;
+        }
+        RequestMetrics metrics;
+        metrics.method = req.method;
+        metrics.path = req.path;
+        metrics.bytes_sent = req.body.size();
+        metrics.start = std::chrono::system_clock::now();
+        return metrics;
+    }
+
+    void finish_metrics(RequestMetrics& metrics, Clock::time_point begin) const
+    {
+        metrics.total = Clock::now() - begin;
+        if (auto current = observer())
+        {
+            current->on_request(metrics);
+        }
+    }
+
+    /// Send on a connection, shutting its socket down if req is canceled meanwhile
+    static httplib::Result send(httplib::Client& client, const HttpRequest& req, const httplib::Request& http_req)
+    {
+        // stop() is the one thread-safe way into a busy httplib client; the
+        // blocked read fails at once and the connection is dropped on release
+        std::stop_callback abort(req.cancel, [&client] { client.stop(); });
+        if (req.cancel.stop_requested())
+        {
+            return httplib::Result(nullptr, httplib::Error::Canceled);
+        }
+
+        // A stop() that lands before httplib marks the request in flight only
+        // closes the idle socket, and send() then opens a new one. Catch that
+        // one as it is created, under the same lock stop() takes.
+        if (req.cancel.stop_possible())
+        {
+            client.set_socket_options([&req](socket_t sock)
+            {
+                if (req.cancel.stop_requested())
+                {
+#ifdef _WIN32
+                    ::shutdown(sock, SD_BOTH);
+#else
+                    ::shutdown(sock, SHUT_RDWR);
+#endif
+                }
+            });
+        }
+        auto result = client.send(http_req);
+        if (req.cancel.stop_possible())
+        {
+            client.set_socket_options(nullptr);
+        }
+        return result;
+    }
+
+    /// Take an idle connection, open a new one, or wait until one is released
+    /// Records the wait and whether the connection was reused in metrics, if given.
+    /// @return An empty lease if req was canceled or ran out of time while waiting
+    Lease acquire(const HttpRequest& req, RequestMetrics* metrics, Clock::time_point begin)
+    {
+        if (call_ended(req))
+        {
+            return {};
+        }
+
+        // Registered before the lock: an already canceled token runs it at once
+        std::stop_callback wake(req.cancel, [this]
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            pool_cv_.notify_all();
+        });
+
+        std::unique_ptr<httplib::Client> client;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex_);
+            evict_idle(Clock::now());
+            auto available = [this] { return !idle_.empty() || open_ < max_connections_; };
+            auto ready = [&] { return available() || req.cancel.stop_requested(); };
+            if (req.deadline)
+            {
+                pool_cv_.wait_until(lock, *req.deadline, ready);
+            }
+            else
+            {
+                pool_cv_.wait(lock, ready);
+            }
+            if (!available() || call_ended(req))
+            {
+                // Pass on a release this waiter may have consumed
+                pool_cv_.notify_one();
+                return {};
+            }
+            if (metrics)
+            {
+                metrics->connection_wait = Clock::now() - begin;
+                metrics->reused_connection = !idle_.empty();
+            }
+
+            if (!idle_.empty())
+            {
+                // Most recently used first - its socket is the most likely to be alive
+                client = std::move(idle_.back().client);
+                idle_.pop_back();
+            }
+            else
+            {
+                ++open_;
+            }
+        }
+
+        // From here on the slot is the lease's to give back
+        Lease lease(*this, std::move(client));
+        if (!lease.client_)
+        {
+            lease.client_ = std::make_unique<httplib::Client>(host_, port_);
+            lease->set_keep_alive(true);
+            if (basic_auth_)
+            {
+                lease->set_basic_auth(basic_auth_->first, basic_auth_->second);
+            }
+        }
+
+        // Timeouts may have changed since the connection was pooled; a
+        // deadline shortens them so no single connect or read outlasts it
+        auto connection_timeout = std::chrono::microseconds(std::chrono::seconds(connection_timeout_.load()));
+        auto read_timeout = std::chrono::microseconds(std::chrono::seconds(read_timeout_.load()));
+        if (req.deadline)
+        {
+            auto left = std::chrono::ceil<std::chrono::microseconds>(*req.deadline - Clock::now());
+            left = std::max(left, std::chrono::microseconds(1));
+            connection_timeout = std::min(connection_timeout, left);
+            read_timeout = std::min(read_timeout, left);
+        }
+        auto [connect_sec, connect_usec] = split(connection_timeout);
+        auto [read_sec, read_usec] = split(read_timeout);
+        lease->set_connection_timeout(connect_sec, connect_usec);
+        lease->set_read_timeout(read_sec, read_usec);
+        return lease;
+    }
+
+    /// Seconds and microseconds, as httplib takes timeouts
+    static std::pair<time_t, time_t> split(std::chrono::microseconds timeout)
+    {
+        auto seconds = std::chrono::floor<std::chrono::seconds>(timeout);
+        return {static_cast<time_t>(seconds.count()), static_cast<time_t>((timeout - seconds).count())};
+    }
+
+    /// Return a connection to the pool, or drop it if it can't be reused
+    /// Takes the slot back even when client is null. Called through Lease.
+    void release(std::unique_ptr<httplib::Client> client, bool reusable)
+    {
+        std::unique_ptr<httplib::Client> dropped;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            auto now = Clock::now();
+            if (reusable && client && open_ <= max_connections_)
+            {
+                idle_.push_back({std::move(client), now});
+            }
+            else
+            {
+                dropped = std::move(client);
+                --open_;
+            }
+            evict_idle(now);
+            pool_cv_.notify_one();
+        }
+        // dropped closes its socket here, outside the lock
+    }
+
+    /// Close connections that have been idle longer than idle_timeout_
+    /// Caller must hold pool_mutex_
+    void evict_idle(Clock::time_point now)
+    {
+        // idle_ is ordered by last use, oldest first
+        auto stale = std::find_if(idle_.begin(), idle_.end(), [&](const IdleConnection& c)
+        {
+            return now - c.last_used < idle_timeout_;
+        });
+        open_ -= static_cast<size_t>(stale - idle_.begin());
+        idle_.erase(idle_.begin(), stale);
+    }
+
+    /// Delay before reconnection attempt number `failures` (1-based)
+    static std::chrono::milliseconds reconnect_delay(const SSEReconnectOptions& reconnect, int server_retry,
+                                                     size_t failures, std::minstd_rand& random)
+    {
+        double base = server_retry > 0 ? server_retry : static_cast<double>(reconnect.initial_delay.count());
+        double delay = base * std::pow(reconnect.multiplier, static_cast<double>(failures - 1));
+        delay = std::min(delay, static_cast<double>(reconnect.max_delay.count()));
+        double jitter = std::clamp(reconnect.jitter, 0.0, 1.0);
+        delay -= std::uniform_real_distribution<double>(0.0, delay * jitter)(random);
+        return std::chrono::milliseconds(static_cast<int64_t>(delay));
+    }
+
+    void run_sse(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        const SSEReconnectOptions& reconnect,
+        SSEEventCallback on_event,
+        SSEErrorCallback on_error,
+        SSECloseCallback on_close
+    )
     {
-        // Find next line break (SSE uses \n or \r\n)
-        size_t line_end = buffer_.find('\n', pos);
-        if (line_end == std::string::npos)
+        // Build headers
+        httplib::Headers base_headers;
+        base_headers.insert({"Accept", "text/event-stream"});
+        base_headers.insert({"Cache-Control", "no-cache"});
+        base_headers.insert({"Connection", "keep-alive"});
+        for (const auto& [key, value] : headers)
         {
-            // No complete line, keep remainder in buffer
-            buffer_ = buffer_.substr(pos);
-            break;
+            base_headers.insert({key, value});
+        }
+        if (!directory_.empty())
+        {
+            base_headers.insert({"x-opencode-directory", directory_});
         }
 
-        // Extract line (removing \r if present)
-        std::string line = buffer_.substr(pos, line_end - pos);
-        if (!line.empty() && line.back() == '\r')
+        std::string last_event_id;
+        int server_retry = 0;
+        size_t failures = 0; // Consecutive connections that delivered nothing
+        bool connected_before = false;
+        std::minstd_rand random(std::random_device{}());
+
+        // Events pass through here on their way to on_event when observed
+        auto observer = this->observer();
+        SSEEventCallback deliver = on_event;
+        if (observer)
         {
-            line.pop_back();
+            deliver = [&](const SSEEvent& event)
+            {
+                observer->on_sse_event(path, event.data.size());
+                on_event(event);
+            };
         }
-        pos = line_end + 1;
 
-        // Empty line = event dispatch
-        if (line.empty())
+        for (;;)
         {
-            if (!current_event_.data.empty() || !current_event_.event.empty())
+            // Create a separate client for SSE (long-lived connection)
+            httplib::Client sse_client(host_, port_);
+            if (reconnect.enabled)
+            {
+                // The server heartbeats well within this, so silence means a dead connection
+                sse_client.set_read_timeout(static_cast<time_t>(reconnect.liveness_timeout.count()), 0);
+            }
+            else
+            {
+                // Use a long timeout for SSE (10 minutes) - 0 means "no timeout" but httplib
+                // interprets that as 0 seconds which causes immediate failure
+                sse_client.set_read_timeout(600, 0);  // 10 minutes
+            }
+            sse_client.set_connection_timeout(30);
+            if (basic_auth_)
+            {
+                sse_client.set_basic_auth(basic_auth_->first, basic_auth_->second);
+            }
+
+            httplib::Headers http_headers = base_headers;
+            if (!last_event_id.empty())
+            {
+                http_headers.insert({"Last-Event-ID", last_event_id});
+            }
+
+            bool stopped = false;
             {
-                // Remove trailing newline from data if present
-                if (!current_event_.data.empty() && current_event_.data.back() == '\n')
+                std::lock_guard<std::mutex> lock(sse_client_mutex_);
+                stopped = !sse_running_;
+                if (!stopped)
                 {
-                    current_event_.data.pop_back();
+                    sse_client_ = &sse_client;
                 }
-                on_event(current_event_);
-                current_event_ = SSEEvent{};
             }
-            continue;
-        }
+            if (stopped)
+            {
+                break;
+            }
+
+            SSEParser parser;
+            int status = 0;
+            bool received = false;
+            auto result = sse_client.Get(
+                path,
+                http_headers,
+                [&](const httplib::Response& response) -> bool
+                {
+                    status = response.status;
+                    sse_connected_ = status == 200;
+                    if (observer && status == 200)
+                    {
+                        observer->on_sse_connect(path, connected_before);
+                        connected_before = true;
+                    }
+                    return status == 200;
+                },
+                [this, &parser, &received, &deliver](const char* data, size_t data_length) -> bool
+                {
+                    if (!sse_running_)
+                    {
+                        return false; // Stop receiving
+                    }
 
-        // Parse field
-        size_t colon = line.find(':');
-        std::string field;
-        std::string value;
+                    received = true;
+                    parser.feed(std::string_view(data, data_length), deliver);
+                    return true;
+                }
+            );
 
-        if (colon == 0)
-        {
-            // Comment line (starts with :), ignore
-            continue;
-        }
-        else if (colon != std::string::npos)
-        {
-            field = line.substr(0, colon);
-            // Skip space after colon if present
-            size_t value_start = colon + 1;
-            if (value_start < line.size() && line[value_start] == ' ')
+            sse_connected_ = false;
             {
-                value_start++;
+                std::lock_guard<std::mutex> lock(sse_client_mutex_);
+                sse_client_ = nullptr;
+            }
+            if (!parser.last_event_id().empty())
+            {
+                last_event_id = parser.last_event_id();
+            }
+            if (parser.reconnection_time() > 0)
+            {
+                server_retry = parser.reconnection_time();
             }
-            value = line.substr(value_start);
-        }
-        else
-        {
-            field = line;
-        }
 
-        // Handle known fields
-        if (field == "event")
-        {
-            current_event_.event = value;
-        }
-        else if (field == "data")
-        {
-            if (!current_event_.data.empty())
+            if (!sse_running_)
             {
-                current_event_.data += '\n';
+                break;
             }
-            current_event_.data += value;
-        }
-        else if (field == "id")
-        {
-            current_event_.id = value;
-        }
-        else if (field == "retry")
-        {
-            try
+
+            // Connection closed unexpectedly
+            std::string error;
+            if (status != 0 && status != 200)
             {
-                current_event_.retry = std::stoi(value);
+                error = "SSE request failed with status " + std::to_string(status);
             }
-            catch (...)
+            else if (!result)
             {
-                // Ignore invalid retry values
+                error = httplib::to_string(result.error());
             }
-        }
-    }
-}
 
-void SSEParser::reset()
-{
-    buffer_.clear();
-    current_event_ = SSEEvent{};
-}
+            if (!reconnect.enabled)
+            {
+                if (!error.empty())
+                {
+                    on_error(error);
+                }
+                break;
+            }
 
-// =============================================================================
-// HttpTransport Implementation
-// =============================================================================
+            // A healthy stream that dropped starts the backoff over
+            failures = received ? 1 : failures + 1;
 
-class HttpTransport::Impl
-{
-  public:
-    Impl(const std::string& host, int port)
-        : host_(host), port_(port), client_(host, port)
-    {
-        client_.set_connection_timeout(connection_timeout_);
-        client_.set_read_timeout(read_timeout_);
-    }
+            // Client errors other than timeouts and rate limits will not go away by retrying
+            bool fatal = status >= 400 && status < 500 && status != 408 && status != 429;
+            if (fatal || (reconnect.max_attempts && failures > reconnect.max_attempts))
+            {
+                on_error(error.empty() ? "SSE stream ended" : error);
+                break;
+            }
 
-    Impl(const std::string& host, int port, const std::string& username, const std::string& password)
-        : host_(host), port_(port), client_(host, port)
-    {
-        client_.set_basic_auth(username, password);
-        client_.set_connection_timeout(connection_timeout_);
-        client_.set_read_timeout(read_timeout_);
+            auto delay = reconnect_delay(reconnect, server_retry, failures, random);
+            std::unique_lock<std::mutex> lock(sse_client_mutex_);
+            if (sse_cv_.wait_for(lock, delay, [this] { return !sse_running_; }))
+            {
+                break;
+            }
+        }
+
+        on_close();
     }
 
-    ~Impl()
+    /// How one WebSocket connection ended
+    struct WebSocketEnd
     {
-        stop_sse();
-    }
+        std::string error;     // Empty on a close frame or stop
+        bool upgraded = false; // The handshake succeeded
+        bool fatal = false;    // Retrying cannot help
+        bool closed = false;   // The server sent a close frame
+    };
 
-    HttpResponse request(const HttpRequest& req)
+    void run_websocket(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        const SSEReconnectOptions& reconnect,
+        WebSocketMessageCallback on_message,
+        SSEErrorCallback on_error,
+        SSECloseCallback on_close
+    )
     {
-        HttpResponse response;
+        size_t failures = 0; // Consecutive attempts that did not get upgraded
+        std::minstd_rand random(std::random_device{}());
 
-        // Build headers
-        httplib::Headers headers;
-        for (const auto& [key, value] : req.headers)
+        while (ws_running_)
         {
-            headers.insert({key, value});
-        }
+            auto end = websocket_session(path, headers, reconnect, on_message);
+            if (!ws_running_ || end.closed)
+            {
+                break;
+            }
+            if (!reconnect.enabled)
+            {
+                if (!end.error.empty())
+                {
+                    on_error(end.error);
+                }
+                break;
+            }
 
-        // Add directory header if set
-        if (!directory_.empty())
-        {
-            headers.insert({"x-opencode-directory", directory_});
+            failures = end.upgraded ? 1 : failures + 1;
+            if (end.fatal || (reconnect.max_attempts && failures > reconnect.max_attempts))
+            {
+                on_error(end.error.empty() ? "WebSocket ended" : end.error);
+                break;
+            }
+
+            auto delay = reconnect_delay(reconnect, 0, failures, random);
+            std::unique_lock<std::mutex> lock(ws_mutex_);
+            if (ws_cv_.wait_for(lock, delay, [this] { return !ws_running_; }))
+            {
+                break;
+            }
         }
 
-        // Always request JSON responses
-        headers.insert({"Accept", "application/json"});
+        on_close();
+    }
 
-        // Set content type
-        std::string content_type = req.content_type.value_or("application/json");
+    /// Connect, upgrade, and receive until the connection ends
+    WebSocketEnd websocket_session(
+        const std::string& path,
+        const std::vector<std::pair<std::string, std::string>>& headers,
+        const SSEReconnectOptions& reconnect,
+        const WebSocketMessageCallback& on_message
+    )
+    {
+        WebSocketEnd end;
+        std::chrono::milliseconds connect_timeout = std::chrono::seconds(connection_timeout_.load());
+        socket_t sock = connect_socket(host_, port_, connect_timeout, end.error);
+        if (sock == INVALID_SOCKET)
+        {
+            return end;
+        }
 
-        httplib::Result result;
-        if (req.method == "GET")
+        // ws_socket_ changes under both locks, so holding either one keeps it open
         {
-            result = client_.Get(req.path, headers);
+            std::scoped_lock lock(ws_send_mutex_, ws_mutex_);
+            if (!ws_running_)
+            {
+                close_socket(sock);
+                return end;
+            }
+            ws_socket_ = sock;
         }
-        else if (req.method == "POST")
+        struct Release
+        {
+            Impl* self;
+            ~Release()
+            {
+                std::scoped_lock lock(self->ws_send_mutex_, self->ws_mutex_);
+                self->ws_connected_ = false;
+                close_socket(self->ws_socket_);
+                self->ws_socket_ = INVALID_SOCKET;
+            }
+        } release{this};
+
+        // Handshake (RFC 6455, section 4.1)
+        std::string nonce(16, '\0');
         {
-            result = client_.Post(req.path, headers, req.body, content_type);
+            std::lock_guard<std::mutex> lock(ws_send_mutex_);
+            for (auto& c : nonce)
+            {
+                c = static_cast<char>(ws_mask_() & 0xFF);
+            }
         }
-        else if (req.method == "PUT")
+        std::string key = base64(nonce);
+        std::string request = "GET " + path + " HTTP/1.1\r\n"
+                              "Host: " + host_ + ":" + std::to_string(port_) + "\r\n"
+                              "Upgrade: websocket\r\n"
+                              "Connection: Upgrade\r\n"
+                              "Sec-WebSocket-Key: " + key + "\r\n"
+                              "Sec-WebSocket-Version: 13\r\n";
+        if (basic_auth_)
         {
-            result = client_.Put(req.path, headers, req.body, content_type);
+            request += "Authorization: Basic " + base64(basic_auth_->first + ":" + basic_auth_->second) + "\r\n";
         }
-        else if (req.method == "PATCH")
+        if (!directory_.empty())
         {
-            result = client_.Patch(req.path, headers, req.body, content_type);
+            request += "x-opencode-directory: " + directory_ + "\r\n";
         }
-        else if (req.method == "DELETE")
+        for (const auto& [name, value] : headers)
         {
-            result = client_.Delete(req.path, headers);
+            request += name + ": " + value + "\r\n";
         }
-        else
+        request += "\r\n";
+        if (!send_all(sock, request))
         {
-            response.error = "Unsupported HTTP method: " + req.method;
-            return response;
+            end.error = "WebSocket handshake could not be sent";
+            return end;
         }
 
-        if (result)
+        std::string buffer;
+        char chunk[16 * 1024];
+        size_t head_end;
+        while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos)
         {
-            response.status = result->status;
-            response.body = result->body;
-            for (const auto& [key, value] : result->headers)
+            if (buffer.size() > 64 * 1024)
             {
-                response.headers.push_back({key, value});
+                end.error = "WebSocket handshake response is too large";
+                return end;
+            }
+            if (!wait_socket(sock, false, connect_timeout))
+            {
+                end.error = "WebSocket handshake timed out";
+                return end;
+            }
+            auto n = ::recv(sock, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+            {
+                end.error = "WebSocket handshake failed: connection closed";
+                return end;
             }
+            buffer.append(chunk, static_cast<size_t>(n));
         }
-        else
+
+        std::string_view head(buffer.data(), head_end + 2);
+        int status = 0;
+        if (size_t space = head.find(' '); space != std::string_view::npos)
         {
-            response.error = httplib::to_string(result.error());
+            std::from_chars(head.data() + space + 1, head.data() + head.size(), status);
         }
-
-        return response;
-    }
-
-    bool start_sse(
-        const std::string& path,
-        const std::vector<std::pair<std::string, std::string>>& headers,
-        SSEEventCallback on_event,
-        SSEErrorCallback on_error,
-        SSECloseCallback on_close
-    )
-    {
-        stop_sse();
-
-        sse_running_ = true;
-        sse_thread_ = std::thread([this, path, headers, on_event, on_error, on_close]()
+        if (status != 101)
         {
-            run_sse(path, headers, on_event, on_error, on_close);
-        });
-
-        return true;
-    }
-
-    void stop_sse()
-    {
-        sse_running_ = false;
-        if (sse_thread_.joinable())
+            // A plain HTTP answer means the endpoint does not speak WebSocket at all
+            end.error = "WebSocket upgrade failed with status " + std::to_string(status);
+            end.fatal = (status >= 200 && status < 300) ||
+                        (status >= 400 && status < 500 && status != 408 && status != 429);
+            return end;
+        }
+        if (head_value(head, "Sec-WebSocket-Accept") != websocket_accept(key))
         {
-            sse_thread_.join();
+            end.error = "WebSocket handshake failed: wrong Sec-WebSocket-Accept";
+            end.fatal = true;
+            return end;
         }
-    }
-
-    bool sse_connected() const
-    {
-        return sse_connected_;
-    }
-
-    void set_directory(const std::string& directory)
-    {
-        directory_ = directory;
-    }
-
-    void set_connection_timeout(int seconds)
-    {
-        connection_timeout_ = seconds;
-        client_.set_connection_timeout(seconds, 0);
-    }
-
-    void set_read_timeout(int seconds)
-    {
-        read_timeout_ = seconds;
-        client_.set_read_timeout(seconds, 0);
-    }
-
-  private:
-    void run_sse(
-        const std::string& path,
-        const std::vector<std::pair<std::string, std::string>>& headers,
-        SSEEventCallback on_event,
-        SSEErrorCallback on_error,
-        SSECloseCallback on_close
-    )
-    {
-        // Create a separate client for SSE (long-lived connection)
-        httplib::Client sse_client(host_, port_);
-        // Use a long timeout for SSE (10 minutes) - 0 means "no timeout" but httplib
-        // interprets that as 0 seconds which causes immediate failure
-        sse_client.set_read_timeout(600, 0);  // 10 minutes
-        sse_client.set_connection_timeout(30);
+        end.upgraded = true;
+        ws_connected_ = true;
 
-        // Build headers
-        httplib::Headers http_headers;
-        http_headers.insert({"Accept", "text/event-stream"});
-        http_headers.insert({"Cache-Control", "no-cache"});
-        http_headers.insert({"Connection", "keep-alive"});
-        for (const auto& [key, value] : headers)
+        // A quiet connection is pinged, so only a dead one stays silent for
+        // liveness_timeout; without a reconnect policy it is never given up on
+        std::chrono::milliseconds liveness = reconnect.liveness_timeout;
+        std::chrono::milliseconds ping_every = reconnect.enabled
+            ? std::max<std::chrono::milliseconds>(liveness / 3, std::chrono::seconds(1))
+            : std::chrono::seconds(30);
+        auto control = [this](WebSocketOpcode opcode, std::string_view payload)
         {
-            http_headers.insert({key, value});
-        }
-        if (!directory_.empty())
+            std::lock_guard<std::mutex> lock(ws_send_mutex_);
+            send_all(ws_socket_, websocket_frame(opcode, payload, ws_mask_()));
+        };
+
+        WebSocketParser parser;
+        auto on_frame = [&](WebSocketOpcode opcode, std::string_view payload)
         {
-            http_headers.insert({"x-opencode-directory", directory_});
-        }
+            switch (opcode)
+            {
+            case WebSocketOpcode::Text:
+            case WebSocketOpcode::Binary:
+                on_message(payload);
+                break;
+            case WebSocketOpcode::Ping:
+                control(WebSocketOpcode::Pong, payload);
+                break;
+            case WebSocketOpcode::Close:
+                control(WebSocketOpcode::Close, payload.substr(0, 2)); // Echo the status code
+                end.closed = true;
+                break;
+            default:
+                break;
+            }
+        };
 
-        SSEParser parser;
-        sse_connected_ = true;
+        auto heard = Clock::now();
+        std::string_view pending(buffer);
+        pending.remove_prefix(head_end + 4);
+        while (ws_running_)
+        {
+            try
+            {
+                parser.feed(pending, on_frame);
+            }
+            catch (const std::exception& e)
+            {
+                end.error = e.what();
+                end.fatal = true;
+                return end;
+            }
+            if (end.closed)
+            {
+                return end;
+            }
 
-        auto result = sse_client.Get(
-            path,
-            http_headers,
-            [this, &parser, &on_event](const char* data, size_t data_length) -> bool
+            if (!wait_socket(sock, false, ping_every))
             {
-                if (!sse_running_)
+                if (reconnect.enabled && Clock::now() - heard >= liveness)
                 {
-                    return false; // Stop receiving
+                    end.error = "WebSocket connection went quiet";
+                    return end;
                 }
-
-                std::string chunk(data, data_length);
-                parser.feed(chunk, on_event);
-                return true;
+                control(WebSocketOpcode::Ping, {});
+                pending = {};
+                continue;
             }
-        );
-
-        sse_connected_ = false;
-
-        if (sse_running_)
-        {
-            // Connection closed unexpectedly
-            if (!result)
+            auto n = ::recv(sock, chunk, sizeof(chunk), 0);
+            if (n <= 0)
             {
-                on_error(httplib::to_string(result.error()));
+                end.error = n == 0 ? "WebSocket connection closed without a close frame" : "WebSocket read failed";
+                return end;
             }
+            heard = Clock::now();
+            pending = std::string_view(chunk, static_cast<size_t>(n));
         }
-
-        on_close();
+        return end;
     }
 
     std::string host_;
     int port_;
-    httplib::Client client_;
+    std::optional<std::pair<std::string, std::string>> basic_auth_;
     std::string directory_;
-    int connection_timeout_ = 30;
-    int read_timeout_ = 30;
+    std::atomic<int> connection_timeout_{30};
+    std::atomic<int> read_timeout_{30};
+    std::atomic<bool> compression_{true};
+    ValidatorCache validators_;
+
+    // Keep-alive connection pool for request()
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cv_;
+    std::vector<IdleConnection> idle_;
+    size_t open_ = 0; // Idle plus checked-out connections
+    size_t max_connections_ = 8;
+    std::chrono::seconds idle_timeout_{60};
 
     std::atomic<bool> sse_running_{false};
     std::atomic<bool> sse_connected_{false};
     std::thread sse_thread_;
+    std::mutex sse_client_mutex_;
+    std::condition_variable sse_cv_;         // Wakes a reconnect backoff on stop_sse()
+    httplib::Client* sse_client_ = nullptr; // Live SSE client, for stop_sse()
+    SSEReconnectOptions sse_reconnect_;
+
+    std::atomic<bool> ws_running_{false};
+    std::atomic<bool> ws_connected_{false};
+    std::thread ws_thread_;
+    std::mutex ws_mutex_;                 // Wakes a reconnect backoff on stop_websocket()
+    std::condition_variable ws_cv_;
+    std::mutex ws_send_mutex_;            // One frame at a time on the socket
+    socket_t ws_socket_ = INVALID_SOCKET; // Changed under both mutexes
+    std::independent_bits_engine<std::mt19937, 32, uint32_t> ws_mask_{std::random_device{}()}; // Under ws_send_mutex_
+    mutable std::mutex observer_mutex_; // std::atomic<std::shared_ptr> is missing from libc++
+    std::shared_ptr<TransportObserver> observer_;
 };
 
 // =============================================================================
@@ -364,6 +1998,11 @@ HttpResponse HttpTransport::request(const HttpRequest& req)
     return impl_->request(req);
 }
 
+HttpResponse HttpTransport::request_stream(const HttpRequest& req, const ContentCallback& on_data)
+{
+    return impl_->request_stream(req, on_data);
+}
+
 bool HttpTransport::start_sse(
     const std::string& path,
     const std::vector<std::pair<std::string, std::string>>& headers,
@@ -385,11 +2024,52 @@ bool HttpTransport::sse_connected() const
     return impl_->sse_connected();
 }
 
+bool HttpTransport::start_websocket(
+    const std::string& path,
+    const std::vector<std::pair<std::string, std::string>>& headers,
+    WebSocketMessageCallback on_message,
+    SSEErrorCallback on_error,
+    SSECloseCallback on_close
+)
+{
+    return impl_->start_websocket(path, headers, on_message, on_error, on_close);
+}
+
+bool HttpTransport::websocket_send(std::string_view text)
+{
+    return impl_->websocket_send(text);
+}
+
+void HttpTransport::stop_websocket()
+{
+    impl_->stop_websocket();
+}
+
 void HttpTransport::set_directory(const std::string& directory)
 {
     impl_->set_directory(directory);
 }
 
+void HttpTransport::set_sse_reconnect(const SSEReconnectOptions& options)
+{
+    impl_->set_sse_reconnect(options);
+}
+
+void HttpTransport::set_observer(std::shared_ptr<TransportObserver> observer)
+{
+    impl_->set_observer(std::move(observer));
+}
+
+void HttpTransport::set_compression(bool enabled)
+{
+    impl_->set_compression(enabled);
+}
+
+void HttpTransport::set_response_cache(size_t max_bytes)
+{
+    impl_->set_response_cache(max_bytes);
+}
+
 void HttpTransport::set_connection_timeout(int seconds)
 {
     impl_->set_connection_timeout(seconds);
@@ -400,4 +2080,14 @@ void HttpTransport::set_read_timeout(int seconds)
     impl_->set_read_timeout(seconds);
 }
 
+void HttpTransport::set_max_connections(size_t max_connections)
+{
+    impl_->set_max_connections(max_connections);
+}
+
+void HttpTransport::set_idle_timeout(int seconds)
+{
+    impl_->set_idle_timeout(seconds);
+}
+
 } // namespace opencode
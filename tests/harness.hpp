@@ -0,0 +1,313 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <opencode/transport.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// =============================================================================
+// Test registry
+// =============================================================================
+//
+// Tests that need no server: each TEST() registers itself, CHECK() records a
+// failure and carries on, and opencode-smoke runs them all.
+
+namespace opencode::test
+{
+
+struct Case
+{
+    const char* name;
+    void (*run)();
+};
+
+std::vector<Case>& cases();
+int& failures();
+
+struct Register
+{
+    Register(const char* name, void (*run)())
+    {
+        cases().push_back({name, run});
+    }
+};
+
+// =============================================================================
+// Fake transport
+// =============================================================================
+
+/// Event stream a test feeds by hand
+///
+/// push() delivers one frame on the calling thread to whichever stream is
+/// open, as the SSE thread would.
+class FakeEvents
+{
+  public:
+    /// Deliver one event whose data is `data` (a JSON frame)
+    /// @return false if no stream is open
+    bool push(const std::string& data)
+    {
+        SSEEventCallback deliver;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            deliver = on_event_;
+        }
+        if (!deliver)
+            return false;
+        SSEEvent event;
+        event.data = data;
+        deliver(event);
+        return true;
+    }
+
+    /// Deliver an event of a type with the given properties (a JSON object)
+    bool push(const std::string& type, const std::string& properties)
+    {
+        return push(R"({"type":")" + type + R"(","properties":)" + properties + "}");
+    }
+
+    /// Deliver server.connected, as the server does on every (re)connection
+    bool connect()
+    {
+        return push("server.connected", "{}");
+    }
+
+    /// Wait until a stream is open
+    bool wait_open(std::chrono::milliseconds timeout = std::chrono::seconds(5))
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, timeout, [this] { return static_cast<bool>(on_event_); });
+    }
+
+    // Used by the stream transport
+    void open(SSEEventCallback on_event, SSECloseCallback on_close)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        on_event_ = std::move(on_event);
+        on_close_ = std::move(on_close);
+        cv_.notify_all();
+    }
+
+    void close()
+    {
+        SSECloseCallback on_close;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            on_event_ = nullptr;
+            on_close.swap(on_close_);
+        }
+        if (on_close)
+            on_close();
+    }
+
+    bool is_open() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<bool>(on_event_);
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    SSEEventCallback on_event_;
+    SSECloseCallback on_close_;
+};
+
+/// Transport answering requests from handlers keyed by "METHOD /path"
+/// The query string is not part of the key; unknown requests get a 404.
+/// It has no event stream of its own (start_sse() closes at once); once a
+/// test has called events(), the client's event stream is fed from there.
+class FakeTransport : public Transport
+{
+  public:
+    using Handler = std::function<HttpResponse(const HttpRequest& req)>;
+
+    void on(const std::string& key, Handler handler)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handlers_[key] = std::move(handler);
+    }
+
+    /// Answer key with a fixed status and body
+    void reply(const std::string& key, int status, std::string body)
+    {
+        on(key, [status, body = std::move(body)](const HttpRequest&)
+        {
+            HttpResponse response;
+            response.status = status;
+            response.body = body;
+            return response;
+        });
+    }
+
+    /// Requests received so far, as "METHOD /path?query"
+    std::vector<std::string> requests() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+
+    HttpResponse request(const HttpRequest& req) override
+    {
+        Handler handler;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requests_.push_back(req.method + " " + req.path);
+            auto it = handlers_.find(req.method + " " + req.path.substr(0, req.path.find('?')));
+            if (it != handlers_.end())
+                handler = it->second;
+        }
+        if (!handler)
+        {
+            HttpResponse response;
+            response.status = 404;
+            return response;
+        }
+        return handler(req);
+    }
+
+    /// Hand streamed 2xx bodies to on_data in two pieces split at offset
+    /// (0, the default, sends the body in one piece)
+    void split_streams_at(size_t offset)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        split_ = offset;
+    }
+
+    HttpResponse request_stream(const HttpRequest& req, const ContentCallback& on_data) override
+    {
+        size_t split;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            split = split_;
+        }
+        auto response = request(req);
+        if (response.status < 200 || response.status >= 300)
+            return response;
+        std::string_view body = response.body;
+        split = std::min(split, body.size());
+        if ((split == 0 || on_data(body.substr(0, split))) && split < body.size())
+            on_data(body.substr(split));
+        response.body.clear();
+        return response;
+    }
+
+    bool start_sse(
+        const std::string&,
+        const std::vector<std::pair<std::string, std::string>>&,
+        SSEEventCallback,
+        SSEErrorCallback,
+        SSECloseCallback on_close
+    ) override
+    {
+        on_close();
+        return false;
+    }
+
+    void stop_sse() override
+    {
+    }
+
+    bool sse_connected() const override
+    {
+        return false;
+    }
+
+    /// The event stream, fed by the test (created on first use)
+    std::shared_ptr<FakeEvents> events()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!events_)
+            events_ = std::make_shared<FakeEvents>();
+        return events_;
+    }
+
+    std::unique_ptr<Transport> stream_transport() override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!events_)
+            return nullptr;
+        return std::make_unique<Stream>(events_);
+    }
+
+  private:
+    /// Stream transport handing its callbacks to FakeEvents
+    class Stream : public Transport
+    {
+      public:
+        explicit Stream(std::shared_ptr<FakeEvents> events) : events_(std::move(events))
+        {
+        }
+
+        ~Stream() override
+        {
+            stop_sse();
+        }
+
+        HttpResponse request(const HttpRequest&) override
+        {
+            return {};
+        }
+
+        bool start_sse(
+            const std::string&,
+            const std::vector<std::pair<std::string, std::string>>&,
+            SSEEventCallback on_event,
+            SSEErrorCallback,
+            SSECloseCallback on_close
+        ) override
+        {
+            events_->open(std::move(on_event), std::move(on_close));
+            return true;
+        }
+
+        void stop_sse() override
+        {
+            events_->close();
+        }
+
+        bool sse_connected() const override
+        {
+            return events_->is_open();
+        }
+
+      private:
+        std::shared_ptr<FakeEvents> events_;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Handler> handlers_;
+    std::vector<std::string> requests_;
+    std::shared_ptr<FakeEvents> events_;
+    size_t split_ = 0;
+};
+
+} // namespace opencode::test
+
+#define TEST(name)                                                              \
+    static void name();                                                         \
+    static const opencode::test::Register name##_registration(#name, name);     \
+    static void name()
+
+#define CHECK(condition)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++opencode::test::failures();                                       \
+        }                                                                       \
+    } while (false)
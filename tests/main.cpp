@@ -0,0 +1,46 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <exception>
+
+namespace opencode::test
+{
+
+std::vector<Case>& cases()
+{
+    static std::vector<Case> registered;
+    return registered;
+}
+
+int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+} // namespace opencode::test
+
+int main()
+{
+    using namespace opencode::test;
+
+    for (const auto& test : cases())
+    {
+        int before = failures();
+        try
+        {
+            test.run();
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "%s: unexpected exception: %s\n", test.name, e.what());
+            ++failures();
+        }
+        std::printf("%s %s\n", failures() == before ? "[ OK   ]" : "[ FAIL ]", test.name);
+    }
+
+    std::printf("%zu tests, %d failed checks\n", cases().size(), failures());
+    return failures() == 0 ? 0 : 1;
+}
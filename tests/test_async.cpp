@@ -0,0 +1,154 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/client.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace opencode;
+using namespace std::chrono_literals;
+
+TEST(async_calls_survive_a_client_move)
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    transport->reply("GET /file/a.txt", 200, R"({"path":"a.txt","content":"alpha"})");
+    transport->reply("POST /session", 200, R"({"id":"ses_1","title":"t"})");
+
+    Client original(ClientOptions{}, std::move(transport));
+    auto file = original.read_file_async("a.txt");
+    auto session = original.create_session_async("t");
+    Client moved(std::move(original));
+
+    CHECK(file.get().content == "alpha");
+    CHECK(session.get().id() == "ses_1");
+    CHECK(moved.read_file_async("a.txt").get().content == "alpha");
+}
+
+TEST(pending_replies_do_not_hold_up_the_async_pool)
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    auto events = transport->events();
+    auto prompts = std::make_shared<std::map<std::string, std::string>>(); // Session -> prompt message ID
+    for (std::string session : {"ses_1", "ses_2"})
+    {
+        transport->on("POST /session/" + session + "/prompt_async", [prompts, session](const HttpRequest& req)
+        {
+            (*prompts)[session] = nlohmann::json::parse(req.body).value("messageID", "");
+            HttpResponse response;
+            response.status = 204;
+            return response;
+        });
+    }
+    transport->reply("GET /file/a.txt", 200, R"({"path":"a.txt","content":"alpha"})");
+    auto* fake = transport.get();
+
+    ClientOptions options;
+    options.async_threads = 1;
+    Client client(options, std::move(transport));
+
+    // Queued until the event stream connects
+    auto first = client.send_message_async("ses_1", "one");
+    auto second = client.send_message_async("ses_2", "two");
+    CHECK(events->wait_open());
+    CHECK(events->connect());
+
+    // Both prompts are in and waiting for replies, yet the one worker is free
+    auto file = client.read_file_async("a.txt");
+    CHECK(file.wait_for(5s) == std::future_status::ready);
+    auto requests = fake->requests();
+    CHECK(std::count(requests.begin(), requests.end(), "POST /session/ses_1/prompt_async") == 1);
+    CHECK(std::count(requests.begin(), requests.end(), "POST /session/ses_2/prompt_async") == 1);
+    CHECK(first.wait_for(0s) == std::future_status::timeout);
+    CHECK(client.generations_in_flight() == 2);
+
+    for (std::string session : {"ses_1", "ses_2"})
+    {
+        events->push("message.updated", R"({"info":{"id":"msg_)" + session + R"(","sessionID":")" + session +
+                                            R"(","role":"assistant","parentID":")" + (*prompts)[session] +
+                                            R"(","time":{"created":1,"completed":2}}})");
+        events->push("session.idle", R"({"sessionID":")" + session + R"("})");
+    }
+    CHECK(first.wait_for(5s) == std::future_status::ready && first.get().id() == "msg_ses_1");
+    CHECK(second.wait_for(5s) == std::future_status::ready && second.get().id() == "msg_ses_2");
+    CHECK(client.generations_in_flight() == 0);
+}
+
+TEST(pending_replies_fail_when_the_event_stream_closes)
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    auto events = transport->events();
+    transport->reply("POST /session/ses_1/prompt_async", 204, "");
+
+    auto client = std::make_unique<Client>(ClientOptions{}, std::move(transport));
+    auto reply = client->send_message_async("ses_1", "one");
+    CHECK(events->wait_open());
+    client.reset();
+
+    CHECK(reply.wait_for(5s) == std::future_status::ready);
+    bool failed = false;
+    try
+    {
+        reply.get();
+    }
+    catch (const std::runtime_error&)
+    {
+        failed = true;
+    }
+    CHECK(failed);
+}
+
+TEST(reconnect_recheck_skips_the_previous_turns_reply)
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    auto events = transport->events();
+    auto prompt_id = std::make_shared<std::string>();
+
+    // The stream reconnects right after the prompt is accepted, before the
+    // server has started on it: the last message is the previous turn's reply
+    transport->on("POST /session/ses_1/prompt_async", [events, prompt_id](const HttpRequest& req)
+    {
+        *prompt_id = nlohmann::json::parse(req.body).value("messageID", "");
+        events->connect();
+        HttpResponse response;
+        response.status = 204;
+        return response;
+    });
+    transport->reply("GET /session/ses_1/message", 200,
+                     R"([{"info":{"id":"msg_old","sessionID":"ses_1","role":"assistant","parentID":"msg_older",)"
+                     R"("time":{"created":1,"completed":2}},"parts":[]}])");
+    auto* fake = transport.get();
+
+    Client client(ClientOptions{}, std::move(transport));
+    auto reply = client.send_message_async("ses_1", "again");
+    CHECK(events->wait_open());
+    CHECK(events->connect());
+
+    auto rechecked = [&]
+    {
+        auto requests = fake->requests();
+        return std::find(requests.begin(), requests.end(), "GET /session/ses_1/message?limit=1") != requests.end();
+    };
+    for (int i = 0; i < 500 && !rechecked(); ++i)
+        std::this_thread::sleep_for(10ms);
+    CHECK(rechecked());
+    CHECK(prompt_id->starts_with("msg_"));
+    CHECK(reply.wait_for(100ms) == std::future_status::timeout);
+
+    // An assistant message of the previous turn does not count either
+    events->push("message.updated", R"({"info":{"id":"msg_old","sessionID":"ses_1","role":"assistant",)"
+                                    R"("parentID":"msg_older","time":{"created":1,"completed":2}}})");
+    events->push("message.updated", R"({"info":{"id":"msg_new","sessionID":"ses_1","role":"assistant",)"
+                                    R"("parentID":")" + *prompt_id + R"(","time":{"created":3,"completed":4}}})");
+    events->push("session.idle", R"({"sessionID":"ses_1"})");
+    CHECK(reply.wait_for(5s) == std::future_status::ready && reply.get().id() == "msg_new");
+}
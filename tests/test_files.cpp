@@ -0,0 +1,103 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/client.hpp>
+
+#include <memory>
+#include <stdexcept>
+
+using namespace opencode;
+
+namespace
+{
+
+std::unique_ptr<test::FakeTransport> file_server()
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    transport->reply("GET /file/a.txt", 200, R"({"path":"a.txt","content":"alpha"})");
+    transport->reply("GET /file/b.txt", 200, R"({"path":"b.txt","content":"beta"})");
+    return transport;
+}
+
+} // namespace
+
+TEST(read_files_reports_success)
+{
+    Client client(ClientOptions{}, file_server());
+    std::vector<std::string> paths = {"a.txt", "missing.txt", "b.txt"};
+
+    auto results = client.read_files(paths);
+    CHECK(results.size() == 3);
+    CHECK(results[0].ok());
+    CHECK(results[0].value && results[0].value->content == "alpha");
+    CHECK(!results[1].ok());
+    CHECK(!results[1].error.empty());
+    CHECK(results[2].ok());
+}
+
+TEST(read_files_without_collect_still_reports_success)
+{
+    Client client(ClientOptions{}, file_server());
+    std::vector<std::string> paths = {"a.txt", "missing.txt"};
+
+    size_t seen = 0;
+    FileBatchOptions<FileContent> options;
+    options.collect = false;
+    options.on_result = [&](const FileReadResult& result)
+    {
+        ++seen;
+        if (result.path == "a.txt")
+            CHECK(result.ok() && result.value && result.value->content == "alpha");
+    };
+
+    auto results = client.read_files(paths, options);
+    CHECK(seen == 2);
+    CHECK(results[0].ok());
+    CHECK(!results[0].value); // Not kept
+    CHECK(results[0].error.empty());
+    CHECK(!results[1].ok());
+}
+
+TEST(read_files_reports_exceptions_without_a_message_as_failures)
+{
+    struct Silent : std::exception
+    {
+        const char* what() const noexcept override { return ""; }
+    };
+
+    auto transport = file_server();
+    transport->on("GET /file/silent.txt", [](const HttpRequest&) -> HttpResponse { throw Silent(); });
+    transport->on("GET /file/odd.txt", [](const HttpRequest&) -> HttpResponse { throw 42; });
+    Client client(ClientOptions{}, std::move(transport));
+    std::vector<std::string> paths = {"silent.txt", "odd.txt", "a.txt"};
+
+    auto results = client.read_files(paths);
+    CHECK(!results[0].ok());
+    CHECK(!results[0].error.empty());
+    CHECK(!results[1].ok());
+    CHECK(!results[1].error.empty());
+    CHECK(results[2].ok());
+}
+
+TEST(read_files_rethrows_a_failing_callback)
+{
+    Client client(ClientOptions{}, file_server());
+    std::vector<std::string> paths = {"a.txt", "b.txt", "a.txt", "b.txt"};
+
+    FileBatchOptions<FileContent> options;
+    options.max_concurrency = 2;
+    options.on_result = [](const FileReadResult&) { throw std::runtime_error("callback failed"); };
+
+    std::string error;
+    try
+    {
+        client.read_files(paths, options);
+    }
+    catch (const std::runtime_error& e)
+    {
+        error = e.what();
+    }
+    CHECK(error == "callback failed");
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/client.hpp>
+
+#include <memory>
+
+using namespace opencode;
+
+TEST(metadata_cache_serves_from_an_already_connected_event_stream)
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    auto events = transport->events();
+    transport->reply("GET /app/agents", 200, R"([{"name":"build"}])");
+    auto* fake = transport.get();
+
+    ClientOptions options;
+    options.metadata_cache.enabled = true;
+    Client client(options, std::move(transport));
+
+    // Someone else's subscription connects the shared stream first
+    auto stream = client.subscribe_events();
+    CHECK(events->wait_open());
+    CHECK(events->connect());
+
+    CHECK(client.list_agents().size() == 1);
+    CHECK(client.list_agents().size() == 1);
+    CHECK(fake->requests().size() == 1);
+    CHECK(client.metadata_cache_stats().hits == 1);
+
+    // An invalidating event sends the next call to the server
+    CHECK(events->push("global.disposed", "{}"));
+    CHECK(client.list_agents().size() == 1);
+    CHECK(fake->requests().size() == 2);
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/metrics.hpp>
+
+using namespace opencode;
+
+TEST(metrics_endpoints_collapse_ids_and_file_paths)
+{
+    CHECK(MetricsRegistry::endpoint("/session/ses_01J9/message?limit=5") == "/session/{id}/message");
+    CHECK(MetricsRegistry::endpoint("/session/abc/message/def/part/ghi") == "/session/{id}/message/{id}/part/{id}");
+    CHECK(MetricsRegistry::endpoint("/mcp/github/connect") == "/mcp/{id}/connect");
+    CHECK(MetricsRegistry::endpoint("/mcp/status") == "/mcp/status");
+    CHECK(MetricsRegistry::endpoint("/auth/anthropic") == "/auth/{id}");
+    CHECK(MetricsRegistry::endpoint("/file/src/main.cpp") == "/file/{path}");
+    CHECK(MetricsRegistry::endpoint("/file/docs/read me.md/status") == "/file/{path}/status");
+    CHECK(MetricsRegistry::endpoint("/file?path=src") == "/file");
+    CHECK(MetricsRegistry::endpoint("/find/text") == "/find/text");
+    CHECK(MetricsRegistry::endpoint("/config/providers") == "/config/providers");
+}
+
+TEST(metrics_event_queue_tracks_the_deepest_queue)
+{
+    MetricsRegistry metrics;
+    metrics.on_event_queued(3);
+    metrics.on_event_queued(7);
+    metrics.on_event_queued(2);
+    auto text = metrics.prometheus_text();
+    CHECK(text.find("opencode_event_queue_depth 2\n") != std::string::npos);
+    CHECK(text.find("opencode_event_queue_depth_max 7\n") != std::string::npos);
+    CHECK(text.find("opencode_event_queued_total 3\n") != std::string::npos);
+
+    metrics.reset();
+    CHECK(metrics.prometheus_text().find("opencode_event_queued_total 0\n") != std::string::npos);
+}
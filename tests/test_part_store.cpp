@@ -0,0 +1,43 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/part_store.hpp>
+
+#include <string>
+
+using namespace opencode;
+
+TEST(part_store_compact_keeps_current_text)
+{
+    PartStore store(16);
+    std::string expected;
+    for (int i = 0; i < 100; ++i)
+    {
+        store.append("msg_1", "prt_1", "0123456789");
+        expected += "0123456789";
+    }
+    size_t before = store.bytes();
+
+    store.compact("msg_1");
+    CHECK(store.bytes() < before);
+    CHECK(store.bytes() >= expected.size());
+    CHECK(store.text("msg_1", "prt_1") == std::string_view(expected));
+
+    // Appending after a compaction carries on from the current text
+    auto text = store.append("msg_1", "prt_1", "!");
+    CHECK(text == expected + "!");
+}
+
+TEST(part_store_message_text_leaves_out_reasoning)
+{
+    PartStore store;
+    MessagePartUpdatedEvent thinking{.message_id = "msg_1", .part = ReasoningPart{.id = "prt_1", .text = "hmm. "}};
+    MessagePartUpdatedEvent answer{.message_id = "msg_1", .part = TextPart{.id = "prt_2", .text = "42"}};
+    store.apply(thinking);
+    store.apply(answer);
+
+    CHECK(store.message_text("msg_1") == "42");
+    CHECK(store.message_text("msg_1", true) == "hmm. 42");
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/client.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace opencode;
+using json = nlohmann::json;
+
+namespace
+{
+
+// Escapes, a surrogate pair, structural characters inside strings and an
+// escaped key, so a split lands inside each of them at some offset
+const std::string kFileBody =
+    R"({"path":"docs/a.md","content":"caf\u00e9 \uD83D\uDE00 \"q\" \\ ]}\n\t","x\"y":[1,{"z":"}"}],"encoding":"utf8"})";
+
+const std::string kMatchesBody =
+    R"({"matches":[{"path":"src/a.cpp","line":3,"column":1,"text":"caf\u00e9 \uD83D\uDE00 ]}\"","match":"\uD83D\uDE00"},)"
+    R"({"path":"b\\c","line":10,"column":2,"text":"[{","match":"{"}],"totalMatches":2,"truncated":false})";
+
+} // namespace
+
+TEST(read_file_stream_matches_json_parse_at_every_split)
+{
+    auto expected = json::parse(kFileBody);
+    auto content = expected["content"].get<std::string>();
+
+    auto transport = std::make_unique<test::FakeTransport>();
+    transport->reply("GET /file/docs/a.md", 200, kFileBody);
+    auto* fake = transport.get();
+    Client client(ClientOptions{}, std::move(transport));
+
+    for (size_t split = 0; split <= kFileBody.size(); ++split)
+    {
+        fake->split_streams_at(split);
+        std::string streamed;
+        auto file = client.read_file_stream("docs/a.md", [&](std::string_view chunk)
+        {
+            streamed.append(chunk);
+            return true;
+        });
+        CHECK(streamed == content);
+        CHECK(file.path == expected["path"].get<std::string>());
+        CHECK(file.encoding == expected["encoding"].get<std::string>());
+
+        // A range that starts and ends inside the surrogate pair's UTF-8 bytes
+        streamed.clear();
+        client.read_file_stream("docs/a.md", [&](std::string_view chunk)
+        {
+            streamed.append(chunk);
+            return true;
+        }, {.offset = 7, .length = 3});
+        CHECK(streamed == content.substr(7, 3));
+    }
+}
+
+TEST(find_text_stream_matches_json_parse_at_every_split)
+{
+    auto expected = json::parse(kMatchesBody);
+
+    auto transport = std::make_unique<test::FakeTransport>();
+    transport->reply("POST /find/text", 200, kMatchesBody);
+    auto* fake = transport.get();
+    Client client(ClientOptions{}, std::move(transport));
+
+    for (size_t split = 0; split <= kMatchesBody.size(); ++split)
+    {
+        fake->split_streams_at(split);
+        std::vector<TextMatch> matches;
+        auto result = client.find_text_stream({.pattern = "x"}, [&](const TextMatch& match)
+        {
+            matches.push_back(match);
+            return true;
+        });
+        CHECK(matches.size() == expected["matches"].size());
+        for (size_t i = 0; i < matches.size() && i < expected["matches"].size(); ++i)
+        {
+            const auto& want = expected["matches"][i];
+            CHECK(matches[i].path == want["path"].get<std::string>());
+            CHECK(matches[i].line == want["line"].get<int>());
+            CHECK(matches[i].column == want["column"].get<int>());
+            CHECK(matches[i].text == want["text"].get<std::string>());
+            CHECK(matches[i].match == want["match"].get<std::string>());
+        }
+        CHECK(result.total_matches == expected["totalMatches"].get<int>());
+        CHECK(!result.truncated);
+    }
+}
+
+TEST(find_text_stream_deadline_keeps_the_matches_so_far)
+{
+    auto transport = std::make_unique<test::FakeTransport>();
+    transport->reply("POST /find/text", 200, kMatchesBody);
+    transport->split_streams_at(kMatchesBody.find("},{") + 2);
+    Client client(ClientOptions{}, std::move(transport));
+
+    size_t matches = 0;
+    auto call = CallOptions::within(std::chrono::milliseconds(20));
+    auto result = client.find_text_stream({.pattern = "x"}, [&](const TextMatch&)
+    {
+        ++matches;
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        return true;
+    }, {}, call);
+    CHECK(matches == 1);
+    CHECK(result.truncated);
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/events.hpp>
+
+#include <vector>
+
+using namespace opencode;
+
+TEST(tui_screen_reports_rows_added_by_resize)
+{
+    TuiScreen screen;
+    screen.reset(TuiRender{.lines = {"a", "b"}, .size = {.width = 80, .height = 2}, .seq = 1});
+    CHECK(screen.full_redraw());
+
+    TuiRenderDiffEvent grow{.seq = 2, .size = {.width = 0, .height = 4}, .lines = {{.row = 3, .text = "d"}}};
+    CHECK(screen.apply(grow));
+    CHECK(screen.full_redraw());
+    CHECK(screen.changed_rows() == std::vector<int>({2, 3}));
+    CHECK(screen.lines().size() == 4);
+    CHECK(screen.lines()[3] == "d");
+
+    TuiRenderDiffEvent edit{.seq = 3, .lines = {{.row = 0, .text = "A"}}};
+    CHECK(screen.apply(edit));
+    CHECK(!screen.full_redraw());
+    CHECK(screen.changed_rows() == std::vector<int>({0}));
+}
+
+TEST(tui_screen_flags_full_redraw_on_shrink)
+{
+    TuiScreen screen;
+    screen.reset(TuiRender{.lines = {"a", "b", "c"}, .size = {.width = 80, .height = 3}, .seq = 1});
+
+    TuiRenderDiffEvent shrink{.seq = 2, .size = {.width = 0, .height = 1}};
+    CHECK(screen.apply(shrink));
+    CHECK(screen.full_redraw());
+    CHECK(screen.changed_rows().empty());
+    CHECK(screen.lines().size() == 1);
+}
+
+TEST(tui_screen_finds_changed_rows_between_snapshots)
+{
+    TuiScreen screen;
+    CHECK(screen.update(TuiRender{.lines = {"a", "b"}, .size = {.width = 80, .height = 2}}));
+    CHECK(screen.full_redraw());
+    CHECK(screen.changed_rows() == std::vector<int>({0, 1}));
+
+    CHECK(screen.update(TuiRender{.lines = {"a", "B"}, .size = {.width = 80, .height = 2}}));
+    CHECK(!screen.full_redraw());
+    CHECK(screen.changed_rows() == std::vector<int>({1}));
+
+    CHECK(!screen.update(TuiRender{.lines = {"a", "B"}, .size = {.width = 80, .height = 2}}));
+    CHECK(screen.changed_rows().empty());
+
+    CHECK(screen.update(TuiRender{.lines = {"a", "B", "c"}, .size = {.width = 80, .height = 3}}));
+    CHECK(screen.full_redraw());
+    CHECK(screen.changed_rows() == std::vector<int>({2}));
+
+    CHECK(screen.update(TuiRender{.lines = {"x"}, .size = {.width = 80, .height = 1}}));
+    CHECK(screen.full_redraw());
+    CHECK(screen.changed_rows() == std::vector<int>({0}));
+    CHECK(screen.lines().size() == 1);
+}
+
+TEST(tui_screen_ignores_snapshots_that_are_not_newer)
+{
+    TuiScreen screen;
+    screen.reset(TuiRender{.lines = {"new"}, .size = {.width = 80, .height = 1}, .seq = 5});
+    CHECK(!screen.update(TuiRender{.lines = {"old"}, .size = {.width = 80, .height = 1}, .seq = 4}));
+    CHECK(screen.lines()[0] == "new");
+    CHECK(screen.update(TuiRender{.lines = {"newer"}, .size = {.width = 80, .height = 1}, .seq = 6}));
+    CHECK(screen.changed_rows() == std::vector<int>({0}));
+}
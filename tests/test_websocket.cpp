@@ -0,0 +1,219 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include "harness.hpp"
+
+#include <opencode/client.hpp>
+#include <opencode/transport.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace opencode;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Frames = std::vector<std::pair<WebSocketOpcode, std::string>>;
+
+Frames parse(WebSocketParser& parser, std::string_view data)
+{
+    Frames frames;
+    parser.feed(data, [&](WebSocketOpcode opcode, std::string_view payload)
+    {
+        frames.emplace_back(opcode, std::string(payload));
+    });
+    return frames;
+}
+
+} // namespace
+
+TEST(websocket_accept_matches_rfc_example)
+{
+    CHECK(websocket_accept("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(websocket_frame_masks_client_frames)
+{
+    // RFC 6455, section 5.7: a masked "Hello"
+    CHECK(websocket_frame(WebSocketOpcode::Text, "Hello", 0x37FA213D) ==
+          std::string("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58", 11));
+
+    std::string big(300, 'x');
+    auto frame = websocket_frame(WebSocketOpcode::Text, big, 0);
+    CHECK(frame.size() == 2 + 2 + 4 + big.size());
+    CHECK(static_cast<uint8_t>(frame[1]) == (0x80 | 126));
+}
+
+TEST(websocket_parser_joins_fragments_around_control_frames)
+{
+    WebSocketParser parser;
+    // Unfragmented text, then "Hel" + ping + "lo", as a server sends them
+    std::string stream("\x81\x05Hello"
+                       "\x01\x03Hel"
+                       "\x89\x00"
+                       "\x80\x02lo", 18);
+    auto frames = parse(parser, stream);
+    CHECK(frames.size() == 3);
+    CHECK(frames.size() == 3 && frames[0] == Frames::value_type(WebSocketOpcode::Text, "Hello"));
+    CHECK(frames.size() == 3 && frames[1] == Frames::value_type(WebSocketOpcode::Ping, ""));
+    CHECK(frames.size() == 3 && frames[2] == Frames::value_type(WebSocketOpcode::Text, "Hello"));
+}
+
+TEST(websocket_parser_holds_frames_split_across_chunks)
+{
+    WebSocketParser parser;
+    std::string output(300, 'o');
+    std::string stream = std::string("\x81\x7e\x01\x2c", 4) + output;
+
+    Frames frames;
+    for (char c : stream)
+    {
+        for (auto& frame : parse(parser, std::string_view(&c, 1)))
+            frames.push_back(std::move(frame));
+    }
+    CHECK(frames.size() == 1);
+    CHECK(frames.size() == 1 && frames[0].second == output);
+
+    // Masked frames are unmasked
+    frames = parse(parser, std::string("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58", 11));
+    CHECK(frames.size() == 1 && frames[0].second == "Hello");
+
+    bool threw = false;
+    try
+    {
+        parse(parser, std::string("\x83\x00", 2)); // Reserved opcode
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+#ifndef _WIN32
+
+TEST(pty_channel_streams_output_over_websocket)
+{
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(address);
+    CHECK(::bind(listener, reinterpret_cast<sockaddr*>(&address), size) == 0);
+    CHECK(::listen(listener, 1) == 0);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &size);
+
+    // One-connection OpenCode stand-in: upgrade, send a prompt (fragmented,
+    // with a ping in between), echo the input, then close
+    std::string request_line, input;
+    bool ponged = false;
+    std::thread server([&]
+    {
+        int sock = ::accept(listener, nullptr, nullptr);
+        std::string head;
+        char chunk[4096];
+        while (head.find("\r\n\r\n") == std::string::npos)
+        {
+            auto n = ::recv(sock, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                break;
+            head.append(chunk, static_cast<size_t>(n));
+        }
+        request_line = head.substr(0, head.find("\r\n"));
+        auto key_at = head.find("Sec-WebSocket-Key: ") + 19;
+        auto key = head.substr(key_at, head.find("\r\n", key_at) - key_at);
+
+        std::string reply = "HTTP/1.1 101 Switching Protocols\r\n"
+                            "Upgrade: websocket\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: " + websocket_accept(key) + "\r\n\r\n";
+        reply += std::string("\x81\x02$ ", 4);
+        reply += std::string("\x01\x03hel" "\x89\x00" "\x80\x02lo", 11);
+        ::send(sock, reply.data(), reply.size(), 0);
+
+        WebSocketParser parser;
+        while (input.empty())
+        {
+            auto n = ::recv(sock, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                break;
+            for (auto& [opcode, payload] : parse(parser, std::string_view(chunk, static_cast<size_t>(n))))
+            {
+                if (opcode == WebSocketOpcode::Pong)
+                    ponged = true;
+                else if (opcode == WebSocketOpcode::Text)
+                    input = payload;
+            }
+        }
+
+        std::string echo = std::string("\x81\x04", 2) + "ls\r\n" + std::string("\x88\x02\x03\xe8", 4);
+        ::send(sock, echo.data(), echo.size(), 0);
+        while (::recv(sock, chunk, sizeof(chunk), 0) > 0)
+        {
+        }
+        ::close(sock);
+    });
+
+    auto transport = std::make_unique<test::FakeTransport>();
+    auto* fake = transport.get();
+    ClientOptions options;
+    options.base_url = "http://127.0.0.1:" + std::to_string(ntohs(address.sin_port));
+    Client client(options, std::move(transport));
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string output;
+    std::optional<std::string> closed;
+    auto channel = client.open_pty_channel("pty_1", {
+        .on_output = [&](std::string_view data)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            output += data;
+            cv.notify_all();
+        },
+        .on_closed = [&](const std::string& error)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = error;
+            cv.notify_all();
+        }});
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        CHECK(cv.wait_for(lock, 5s, [&] { return output == "$ hello"; }));
+    }
+    channel.write("ls\r");
+    channel.flush();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        CHECK(cv.wait_for(lock, 5s, [&] { return closed.has_value(); }));
+        CHECK(output == "$ hellols\r\n");
+        CHECK(closed && closed->empty());
+    }
+    channel.close();
+    server.join();
+    ::close(listener);
+
+    CHECK(request_line == "GET /pty/pty_1/connect HTTP/1.1");
+    CHECK(ponged);
+    CHECK(input == "ls\r");
+    CHECK(fake->requests().empty()); // Input went over the socket, not POST /write
+}
+
+#endif // !_WIN32